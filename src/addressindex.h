@@ -310,6 +310,90 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+struct CAddressSummaryKey {
+    unsigned int type;
+    uint160 hashBytes;
+    std::string asset;
+
+    size_t GetSerializeSize() const {
+        return 21 + GetSizeOfCompactSize(asset.size()) + asset.size();
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ::Serialize(s, asset);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        ::Unserialize(s, asset);
+    }
+
+    CAddressSummaryKey(unsigned int addressType, uint160 addressHash, std::string assetName) {
+        type = addressType;
+        hashBytes = addressHash;
+        asset = assetName;
+    }
+
+    CAddressSummaryKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        asset.clear();
+    }
+
+    friend bool operator<(const CAddressSummaryKey& a, const CAddressSummaryKey& b) {
+        if (a.type != b.type)
+            return a.type < b.type;
+        if (a.hashBytes != b.hashBytes)
+            return a.hashBytes < b.hashBytes;
+        return a.asset < b.asset;
+    }
+};
+
+/** The running totals of an address in one asset */
+struct CAddressSummary {
+    CAmount balance;
+    //! Sum of the amounts received, including change
+    CAmount received;
+    //! Number of transactions that sent to or spent from the address
+    int64_t txCount;
+    int firstHeight;
+    int lastHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(VARINT(txCount));
+        READWRITE(VARINT(firstHeight));
+        READWRITE(VARINT(lastHeight));
+    }
+
+    CAddressSummary() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+        firstHeight = 0;
+        lastHeight = 0;
+    }
+
+    bool IsNull() const {
+        return (txCount == 0);
+    }
+};
+
 struct CMempoolAddressDelta
 {
     int64_t time;
@@ -7,6 +7,8 @@
 #include <chainparams.h>
 #include "bench.h"
 #include "crypto/sha256.h"
+#include "crypto/ethash/include/ethash/ethash.h"
+#include "crypto/scrypt.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
@@ -16,6 +18,8 @@ int
 main(int argc, char **argv)
 {
     SHA256AutoDetect();
+    ethash_progpow_autodetect();
+    scrypt_detect_batch();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
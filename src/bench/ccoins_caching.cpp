@@ -6,8 +6,10 @@
 #include "bench.h"
 #include "coins.h"
 #include "policy/policy.h"
+#include "random.h"
 #include "wallet/crypter.h"
 
+#include <unordered_map>
 #include <vector>
 
 // FIXME: Dedup with SetupDummyInputs in test/transaction_tests.cpp.
@@ -86,3 +88,108 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching);
+
+// Microbenchmarks of the map behind CCoinsViewCache, against the
+// std::unordered_map it replaced: filling a cache, looking coins up (half of
+// them missing, as for the inputs of new transactions), and draining it the
+// way BatchWrite does.
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> StdCoinsMap;
+
+static const size_t COINS_MAP_BENCH_SIZE = 100000;
+
+static std::vector<COutPoint> SetupOutpoints(size_t count)
+{
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+    }
+    return outpoints;
+}
+
+template <typename Map>
+static void FillCoinsMap(Map& map, const std::vector<COutPoint>& outpoints)
+{
+    for (const COutPoint& outpoint : outpoints) {
+        CCoinsCacheEntry& entry = map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>()).first->second;
+        entry.coin.out.nValue = 50 * CENT;
+        entry.coin.nHeight = 1;
+        entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    }
+}
+
+template <typename Map>
+static void CoinsMapInsert(benchmark::State& state)
+{
+    const std::vector<COutPoint> outpoints = SetupOutpoints(COINS_MAP_BENCH_SIZE);
+    while (state.KeepRunning()) {
+        Map map;
+        FillCoinsMap(map, outpoints);
+    }
+}
+
+template <typename Map>
+static void CoinsMapLookup(benchmark::State& state)
+{
+    const std::vector<COutPoint> outpoints = SetupOutpoints(2 * COINS_MAP_BENCH_SIZE);
+    Map map;
+    FillCoinsMap(map, std::vector<COutPoint>(outpoints.begin(), outpoints.begin() + COINS_MAP_BENCH_SIZE));
+    std::vector<COutPoint> lookups(outpoints);
+    Shuffle(lookups.begin(), lookups.end(), FastRandomContext(true));
+    while (state.KeepRunning()) {
+        size_t found = 0;
+        for (const COutPoint& outpoint : lookups) {
+            found += map.find(outpoint) != map.end();
+        }
+        assert(found == COINS_MAP_BENCH_SIZE);
+    }
+}
+
+template <typename Map>
+static void CoinsMapDrain(benchmark::State& state)
+{
+    const std::vector<COutPoint> outpoints = SetupOutpoints(COINS_MAP_BENCH_SIZE);
+    while (state.KeepRunning()) {
+        Map map;
+        FillCoinsMap(map, outpoints);
+        for (typename Map::iterator it = map.begin(); it != map.end();) {
+            typename Map::iterator itOld = it++;
+            map.erase(itOld);
+        }
+        assert(map.empty());
+    }
+}
+
+static void CoinsMapInsertStd(benchmark::State& state) { CoinsMapInsert<StdCoinsMap>(state); }
+static void CoinsMapInsertFlat(benchmark::State& state) { CoinsMapInsert<CCoinsMap>(state); }
+static void CoinsMapLookupStd(benchmark::State& state) { CoinsMapLookup<StdCoinsMap>(state); }
+static void CoinsMapLookupFlat(benchmark::State& state) { CoinsMapLookup<CCoinsMap>(state); }
+static void CoinsMapDrainStd(benchmark::State& state) { CoinsMapDrain<StdCoinsMap>(state); }
+static void CoinsMapDrainFlat(benchmark::State& state) { CoinsMapDrain<CCoinsMap>(state); }
+
+// Add coins to a cache and flush them into its parent cache, which moves
+// every entry through BatchWrite.
+static void CCoinsCacheFlush(benchmark::State& state)
+{
+    const std::vector<COutPoint> outpoints = SetupOutpoints(COINS_MAP_BENCH_SIZE);
+    CCoinsView coinsDummy;
+    Coin coin(CTxOut(50 * CENT, CScript() << OP_TRUE), 1, false);
+    while (state.KeepRunning()) {
+        CCoinsViewCache base(&coinsDummy);
+        CCoinsViewCache cache(&base);
+        for (const COutPoint& outpoint : outpoints) {
+            cache.AddCoin(outpoint, Coin(coin), false);
+        }
+        cache.Flush();
+        assert(base.GetCacheSize() == COINS_MAP_BENCH_SIZE);
+    }
+}
+
+BENCHMARK(CoinsMapInsertStd);
+BENCHMARK(CoinsMapInsertFlat);
+BENCHMARK(CoinsMapLookupStd);
+BENCHMARK(CoinsMapLookupFlat);
+BENCHMARK(CoinsMapDrainStd);
+BENCHMARK(CoinsMapDrainFlat);
+BENCHMARK(CCoinsCacheFlush);
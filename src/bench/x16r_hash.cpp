@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2019 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "uint256.h"
+
+// The step functions hash the 64-byte result of the previous step, except the
+// first one, which hashes the 80-byte block header.
+static void X16RAlgo(benchmark::State& state, int algo)
+{
+    unsigned char buf[64] = {0};
+    while (state.KeepRunning()) {
+        HashX16RAlgo(algo, buf, sizeof(buf), buf);
+    }
+}
+
+#define BENCHMARK_X16R_ALGO(algo, name) \
+    static void X16R_##name(benchmark::State& state) { X16RAlgo(state, algo); } \
+    BENCHMARK(X16R_##name);
+
+BENCHMARK_X16R_ALGO(0, Blake512)
+BENCHMARK_X16R_ALGO(1, BMW512)
+BENCHMARK_X16R_ALGO(2, Groestl512)
+BENCHMARK_X16R_ALGO(3, JH512)
+BENCHMARK_X16R_ALGO(4, Keccak512)
+BENCHMARK_X16R_ALGO(5, Skein512)
+BENCHMARK_X16R_ALGO(6, Luffa512)
+BENCHMARK_X16R_ALGO(7, Cubehash512)
+BENCHMARK_X16R_ALGO(8, Shavite512)
+BENCHMARK_X16R_ALGO(9, SIMD512)
+BENCHMARK_X16R_ALGO(10, Echo512)
+BENCHMARK_X16R_ALGO(11, Hamsi512)
+BENCHMARK_X16R_ALGO(12, Fugue512)
+BENCHMARK_X16R_ALGO(13, Shabal512)
+BENCHMARK_X16R_ALGO(14, Whirlpool)
+BENCHMARK_X16R_ALGO(15, SHA512)
+
+// A previous block hash whose last 16 nibbles select every step function once.
+static const uint256 X16R_ALL_ALGOS = uint256S("0123456789abcdef");
+
+static void X16R_Header(benchmark::State& state)
+{
+    unsigned char header[80] = {0};
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        WriteLE32(header + 76, nonce++);
+        HashX16R(header, sizeof(header), X16R_ALL_ALGOS);
+    }
+}
+
+static void X16RV2_Header(benchmark::State& state)
+{
+    unsigned char header[80] = {0};
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        WriteLE32(header + 76, nonce++);
+        HashX16RV2(header, sizeof(header), X16R_ALL_ALGOS);
+    }
+}
+
+BENCHMARK(X16R_Header);
+BENCHMARK(X16RV2_Header);
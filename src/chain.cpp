@@ -200,3 +200,28 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
     assert(pa == pb);
     return pa;
 }
+
+CBlockIndex* CBlockIndexArena::Alloc()
+{
+    if (!pchunkCurrent || nUsed == CHUNK_SIZE) {
+        pchunkCurrent = AllocChunk();
+        nUsed = 0;
+    }
+    return &pchunkCurrent[nUsed++];
+}
+
+CBlockIndex* CBlockIndexArena::AllocChunk()
+{
+    std::unique_ptr<CBlockIndex[]> chunk(new CBlockIndex[CHUNK_SIZE]);
+    std::lock_guard<std::mutex> lock(mutex);
+    vChunks.push_back(std::move(chunk));
+    return vChunks.back().get();
+}
+
+void CBlockIndexArena::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    vChunks.clear();
+    pchunkCurrent = nullptr;
+    nUsed = 0;
+}
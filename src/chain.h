@@ -14,6 +14,8 @@
 #include "tinyformat.h"
 #include "uint256.h"
 
+#include <memory>
+#include <mutex>
 #include <vector>
 
 /**
@@ -373,6 +375,35 @@ int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& fr
 const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex* pb);
 
 
+/**
+ * Owner of the CBlockIndex objects of mapBlockIndex. They are allocated in
+ * chunks of contiguous objects rather than one heap allocation each, which
+ * saves the allocator overhead per block and keeps the index together in
+ * memory. Objects are never freed one by one, only all at once by Clear().
+ */
+class CBlockIndexArena
+{
+public:
+    static const size_t CHUNK_SIZE = 4096;
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<CBlockIndex[]> > vChunks;
+    //! Chunk Alloc() takes objects from, and how many it took
+    CBlockIndex* pchunkCurrent;
+    size_t nUsed;
+
+public:
+    CBlockIndexArena() : pchunkCurrent(nullptr), nUsed(0) {}
+
+    /** A fresh CBlockIndex. Not thread-safe, the caller holds cs_main */
+    CBlockIndex* Alloc();
+    /** CHUNK_SIZE fresh objects for one thread to fill. Thread-safe */
+    CBlockIndex* AllocChunk();
+    /** Free every object */
+    void Clear();
+};
+
 /** Used to marshal pointers into hashes for db storage. */
 class CDiskBlockIndex : public CBlockIndex
 {
@@ -0,0 +1,266 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinprefetch.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+namespace {
+
+/** Number of outpoints looked up per job, so that several threads share a block */
+static const size_t PREFETCH_JOB_SIZE = 64;
+
+/**
+ * Queue of coin lookups for upcoming blocks, worked off by the prefetch
+ * threads. A job either reads a block and splits its prevouts into lookup
+ * jobs, or looks up a batch of prevouts. Lookups only go to the coin database,
+ * never to pcoinsTip, so the threads do not need cs_main.
+ *
+ * The coins found stay valid until pcoinsTip is flushed: until then the
+ * database does not change, and pcoinsTip has its own entry for every coin it
+ * modified. InvalidatePrefetchedCoins() drops the blocks, so the results of
+ * lookups that straddle a flush are discarded.
+ */
+class CCoinPrefetcher
+{
+private:
+    struct Job {
+        uint256 hashBlock;
+        uint64_t nBlockId;
+        CCoinsView* base;
+        //! For a block job, the block or where to read it
+        std::shared_ptr<const CBlock> pblock;
+        CDiskBlockPos pos;
+        //! For a lookup job, the prevouts to look up
+        std::vector<COutPoint> vOutpoints;
+    };
+
+    struct BlockEntry {
+        //! Distinguishes this entry from a dropped one for the same block
+        uint64_t nId;
+        //! Jobs of this block being worked on
+        int nRunning;
+        std::vector<std::pair<COutPoint, Coin> > vCoins;
+    };
+
+    boost::mutex mutex;
+    //! Prefetch threads wait on this for jobs
+    boost::condition_variable condWork;
+    //! ApplyPrefetchedCoins waits on this for running jobs
+    boost::condition_variable condDone;
+
+    std::deque<Job> queue;
+    std::map<uint256, BlockEntry> mapBlocks;
+    //! Blocks in the order they were queued, to bound mapBlocks
+    std::deque<uint256> vBlockOrder;
+    uint64_t nNextId;
+
+    /** Split the prevouts of a block that it does not create itself into lookup jobs. */
+    static std::vector<Job> SplitBlock(const Job& job, const CBlock& block, const CCoinsViewCache* cache)
+    {
+        std::set<uint256> setTxids;
+        for (const auto& tx : block.vtx)
+            setTxids.insert(tx->GetHash());
+
+        std::vector<Job> vJobs;
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase())
+                continue;
+            for (const CTxIn& txin : tx->vin) {
+                if (setTxids.count(txin.prevout.hash) || (cache && cache->HaveCoinInCache(txin.prevout)))
+                    continue;
+                if (vJobs.empty() || vJobs.back().vOutpoints.size() == PREFETCH_JOB_SIZE) {
+                    vJobs.push_back(Job{job.hashBlock, job.nBlockId, job.base, nullptr, CDiskBlockPos(), {}});
+                    vJobs.back().vOutpoints.reserve(PREFETCH_JOB_SIZE);
+                }
+                vJobs.back().vOutpoints.push_back(txin.prevout);
+            }
+        }
+        return vJobs;
+    }
+
+    /** Put jobs at the front of the queue, so blocks are worked off in order. */
+    void PushFront(std::vector<Job>& vJobs)
+    {
+        for (auto it = vJobs.rbegin(); it != vJobs.rend(); ++it)
+            queue.push_front(std::move(*it));
+        if (!vJobs.empty())
+            condWork.notify_all();
+    }
+
+public:
+    CCoinPrefetcher() : nNextId(0) {}
+
+    void Thread()
+    {
+        while (true) {
+            Job job;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty())
+                    condWork.wait(lock);
+                job = std::move(queue.front());
+                queue.pop_front();
+                auto it = mapBlocks.find(job.hashBlock);
+                if (it == mapBlocks.end() || it->second.nId != job.nBlockId)
+                    continue;
+                it->second.nRunning++;
+            }
+
+            std::vector<Job> vJobs;
+            std::vector<std::pair<COutPoint, Coin> > vCoins;
+            try {
+                if (job.vOutpoints.empty()) {
+                    std::shared_ptr<const CBlock> pblock = job.pblock;
+                    if (!pblock) {
+                        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+                        if (ReadBlockFromDisk(*pblockRead, job.pos, GetParams().GetConsensus()))
+                            pblock = pblockRead;
+                    }
+                    if (pblock)
+                        vJobs = SplitBlock(job, *pblock, nullptr);
+                } else {
+                    vCoins.reserve(job.vOutpoints.size());
+                    for (const COutPoint& outpoint : job.vOutpoints) {
+                        Coin coin;
+                        if (job.base->GetCoin(outpoint, coin))
+                            vCoins.emplace_back(outpoint, std::move(coin));
+                    }
+                }
+            } catch (const std::exception& e) {
+                // ConnectBlock does the lookups itself, and reports any error.
+                LogPrint(BCLog::COINDB, "%s: %s\n", __func__, e.what());
+            }
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            auto it = mapBlocks.find(job.hashBlock);
+            if (it != mapBlocks.end() && it->second.nId == job.nBlockId) {
+                it->second.nRunning--;
+                std::move(vCoins.begin(), vCoins.end(), std::back_inserter(it->second.vCoins));
+                PushFront(vJobs);
+                condDone.notify_all();
+            }
+        }
+    }
+
+    void Prefetch(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& pblock)
+    {
+        AssertLockHeld(cs_main);
+        if (!pblock && !(pindex->nStatus & BLOCK_HAVE_DATA))
+            return;
+        const uint256 hashBlock = pindex->GetBlockHash();
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (mapBlocks.count(hashBlock))
+            return;
+        const uint64_t nId = nNextId++;
+        mapBlocks.emplace(hashBlock, BlockEntry{nId, 0, {}});
+        vBlockOrder.push_back(hashBlock);
+        // Forget blocks that were never connected, e.g. after a reorg.
+        while (vBlockOrder.size() > 2 * COIN_PREFETCH_BLOCKS) {
+            mapBlocks.erase(vBlockOrder.front());
+            vBlockOrder.pop_front();
+        }
+
+        Job job{hashBlock, nId, pcoinsdbview, pblock, pblock ? CDiskBlockPos() : pindex->GetBlockPos(), {}};
+        if (pblock) {
+            // A block we were just given: split it here, skipping what the
+            // cache has, which at the tip is most of it.
+            std::vector<Job> vJobs = SplitBlock(job, *pblock, pcoinsTip);
+            for (Job& jobLookup : vJobs)
+                queue.push_back(std::move(jobLookup));
+            condWork.notify_all();
+        } else {
+            queue.push_back(std::move(job));
+            condWork.notify_one();
+        }
+    }
+
+    void Apply(const uint256& hashBlock)
+    {
+        AssertLockHeld(cs_main);
+        std::vector<std::pair<COutPoint, Coin> > vCoins;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            auto it = mapBlocks.find(hashBlock);
+            if (it == mapBlocks.end())
+                return;
+            while (it->second.nRunning > 0)
+                condDone.wait(lock);
+            vCoins.swap(it->second.vCoins);
+            mapBlocks.erase(it);
+        }
+
+        size_t nAdded = 0;
+        for (auto& entry : vCoins) {
+            if (pcoinsTip->AddBaseCoin(entry.first, std::move(entry.second)))
+                nAdded++;
+        }
+        LogPrint(BCLog::BENCH, "    - Prefetched %u coins (%u new to the cache)\n", (unsigned int)vCoins.size(), (unsigned int)nAdded);
+    }
+
+    void Clear()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        queue.clear();
+        mapBlocks.clear();
+        vBlockOrder.clear();
+    }
+};
+
+std::unique_ptr<CCoinPrefetcher> g_coin_prefetcher;
+
+} // namespace
+
+void StartCoinPrefetch(boost::thread_group& threadGroup)
+{
+    int nThreads = std::min<int>(gArgs.GetArg("-coinprefetch", DEFAULT_COIN_PREFETCH_THREADS), MAX_COIN_PREFETCH_THREADS);
+    if (nThreads <= 0)
+        return;
+
+    LogPrintf("Using %u threads for coin prefetching\n", nThreads);
+    g_coin_prefetcher.reset(new CCoinPrefetcher());
+    for (int i = 0; i < nThreads; i++) {
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "coinprefetch",
+            boost::function<void()>(boost::bind(&CCoinPrefetcher::Thread, g_coin_prefetcher.get()))));
+    }
+}
+
+void StopCoinPrefetch()
+{
+    if (g_coin_prefetcher)
+        g_coin_prefetcher->Clear();
+}
+
+void PrefetchBlockCoins(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& pblock)
+{
+    if (g_coin_prefetcher)
+        g_coin_prefetcher->Prefetch(pindex, pblock);
+}
+
+void ApplyPrefetchedCoins(const uint256& hashBlock)
+{
+    if (g_coin_prefetcher)
+        g_coin_prefetcher->Apply(hashBlock);
+}
+
+void InvalidatePrefetchedCoins()
+{
+    if (g_coin_prefetcher)
+        g_coin_prefetcher->Clear();
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Background lookup of the coins spent by the blocks about to be connected.
+ */
+#ifndef MEOWCOIN_COINPREFETCH_H
+#define MEOWCOIN_COINPREFETCH_H
+
+#include <memory>
+
+class CBlock;
+class CBlockIndex;
+class uint256;
+
+namespace boost {
+class thread_group;
+} // namespace boost
+
+/** Default for -coinprefetch, the number of threads looking up the coins spent by upcoming blocks */
+static const int DEFAULT_COIN_PREFETCH_THREADS = 4;
+/** Maximum for -coinprefetch */
+static const int MAX_COIN_PREFETCH_THREADS = 16;
+/** Number of upcoming blocks whose coins are looked up ahead of ConnectBlock */
+static const int COIN_PREFETCH_BLOCKS = 16;
+
+/** Start the threads that look up the coins of queued blocks */
+void StartCoinPrefetch(boost::thread_group& threadGroup);
+/** Drop all queued work. The threads themselves are interrupted with the thread group */
+void StopCoinPrefetch();
+
+/**
+ * Start looking up in the coin database the coins spent by a block, except
+ * those created within the block or already in pcoinsTip. If pblock is null,
+ * the block is read from disk first. Requires cs_main.
+ */
+void PrefetchBlockCoins(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& pblock);
+/**
+ * Add the coins found for a block to pcoinsTip as clean entries, unless it has
+ * entries for them already, and forget the block. Lookups that have not
+ * started yet are dropped; ConnectBlock does them itself. Requires cs_main.
+ */
+void ApplyPrefetchedCoins(const uint256& hashBlock);
+/**
+ * Forget all lookups, as the coin database changed under them. Must be called
+ * after every flush of pcoinsTip. Requires cs_main.
+ */
+void InvalidatePrefetchedCoins();
+
+#endif // MEOWCOIN_COINPREFETCH_H
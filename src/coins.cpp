@@ -9,6 +9,7 @@
 #include "consensus/consensus.h"
 #include "memusage.h"
 #include "random.h"
+#include "streams.h"
 #include "util.h"
 #include "validation.h"
 #include "tinyformat.h"
@@ -94,6 +95,16 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
 }
 
+bool CCoinsViewCache::AddBaseCoin(const COutPoint &outpoint, Coin&& coin) {
+    assert(!coin.IsSpent());
+    CCoinsMap::iterator it;
+    bool inserted;
+    std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (inserted)
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    return inserted;
+}
+
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, uint256 blockHash, bool check, CAssetsCache* assetsCache, std::pair<std::string, CBlockAssetUndo>* undoAssetData) {
     bool fCoinbase = tx.IsCoinBase();
     const uint256& txid = tx.GetHash();
@@ -534,3 +545,54 @@ const Coin& AccessByTxid(const CCoinsViewCache& view, const uint256& txid)
     }
     return coinEmpty;
 }
+
+/** The MuHash element of a coin: its outpoint, height and coinbase flag, and the full txout. */
+static void SerializeUTXOStatsElement(std::vector<unsigned char>& data, const COutPoint& outpoint, const Coin& coin)
+{
+    CVectorWriter ss(SER_DISK, PROTOCOL_VERSION, data, 0);
+    ss << outpoint;
+    ss << (uint32_t)(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+}
+
+static int64_t UTXOStatsBogoSize(const Coin& coin)
+{
+    return 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+           2 /* scriptPubKey len */ + coin.out.scriptPubKey.size() /* scriptPubKey */;
+}
+
+void CUTXOStats::AddCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    std::vector<unsigned char> data;
+    SerializeUTXOStatsElement(data, outpoint, coin);
+    muhash.Insert(data.data(), data.size());
+    nTransactionOutputs++;
+    nBogoSize += UTXOStatsBogoSize(coin);
+    nTotalAmount += coin.out.nValue;
+}
+
+void CUTXOStats::RemoveCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    std::vector<unsigned char> data;
+    SerializeUTXOStatsElement(data, outpoint, coin);
+    muhash.Remove(data.data(), data.size());
+    nTransactionOutputs--;
+    nBogoSize -= UTXOStatsBogoSize(coin);
+    nTotalAmount -= coin.out.nValue;
+}
+
+CUTXOStats& CUTXOStats::operator+=(const CUTXOStats& delta)
+{
+    nTransactionOutputs += delta.nTransactionOutputs;
+    nBogoSize += delta.nBogoSize;
+    nTotalAmount += delta.nTotalAmount;
+    muhash *= delta.muhash;
+    return *this;
+}
+
+uint256 CUTXOStats::GetHash()
+{
+    uint256 hash;
+    muhash.Finalize(hash.begin());
+    return hash;
+}
@@ -11,6 +11,8 @@
 #include "compressor.h"
 #include "core_memusage.h"
 #include "assets_stub.h"
+#include "crypto/muhash.h"
+#include "flatmap.h"
 #include "hash.h"
 #include "memusage.h"
 #include "serialize.h"
@@ -91,7 +93,7 @@ class SaltedOutpointHasher
 {
 private:
     /** Salt */
-    const uint64_t k0, k1;
+    uint64_t k0, k1;
 
 public:
     SaltedOutpointHasher();
@@ -125,7 +127,7 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+typedef flatmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -260,6 +262,13 @@ public:
      */
     void AddCoin(const COutPoint& outpoint, Coin&& coin, bool potential_overwrite);
 
+    /**
+     * Cache a coin that was read from the base view on behalf of this cache,
+     * unless there is an entry for it already. The caller must make sure the
+     * base has not been written to since the coin was read.
+     */
+    bool AddBaseCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -303,6 +312,56 @@ private:
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
 };
 
+/**
+ * Running totals and a rolling MuHash3072 of the UTXO set, kept up to date one
+ * coin at a time as blocks are connected and disconnected, so gettxoutsetinfo
+ * does not have to walk the whole coin database. A CUTXOStats can also hold
+ * the change caused by a single block, to be applied with operator+=.
+ */
+class CUTXOStats
+{
+public:
+    //! the block whose UTXO set these stats describe (null for a delta)
+    uint256 hashBlock;
+    int64_t nTransactionOutputs;
+    int64_t nBogoSize;
+    CAmount nTotalAmount;
+    MuHash3072 muhash;
+
+    CUTXOStats() : nTransactionOutputs(0), nBogoSize(0), nTotalAmount(0) {}
+
+    void AddCoin(const COutPoint& outpoint, const Coin& coin);
+    void RemoveCoin(const COutPoint& outpoint, const Coin& coin);
+
+    //! Apply a delta; hashBlock is left unchanged.
+    CUTXOStats& operator+=(const CUTXOStats& delta);
+
+    //! The 32-byte MuHash of the set. Normalizes the muhash state.
+    uint256 GetHash();
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        unsigned char data[MuHash3072::SERIALIZED_SIZE];
+        MuHash3072(muhash).ToBytes(data);
+        ::Serialize(s, hashBlock);
+        ::Serialize(s, nTransactionOutputs);
+        ::Serialize(s, nBogoSize);
+        ::Serialize(s, nTotalAmount);
+        s.write((const char*)data, sizeof(data));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        unsigned char data[MuHash3072::SERIALIZED_SIZE];
+        ::Unserialize(s, hashBlock);
+        ::Unserialize(s, nTransactionOutputs);
+        ::Unserialize(s, nBogoSize);
+        ::Unserialize(s, nTotalAmount);
+        s.read((char*)data, sizeof(data));
+        muhash.FromBytes(data);
+    }
+};
+
 //! Utility function to add all of a transaction's outputs to a cache.
 // When check is false, this assumes that overwrites are only possible for coinbase transactions.
 // When check is true, the underlying view may be queried to determine whether an addition is
@@ -104,6 +104,42 @@ void ethash_destroy_epoch_context(struct ethash_epoch_context* context) NOEXCEPT
 void ethash_destroy_epoch_context_full(struct ethash_epoch_context_full* context) NOEXCEPT;
 
 
+/**
+ * Sets the directory where the global shared epoch contexts persist their light caches.
+ *
+ * Light caches are written once to "epoch-N.cache" files in this directory and memory-mapped
+ * read-only by later calls to ethash_get_global_epoch_context(), also from other processes.
+ * The directory must exist. Pass null or an empty string to disable persistence.
+ *
+ * @param dir  The path of the directory.
+ */
+void ethash_set_light_cache_dir(const char* dir) NOEXCEPT;
+
+/**
+ * Builds the global shared epoch context ahead of its first use.
+ *
+ * The global cache keeps the few most recently used epoch contexts. This function builds
+ * the context without holding the cache lock, so it can run on a background thread while
+ * other threads keep using their epochs. A concurrent ethash_get_global_epoch_context() for
+ * the same epoch waits for the prefetch instead of building the context twice.
+ *
+ * @param epoch_number  The epoch number.
+ * @return  True if the context was built, false if it was already cached, another prefetch
+ *          is running or the memory allocation failed.
+ */
+bool ethash_prefetch_global_epoch_context(int epoch_number) NOEXCEPT;
+
+/**
+ * Selects the fastest ProgPoW lane kernel the CPU supports.
+ *
+ * Vectorized kernels are checked against the portable kernel before they are selected.
+ * Until this is called all ProgPoW and MeowPoW hashing uses the portable kernel.
+ * Call it once at startup, before other threads hash.
+ *
+ * @return  The name of the selected kernel.
+ */
+const char* ethash_progpow_autodetect(void) NOEXCEPT;
+
 /**
  * Get global shared epoch context.
  */
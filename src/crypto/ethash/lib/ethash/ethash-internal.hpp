@@ -13,6 +13,7 @@
 #include "endianness.hpp"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 extern "C" struct ethash_epoch_context_full : ethash_epoch_context
@@ -48,6 +49,35 @@ inline bool is_equal(const hash256& a, const hash256& b) noexcept
 
 void build_light_cache(hash512 cache[], int num_items, const hash256& seed) noexcept;
 
+/// Returns the epoch number used to size the light cache and the DAG.
+///
+/// From meowpow_dagchange_epoch onwards the cache and the DAG are sized as if
+/// the epoch were four times larger.
+int get_dag_epoch_number(int epoch_number) noexcept;
+
+/// Creates a light epoch context around an already built light cache.
+///
+/// The light cache memory is not owned by the context and must outlive it.
+/// The context itself MUST be freed with ethash_destroy_epoch_context().
+///
+/// @return  Pointer to the context or null if the number of items does not
+///          match the epoch or in case of memory allocation failure.
+epoch_context* create_epoch_context_from_light_cache(
+    int epoch_number, const hash512* light_cache, int light_cache_num_items) noexcept;
+
+/// Maps the light cache persisted in the directory read-only and wraps it in an epoch context.
+///
+/// Returns null if the file is missing, truncated, from another version or does not match its
+/// checksum. The caller rebuilds the cache in that case.
+std::shared_ptr<epoch_context> load_light_cache(const std::string& dir, int epoch_number);
+
+/// Writes the light cache of the context to the directory as "epoch-N.cache".
+///
+/// The file is written under a temporary name and renamed into place, so concurrent processes
+/// sharing the directory never observe a partial file. Caches of epochs older than the previous
+/// one are removed.
+void store_light_cache(const std::string& dir, const epoch_context& context);
+
 hash512 calculate_dataset_item_512(const epoch_context& context, int64_t index) noexcept;
 hash1024 calculate_dataset_item_1024(const epoch_context& context, uint32_t index) noexcept;
 hash2048 calculate_dataset_item_2048(const epoch_context& context, uint32_t index) noexcept;
@@ -136,12 +136,7 @@ epoch_context_full* create_epoch_context(
     static_assert(sizeof(epoch_context_full) < sizeof(hash512), "epoch_context too big");
     static constexpr size_t context_alloc_size = sizeof(hash512);
 
-    int meow_epoch = epoch_number;
-    if (epoch_number >= meowpow_dagchange_epoch)
-    {
-        // note, int truncates, it doesnt round, 10 == 10.5. So this is ok.
-        meow_epoch = epoch_number*4; //This should pass 4gb DAG size
-    }
+    const int meow_epoch = get_dag_epoch_number(epoch_number);
 
     const int light_cache_num_items = calculate_light_cache_num_items(meow_epoch);
     const int full_dataset_num_items = calculate_full_dataset_num_items(meow_epoch);
@@ -181,6 +176,46 @@ epoch_context_full* create_epoch_context(
 }
 }  // namespace generic
 
+int get_dag_epoch_number(int epoch_number) noexcept
+{
+    // note, int truncates, it doesnt round, 10 == 10.5. So this is ok.
+    if (epoch_number >= meowpow_dagchange_epoch)
+        return epoch_number * 4;  //This should pass 4gb DAG size
+    return epoch_number;
+}
+
+epoch_context* create_epoch_context_from_light_cache(
+    int epoch_number, const hash512* light_cache, int light_cache_num_items) noexcept
+{
+    static constexpr size_t context_alloc_size = sizeof(hash512);
+
+    const int meow_epoch = get_dag_epoch_number(epoch_number);
+    if (light_cache_num_items != calculate_light_cache_num_items(meow_epoch))
+        return nullptr;
+
+    const size_t alloc_size = context_alloc_size + progpow::l1_cache_size;
+
+    char* const alloc_data = static_cast<char*>(std::calloc(1, alloc_size));
+    if (!alloc_data)
+        return nullptr;  // Signal out-of-memory by returning null pointer.
+
+    uint32_t* const l1_cache = reinterpret_cast<uint32_t*>(alloc_data + context_alloc_size);
+
+    epoch_context_full* const context = new (alloc_data) epoch_context_full{
+        epoch_number,
+        light_cache_num_items,
+        light_cache,
+        l1_cache,
+        calculate_full_dataset_num_items(meow_epoch),
+        nullptr,
+    };
+
+    auto* full_dataset_2048 = reinterpret_cast<hash2048*>(l1_cache);
+    for (uint32_t i = 0; i < progpow::l1_cache_size / sizeof(full_dataset_2048[0]); ++i)
+        full_dataset_2048[i] = calculate_dataset_item_2048(*context, i);
+    return context;
+}
+
 void build_light_cache(hash512 cache[], int num_items, const hash256& seed) noexcept
 {
     return generic::build_light_cache(keccak512, cache, num_items, seed);
@@ -4,8 +4,24 @@
 
 #include "crypto/ethash/lib/ethash/ethash-internal.hpp"
 
+#include <crypto/ethash/include/ethash/keccak.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #if !defined(__has_cpp_attribute)
 #define __has_cpp_attribute(x) 0
@@ -21,41 +37,237 @@
 
 using namespace ethash;
 
+namespace ethash
+{
+namespace
+{
+/// The header of a persisted light cache file.
+///
+/// The file is the header followed by the light cache items in the native
+/// in-memory layout. The header is one light cache item long so the items stay
+/// aligned in the memory mapped file.
+struct light_cache_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t epoch_number;
+    int32_t light_cache_num_items;
+    uint8_t reserved[16];
+    hash256 checksum;  ///< Keccak-256 of the light cache items.
+};
+
+static_assert(sizeof(light_cache_file_header) == sizeof(hash512), "");
+
+constexpr uint32_t light_cache_file_magic = 0x6c776f6d;  // "mowl" in little-endian.
+constexpr uint32_t light_cache_file_version = 1;
+
+std::string get_light_cache_path(const std::string& dir, int epoch_number)
+{
+    return dir + "/epoch-" + std::to_string(epoch_number) + ".cache";
+}
+}  // namespace
+
+#ifndef _WIN32
+std::shared_ptr<epoch_context> load_light_cache(const std::string& dir, int epoch_number)
+{
+    const std::string path = get_light_cache_path(dir, epoch_number);
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(light_cache_file_header)))
+    {
+        close(fd);
+        return {};
+    }
+
+    const size_t map_size = static_cast<size_t>(st.st_size);
+    void* const map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return {};
+
+    const auto* header = static_cast<const light_cache_file_header*>(map);
+    const auto* light_cache = reinterpret_cast<const hash512*>(header + 1);
+    const int num_items = header->light_cache_num_items;
+
+    bool valid = header->magic == light_cache_file_magic &&
+                 header->version == light_cache_file_version &&
+                 header->epoch_number == epoch_number && num_items > 0 &&
+                 map_size == sizeof(*header) + get_light_cache_size(num_items);
+    if (valid)
+    {
+        const hash256 checksum = keccak256(light_cache[0].bytes, get_light_cache_size(num_items));
+        valid = is_equal(checksum, header->checksum);
+    }
+
+    epoch_context* const context =
+        valid ? create_epoch_context_from_light_cache(epoch_number, light_cache, num_items) :
+                nullptr;
+    if (!context)
+    {
+        munmap(map, map_size);
+        return {};
+    }
+
+    return {context, [map, map_size](epoch_context* ctx) noexcept {
+                ethash_destroy_epoch_context(ctx);
+                munmap(map, map_size);
+            }};
+}
+
+namespace
+{
+/// Removes persisted light caches of epochs older than the previous one.
+void prune_light_caches(const std::string& dir, int epoch_number)
+{
+    DIR* const d = opendir(dir.c_str());
+    if (!d)
+        return;
+
+    while (const dirent* entry = readdir(d))
+    {
+        int file_epoch = 0;
+        char suffix[8] = {};
+        if (std::sscanf(entry->d_name, "epoch-%d.%7s", &file_epoch, suffix) == 2 &&
+            std::string{suffix} == "cache" && file_epoch < epoch_number - 1)
+            std::remove((dir + "/" + entry->d_name).c_str());
+    }
+    closedir(d);
+}
+}  // namespace
+
+void store_light_cache(const std::string& dir, const epoch_context& context)
+{
+    const size_t light_cache_size = get_light_cache_size(context.light_cache_num_items);
+
+    light_cache_file_header header{};
+    header.magic = light_cache_file_magic;
+    header.version = light_cache_file_version;
+    header.epoch_number = context.epoch_number;
+    header.light_cache_num_items = context.light_cache_num_items;
+    header.checksum = keccak256(context.light_cache[0].bytes, light_cache_size);
+
+    const std::string path = get_light_cache_path(dir, context.epoch_number);
+    const std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+
+    std::FILE* const file = std::fopen(tmp_path.c_str(), "wb");
+    if (!file)
+        return;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(context.light_cache, light_cache_size, 1, file) == 1 &&
+              std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmp_path.c_str());
+        return;
+    }
+
+    prune_light_caches(dir, context.epoch_number);
+}
+#else
+std::shared_ptr<epoch_context> load_light_cache(const std::string&, int)
+{
+    return {};
+}
+
+void store_light_cache(const std::string&, const epoch_context&) {}
+#endif
+}  // namespace ethash
+
 namespace
 {
 
+/// The number of light epoch contexts kept in the global cache: the previous,
+/// the current and the prefetched next epoch.
+constexpr size_t max_shared_contexts = 3;
+
 std::mutex shared_context_mutex;
-std::shared_ptr<epoch_context> shared_context;
+std::condition_variable shared_context_cv;
+std::vector<std::shared_ptr<epoch_context>> shared_contexts;  // Least recently used first.
+int prefetching_epoch = -1;
 thread_local std::shared_ptr<epoch_context> thread_local_context;
 
 std::mutex shared_context_full_mutex;
 std::shared_ptr<epoch_context_full> shared_context_full;
 thread_local std::shared_ptr<epoch_context_full> thread_local_context_full;
 
+std::mutex light_cache_dir_mutex;
+std::string light_cache_dir;
+
+std::string get_light_cache_dir()
+{
+    std::lock_guard<std::mutex> lock{light_cache_dir_mutex};
+    return light_cache_dir;
+}
+
+/// Creates a light epoch context, reusing the persisted light cache if any.
+std::shared_ptr<epoch_context> create_persisted_epoch_context(int epoch_number)
+{
+    const std::string dir = get_light_cache_dir();
+    if (dir.empty())
+        return create_epoch_context(epoch_number);
+
+    if (auto context = load_light_cache(dir, epoch_number))
+        return context;
+
+    auto context = create_epoch_context(epoch_number);
+    if (context)
+        store_light_cache(dir, *context);
+    return context;
+}
+
+/// Finds the epoch context in the global cache. Requires shared_context_mutex.
+std::vector<std::shared_ptr<epoch_context>>::iterator find_shared_context(int epoch_number)
+{
+    return std::find_if(shared_contexts.begin(), shared_contexts.end(),
+        [epoch_number](const std::shared_ptr<epoch_context>& context) {
+            return context->epoch_number == epoch_number;
+        });
+}
+
+/// Adds the epoch context to the global cache as the most recently used one,
+/// evicting the least recently used contexts. Requires shared_context_mutex.
+void insert_shared_context(std::shared_ptr<epoch_context> context)
+{
+    while (shared_contexts.size() >= max_shared_contexts)
+        shared_contexts.erase(shared_contexts.begin());
+    shared_contexts.push_back(std::move(context));
+}
+
 /// Update thread local epoch context.
 ///
 /// This function is on the slow path. It's separated to allow inlining the fast
 /// path.
-///
-/// @todo: Redesign to guarantee deallocation before new allocation.
 ATTRIBUTE_NOINLINE
 void update_local_context(int epoch_number)
 {
     // Release the shared pointer of the obsoleted context.
     thread_local_context.reset();
 
-    // Local context invalid, check the shared context.
-    std::lock_guard<std::mutex> lock{shared_context_mutex};
-    if (!shared_context || shared_context->epoch_number != epoch_number)
-    {
-        // Release the shared pointer of the obsoleted context.
-        shared_context.reset();
+    // Local context invalid, check the shared contexts. If the epoch is being
+    // prefetched wait for it rather than building it a second time.
+    std::unique_lock<std::mutex> lock{shared_context_mutex};
+    shared_context_cv.wait(lock, [epoch_number] { return prefetching_epoch != epoch_number; });
 
-        // Build new context.
-        shared_context = create_epoch_context(epoch_number);
+    auto it = find_shared_context(epoch_number);
+    if (it != shared_contexts.end())
+    {
+        // Mark as most recently used.
+        std::rotate(it, it + 1, shared_contexts.end());
+        thread_local_context = shared_contexts.back();
+        return;
     }
 
-    thread_local_context = shared_context;
+    // Map the persisted light cache or build new context.
+    auto context = create_persisted_epoch_context(epoch_number);
+    if (context)
+        insert_shared_context(context);
+    thread_local_context = std::move(context);
 }
 
 ATTRIBUTE_NOINLINE
@@ -79,6 +291,35 @@ void update_local_context_full(int epoch_number)
 }
 }  // namespace
 
+void ethash_set_light_cache_dir(const char* dir) noexcept
+{
+    std::lock_guard<std::mutex> lock{light_cache_dir_mutex};
+    light_cache_dir = dir ? dir : "";
+}
+
+bool ethash_prefetch_global_epoch_context(int epoch_number) noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock{shared_context_mutex};
+        if (prefetching_epoch >= 0 || find_shared_context(epoch_number) != shared_contexts.end())
+            return false;
+        prefetching_epoch = epoch_number;
+    }
+
+    // Build outside of the lock so threads using other epochs are not blocked.
+    auto context = create_persisted_epoch_context(epoch_number);
+
+    {
+        std::lock_guard<std::mutex> lock{shared_context_mutex};
+        if (context)
+            insert_shared_context(context);
+        prefetching_epoch = -1;
+    }
+    shared_context_cv.notify_all();
+
+    return context != nullptr;
+}
+
 const ethash_epoch_context* ethash_get_global_epoch_context(int epoch_number) noexcept
 {
     // Check if local context matches epoch number.
@@ -0,0 +1,194 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// AVX2 implementation of the ProgPoW lane kernel. The selectors of a round
+/// are the same for all lanes, so every operation is applied to 8 lanes at a
+/// time. This file is compiled with AVX2 enabled; progpow_kernel::autodetect()
+/// only selects it after checking the CPU and running the self test.
+
+#include "crypto/ethash/lib/ethash/progpow-kernel.hpp"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace progpow_kernel
+{
+namespace
+{
+constexpr size_t lanes_per_vector = 8;
+constexpr size_t num_vectors = num_lanes / lanes_per_vector;
+
+inline __m256i load(const uint32_t* p) noexcept
+{
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+inline void store(uint32_t* p, __m256i v) noexcept
+{
+    _mm256_store_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+inline __m256i rotl(__m256i a, __m256i c) noexcept
+{
+    const __m256i n = _mm256_and_si256(c, _mm256_set1_epi32(31));
+    const __m256i neg_n = _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), n),
+        _mm256_set1_epi32(31));
+    return _mm256_or_si256(_mm256_sllv_epi32(a, n), _mm256_srlv_epi32(a, neg_n));
+}
+
+inline __m256i rotr(__m256i a, __m256i c) noexcept
+{
+    const __m256i n = _mm256_and_si256(c, _mm256_set1_epi32(31));
+    const __m256i neg_n = _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), n),
+        _mm256_set1_epi32(31));
+    return _mm256_or_si256(_mm256_srlv_epi32(a, n), _mm256_sllv_epi32(a, neg_n));
+}
+
+inline __m256i mul_hi(__m256i a, __m256i b) noexcept
+{
+    // _mm256_mul_epu32 multiplies the even lanes into 64-bit products.
+    const __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+inline __m256i popcount(__m256i a) noexcept
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(a, low_mask));
+    const __m256i hi =
+        _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(a, 4), low_mask));
+    const __m256i bytes = _mm256_add_epi8(lo, hi);
+    // Sum the 4 byte counts of each 32-bit lane.
+    const __m256i pairs = _mm256_maddubs_epi16(bytes, _mm256_set1_epi8(1));
+    return _mm256_madd_epi16(pairs, _mm256_set1_epi16(1));
+}
+
+inline __m256i clz(__m256i a) noexcept
+{
+    // Smear the highest set bit to the right, then count the zeros left of it.
+    a = _mm256_or_si256(a, _mm256_srli_epi32(a, 1));
+    a = _mm256_or_si256(a, _mm256_srli_epi32(a, 2));
+    a = _mm256_or_si256(a, _mm256_srli_epi32(a, 4));
+    a = _mm256_or_si256(a, _mm256_srli_epi32(a, 8));
+    a = _mm256_or_si256(a, _mm256_srli_epi32(a, 16));
+    return _mm256_sub_epi32(_mm256_set1_epi32(32), popcount(a));
+}
+
+inline __m256i random_math(__m256i a, __m256i b, uint32_t selector) noexcept
+{
+    switch (selector % 11)
+    {
+    default:
+    case 0:
+        return _mm256_add_epi32(a, b);
+    case 1:
+        return _mm256_mullo_epi32(a, b);
+    case 2:
+        return mul_hi(a, b);
+    case 3:
+        return _mm256_min_epu32(a, b);
+    case 4:
+        return rotl(a, b);
+    case 5:
+        return rotr(a, b);
+    case 6:
+        return _mm256_and_si256(a, b);
+    case 7:
+        return _mm256_or_si256(a, b);
+    case 8:
+        return _mm256_xor_si256(a, b);
+    case 9:
+        return _mm256_add_epi32(clz(a), clz(b));
+    case 10:
+        return _mm256_add_epi32(popcount(a), popcount(b));
+    }
+}
+
+inline __m256i random_merge(__m256i a, __m256i b, uint32_t selector) noexcept
+{
+    const int x = static_cast<int>((selector >> 16) % 31 + 1);
+    const __m128i left = _mm_cvtsi32_si128(x);
+    const __m128i right = _mm_cvtsi32_si128(32 - x);
+    switch (selector % 4)
+    {
+    case 0:
+        return _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(a, 5), a), b);
+    case 1:
+    {
+        const __m256i t = _mm256_xor_si256(a, b);
+        return _mm256_add_epi32(_mm256_slli_epi32(t, 5), t);
+    }
+    case 2:
+        return _mm256_xor_si256(
+            _mm256_or_si256(_mm256_sll_epi32(a, left), _mm256_srl_epi32(a, right)), b);
+    default:
+        return _mm256_xor_si256(
+            _mm256_or_si256(_mm256_srl_epi32(a, left), _mm256_sll_epi32(a, right)), b);
+    }
+}
+}  // namespace
+
+void round_avx2(const program& prog, mix_regs& mix, const uint32_t* l1_cache,
+    const hash2048& item, uint32_t r) noexcept
+{
+    const int max_ops = std::max(prog.num_cache_accesses, prog.num_math_operations);
+    const __m256i l1_mask = _mm256_set1_epi32(l1_cache_num_items - 1);
+    static_assert((l1_cache_num_items & (l1_cache_num_items - 1)) == 0,
+        "l1 cache index uses a mask");
+
+    for (int i = 0; i < max_ops; ++i)
+    {
+        if (i < prog.num_cache_accesses)  // Random access to cached memory.
+        {
+            const uint32_t* src = mix.regs[prog.cache_src[i]];
+            uint32_t* dst = mix.regs[prog.cache_dst[i]];
+            for (size_t v = 0; v < num_vectors; ++v)
+            {
+                const size_t l = v * lanes_per_vector;
+                const __m256i offset = _mm256_and_si256(load(src + l), l1_mask);
+                const __m256i data = _mm256_i32gather_epi32(
+                    reinterpret_cast<const int*>(l1_cache), offset, sizeof(uint32_t));
+                store(dst + l, random_merge(load(dst + l), data, prog.cache_sel[i]));
+            }
+        }
+        if (i < prog.num_math_operations)  // Random math.
+        {
+            const uint32_t* src1 = mix.regs[prog.math_src1[i]];
+            const uint32_t* src2 = mix.regs[prog.math_src2[i]];
+            uint32_t* dst = mix.regs[prog.math_dst[i]];
+            for (size_t v = 0; v < num_vectors; ++v)
+            {
+                const size_t l = v * lanes_per_vector;
+                const __m256i data = random_math(load(src1 + l), load(src2 + l), prog.math_sel1[i]);
+                store(dst + l, random_merge(load(dst + l), data, prog.math_sel2[i]));
+            }
+        }
+    }
+
+    // DAG access. Lane l reads the words of item starting at ((l ^ r) % num_lanes) * 4.
+    static_assert(num_words_per_lane == 4, "item offsets are computed with a shift by 2");
+    const __m256i lane_ids = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i lane_mask = _mm256_set1_epi32(num_lanes - 1);
+    const __m256i round = _mm256_set1_epi32(static_cast<int>(r));
+    for (size_t v = 0; v < num_vectors; ++v)
+    {
+        const size_t l = v * lanes_per_vector;
+        const __m256i lanes = _mm256_add_epi32(lane_ids, _mm256_set1_epi32(static_cast<int>(l)));
+        const __m256i offset = _mm256_slli_epi32(
+            _mm256_and_si256(_mm256_xor_si256(lanes, round), lane_mask), 2);
+        for (size_t i = 0; i < num_words_per_lane; ++i)
+        {
+            const __m256i word = _mm256_i32gather_epi32(reinterpret_cast<const int*>(item.word32s),
+                _mm256_add_epi32(offset, _mm256_set1_epi32(static_cast<int>(i))), sizeof(uint32_t));
+            uint32_t* dst = mix.regs[prog.dag_dst[i]] + l;
+            store(dst, random_merge(load(dst), word, prog.dag_sel[i]));
+        }
+    }
+}
+}  // namespace progpow_kernel
@@ -0,0 +1,231 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+#include "crypto/ethash/lib/ethash/progpow-kernel.hpp"
+
+#include <crypto/ethash/include/ethash/ethash.h>
+
+#include "crypto/ethash/lib/ethash/bit_manipulation.h"
+#include "crypto/ethash/lib/ethash/endianness.hpp"
+#include "crypto/ethash/lib/ethash/kiss99.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace progpow_kernel
+{
+using ethash::le;
+
+namespace
+{
+NO_SANITIZE("unsigned-integer-overflow")
+inline uint32_t random_math(uint32_t a, uint32_t b, uint32_t selector) noexcept
+{
+    switch (selector % 11)
+    {
+    default:
+    case 0:
+        return a + b;
+    case 1:
+        return a * b;
+    case 2:
+        return mul_hi32(a, b);
+    case 3:
+        return std::min(a, b);
+    case 4:
+        return rotl32(a, b);
+    case 5:
+        return rotr32(a, b);
+    case 6:
+        return a & b;
+    case 7:
+        return a | b;
+    case 8:
+        return a ^ b;
+    case 9:
+        return clz32(a) + clz32(b);
+    case 10:
+        return popcount32(a) + popcount32(b);
+    }
+}
+
+/// Merge data from `b` and `a`.
+/// Assuming `a` has high entropy, only do ops that retain entropy even if `b`
+/// has low entropy (i.e. do not do `a & b`).
+NO_SANITIZE("unsigned-integer-overflow")
+inline void random_merge(uint32_t& a, uint32_t b, uint32_t selector) noexcept
+{
+    const auto x = (selector >> 16) % 31 + 1;  // Additional non-zero selector from higher bits.
+    switch (selector % 4)
+    {
+    case 0:
+        a = (a * 33) + b;
+        break;
+    case 1:
+        a = (a ^ b) * 33;
+        break;
+    case 2:
+        a = rotl32(a, x) ^ b;
+        break;
+    case 3:
+        a = rotr32(a, x) ^ b;
+        break;
+    }
+}
+
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+bool cpu_has_avx2() noexcept
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    // The OS must save the YMM registers on context switches.
+    if (((ecx >> 27) & 1) == 0)
+        return false;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6)
+        return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+
+/// Runs a few rounds of a program exercising every math and merge selector.
+void run_test_rounds(round_fn fn, uint32_t num_regs, int num_cache_accesses,
+    int num_math_operations, mix_regs& mix) noexcept
+{
+    kiss99 rng;
+
+    program prog;
+    prog.num_regs = num_regs;
+    prog.num_cache_accesses = num_cache_accesses;
+    prog.num_math_operations = num_math_operations;
+    for (int i = 0; i < max_operations; ++i)
+    {
+        prog.cache_src[i] = rng() % num_regs;
+        prog.cache_dst[i] = rng() % num_regs;
+        prog.cache_sel[i] = (rng() & 0xffff0000) | (i % 4);
+        prog.math_src1[i] = rng() % num_regs;
+        prog.math_src2[i] = (prog.math_src1[i] + 1 + rng() % (num_regs - 1)) % num_regs;
+        prog.math_sel1[i] = (rng() & 0xffff0000) | (i % 11);
+        prog.math_dst[i] = rng() % num_regs;
+        prog.math_sel2[i] = (rng() & 0xffff0000) | ((i + 1) % 4);
+    }
+    for (size_t i = 0; i < num_words_per_lane; ++i)
+    {
+        prog.dag_dst[i] = i == 0 ? 0 : rng() % num_regs;
+        prog.dag_sel[i] = rng();
+    }
+
+    uint32_t l1_cache[l1_cache_num_items];
+    for (auto& word : l1_cache)
+        word = rng();
+
+    hash2048 item;
+    for (auto& word : item.word32s)
+        word = rng();
+
+    // Include the edge cases of clz, popcount and the rotations.
+    for (uint32_t i = 0; i < max_regs; ++i)
+    {
+        for (size_t l = 0; l < num_lanes; ++l)
+            mix.regs[i][l] = rng();
+        mix.regs[i][i % num_lanes] = 0;
+        mix.regs[i][(i + 1) % num_lanes] = 0xffffffff;
+        mix.regs[i][(i + 2) % num_lanes] = 32 * i;
+    }
+
+    for (uint32_t r = 0; r < 2 * num_lanes; ++r)
+        fn(prog, mix, l1_cache, item, r);
+}
+}  // namespace
+
+void round_generic(const program& prog, mix_regs& mix, const uint32_t* l1_cache,
+    const hash2048& item, uint32_t r) noexcept
+{
+    const int max_ops = std::max(prog.num_cache_accesses, prog.num_math_operations);
+
+    for (int i = 0; i < max_ops; ++i)
+    {
+        if (i < prog.num_cache_accesses)  // Random access to cached memory.
+        {
+            const uint32_t* src = mix.regs[prog.cache_src[i]];
+            uint32_t* dst = mix.regs[prog.cache_dst[i]];
+            const uint32_t sel = prog.cache_sel[i];
+            for (size_t l = 0; l < num_lanes; ++l)
+            {
+                const size_t offset = src[l] % l1_cache_num_items;
+                random_merge(dst[l], le::uint32(l1_cache[offset]), sel);
+            }
+        }
+        if (i < prog.num_math_operations)  // Random math.
+        {
+            const uint32_t* src1 = mix.regs[prog.math_src1[i]];
+            const uint32_t* src2 = mix.regs[prog.math_src2[i]];
+            uint32_t* dst = mix.regs[prog.math_dst[i]];
+            const uint32_t sel1 = prog.math_sel1[i];
+            const uint32_t sel2 = prog.math_sel2[i];
+            for (size_t l = 0; l < num_lanes; ++l)
+            {
+                const uint32_t data = random_math(src1[l], src2[l], sel1);
+                random_merge(dst[l], data, sel2);
+            }
+        }
+    }
+
+    // DAG access.
+    for (size_t l = 0; l < num_lanes; ++l)
+    {
+        const auto offset = ((l ^ r) % num_lanes) * num_words_per_lane;
+        for (size_t i = 0; i < num_words_per_lane; ++i)
+        {
+            const auto word = le::uint32(item.word32s[offset + i]);
+            random_merge(mix.regs[prog.dag_dst[i]][l], word, prog.dag_sel[i]);
+        }
+    }
+}
+
+round_fn selected_round = round_generic;
+
+bool self_test(round_fn fn) noexcept
+{
+    for (const uint32_t num_regs : {16u, 32u})
+    {
+        const int num_cache_accesses = num_regs == 16 ? 6 : 11;
+        const int num_math_operations = num_regs == 16 ? 9 : 18;
+
+        mix_regs expected;
+        mix_regs actual;
+        run_test_rounds(round_generic, num_regs, num_cache_accesses, num_math_operations, expected);
+        run_test_rounds(fn, num_regs, num_cache_accesses, num_math_operations, actual);
+        if (std::memcmp(&expected, &actual, sizeof(expected)) != 0)
+            return false;
+    }
+    return true;
+}
+
+const char* autodetect() noexcept
+{
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    if (cpu_has_avx2() && self_test(round_avx2))
+    {
+        selected_round = round_avx2;
+        return "avx2";
+    }
+#endif
+
+    selected_round = round_generic;
+    return "generic";
+}
+}  // namespace progpow_kernel
+
+const char* ethash_progpow_autodetect() noexcept
+{
+    return progpow_kernel::autodetect();
+}
@@ -0,0 +1,80 @@
+// ethash: C/C++ implementation of Ethash, the Ethereum Proof of Work algorithm.
+// Copyright 2018-2019 Pawel Bylica.
+// Licensed under the Apache License, Version 2.0.
+
+/// @file
+/// The lane kernel shared by ProgPoW (KAWPOW) and MeowPoW.
+///
+/// The random program of a ProgPoW round only depends on the period, so it is
+/// decoded once per hash and then executed for all 64 rounds on the 16 lanes.
+/// The lanes are stored register-major so that one register of all lanes is
+/// contiguous in memory and can be processed with SIMD instructions.
+
+#pragma once
+
+#include <crypto/ethash/include/ethash/hash_types.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace progpow_kernel
+{
+using ethash::hash2048;
+
+constexpr size_t num_lanes = 16;
+constexpr uint32_t max_regs = 32;
+constexpr int max_operations = 18;
+constexpr size_t num_words_per_lane = sizeof(hash2048) / (sizeof(uint32_t) * num_lanes);
+constexpr uint32_t l1_cache_num_items = 16 * 1024 / sizeof(uint32_t);
+
+/// The decoded random program of a round.
+struct program
+{
+    uint32_t num_regs;
+    int num_cache_accesses;
+    int num_math_operations;
+
+    uint32_t cache_src[max_operations];
+    uint32_t cache_dst[max_operations];
+    uint32_t cache_sel[max_operations];
+
+    uint32_t math_src1[max_operations];
+    uint32_t math_src2[max_operations];
+    uint32_t math_sel1[max_operations];
+    uint32_t math_dst[max_operations];
+    uint32_t math_sel2[max_operations];
+
+    uint32_t dag_dst[num_words_per_lane];
+    uint32_t dag_sel[num_words_per_lane];
+};
+
+/// The mix registers of all lanes, mix.regs[register][lane].
+struct alignas(64) mix_regs
+{
+    uint32_t regs[max_regs][num_lanes];
+};
+
+using round_fn = void (*)(const program& prog, mix_regs& mix, const uint32_t* l1_cache,
+    const hash2048& item, uint32_t r) noexcept;
+
+/// The portable reference implementation of a round.
+void round_generic(const program& prog, mix_regs& mix, const uint32_t* l1_cache,
+    const hash2048& item, uint32_t r) noexcept;
+
+#if defined(ENABLE_AVX2)
+/// A round processing 8 lanes per AVX2 instruction. Only call it after
+/// checking the CPU supports AVX2.
+void round_avx2(const program& prog, mix_regs& mix, const uint32_t* l1_cache,
+    const hash2048& item, uint32_t r) noexcept;
+#endif
+
+/// The round implementation in use, round_generic() until autodetect() runs.
+extern round_fn selected_round;
+
+/// Selects the fastest round implementation the CPU supports, checks it
+/// against round_generic() and returns its name.
+const char* autodetect() noexcept;
+
+/// Returns whether `fn` computes the same rounds as round_generic().
+bool self_test(round_fn fn) noexcept;
+}  // namespace progpow_kernel
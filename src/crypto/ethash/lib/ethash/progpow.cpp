@@ -8,6 +8,7 @@
 #include "crypto/ethash/lib/ethash/endianness.hpp"
 #include "crypto/ethash/lib/ethash/ethash-internal.hpp"
 #include "crypto/ethash/lib/ethash/kiss99.hpp"
+#include "crypto/ethash/lib/ethash/progpow-kernel.hpp"
 #include <crypto/ethash/include/ethash/keccak.hpp>
 
 #include <array>
@@ -88,61 +89,6 @@ mix_rng_state::mix_rng_state(uint32_t* hash_seed) noexcept
 }
 
 
-NO_SANITIZE("unsigned-integer-overflow")
-inline uint32_t random_math(uint32_t a, uint32_t b, uint32_t selector) noexcept
-{
-    switch (selector % 11)
-    {
-    default:
-    case 0:
-        return a + b;
-    case 1:
-        return a * b;
-    case 2:
-        return mul_hi32(a, b);
-    case 3:
-        return std::min(a, b);
-    case 4:
-        return rotl32(a, b);
-    case 5:
-        return rotr32(a, b);
-    case 6:
-        return a & b;
-    case 7:
-        return a | b;
-    case 8:
-        return a ^ b;
-    case 9:
-        return clz32(a) + clz32(b);
-    case 10:
-        return popcount32(a) + popcount32(b);
-    }
-}
-
-/// Merge data from `b` and `a`.
-/// Assuming `a` has high entropy, only do ops that retain entropy even if `b`
-/// has low entropy (i.e. do not do `a & b`).
-NO_SANITIZE("unsigned-integer-overflow")
-inline void random_merge(uint32_t& a, uint32_t b, uint32_t selector) noexcept
-{
-    const auto x = (selector >> 16) % 31 + 1;  // Additional non-zero selector from higher bits.
-    switch (selector % 4)
-    {
-    case 0:
-        a = (a * 33) + b;
-        break;
-    case 1:
-        a = (a ^ b) * 33;
-        break;
-    case 2:
-        a = rotl32(a, x) ^ b;
-        break;
-    case 3:
-        a = rotr32(a, x) ^ b;
-        break;
-    }
-}
-
 static const uint32_t round_constants[22] = {
         0x00000001,0x00008082,0x0000808A,
         0x80008000,0x0000808B,0x80000001,
@@ -174,35 +120,32 @@ static const uint32_t meowcoin_kawpow[15] = {
 
 using lookup_fn = hash2048 (*)(const epoch_context&, uint32_t);
 
-using mix_array = std::array<std::array<uint32_t, num_regs>, num_lanes>;
+using progpow_kernel::mix_regs;
 
-void round(
-    const epoch_context& context, uint32_t r, mix_array& mix, mix_rng_state state, lookup_fn lookup)
+/// Decodes the random program of a round. The program only depends on the
+/// period, every round of a hash starts from the same RNG state.
+progpow_kernel::program build_program(mix_rng_state state) noexcept
 {
-    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
-    const uint32_t item_index = mix[r % num_lanes][0] % num_items;
-    const hash2048 item = lookup(context, item_index);
+    progpow_kernel::program prog;
+    prog.num_regs = num_regs;
+    prog.num_cache_accesses = num_cache_accesses;
+    prog.num_math_operations = num_math_operations;
 
-    constexpr size_t num_words_per_lane = sizeof(item) / (sizeof(uint32_t) * num_lanes);
     constexpr int max_operations =
         num_cache_accesses > num_math_operations ? num_cache_accesses : num_math_operations;
+    static_assert(max_operations <= progpow_kernel::max_operations, "program too long");
+    static_assert(num_regs <= progpow_kernel::max_regs, "too many registers");
+    static_assert(num_lanes == progpow_kernel::num_lanes, "lane count mismatch");
 
-    // Process lanes.
     for (int i = 0; i < max_operations; ++i)
     {
-        if (i < num_cache_accesses)  // Random access to cached memory.
+        if (i < num_cache_accesses)
         {
-            const auto src = state.next_src();
-            const auto dst = state.next_dst();
-            const auto sel = state.rng();
-
-            for (size_t l = 0; l < num_lanes; ++l)
-            {
-                const size_t offset = mix[l][src] % l1_cache_num_items;
-                random_merge(mix[l][dst], le::uint32(context.l1_cache[offset]), sel);
-            }
+            prog.cache_src[i] = state.next_src();
+            prog.cache_dst[i] = state.next_dst();
+            prog.cache_sel[i] = state.rng();
         }
-        if (i < num_math_operations)  // Random math.
+        if (i < num_math_operations)
         {
             // Generate 2 unique source indexes.
             const auto src_rnd = state.rng() % (num_regs * (num_regs - 1));
@@ -211,69 +154,62 @@ void round(
             if (src2 >= src1)
                 ++src2;
 
-            const auto sel1 = state.rng();
-            const auto dst = state.next_dst();
-            const auto sel2 = state.rng();
-
-            for (size_t l = 0; l < num_lanes; ++l)
-            {
-                const uint32_t data = random_math(mix[l][src1], mix[l][src2], sel1);
-                random_merge(mix[l][dst], data, sel2);
-            }
+            prog.math_src1[i] = src1;
+            prog.math_src2[i] = src2;
+            prog.math_sel1[i] = state.rng();
+            prog.math_dst[i] = state.next_dst();
+            prog.math_sel2[i] = state.rng();
         }
     }
 
     // DAG access pattern.
-    uint32_t dsts[num_words_per_lane];
-    uint32_t sels[num_words_per_lane];
-    for (size_t i = 0; i < num_words_per_lane; ++i)
+    for (size_t i = 0; i < progpow_kernel::num_words_per_lane; ++i)
     {
-        dsts[i] = i == 0 ? 0 : state.next_dst();
-        sels[i] = state.rng();
+        prog.dag_dst[i] = i == 0 ? 0 : state.next_dst();
+        prog.dag_sel[i] = state.rng();
     }
+    return prog;
+}
 
-    // DAG access.
-    for (size_t l = 0; l < num_lanes; ++l)
-    {
-        const auto offset = ((l ^ r) % num_lanes) * num_words_per_lane;
-        for (size_t i = 0; i < num_words_per_lane; ++i)
-        {
-            const auto word = le::uint32(item.word32s[offset + i]);
-            random_merge(mix[l][dsts[i]], word, sels[i]);
-        }
-    }
+void round(const epoch_context& context, uint32_t r, mix_regs& mix,
+    const progpow_kernel::program& prog, lookup_fn lookup)
+{
+    const uint32_t num_items = static_cast<uint32_t>(context.full_dataset_num_items / 2);
+    const uint32_t item_index = mix.regs[0][r % num_lanes] % num_items;
+    const hash2048 item = lookup(context, item_index);
+
+    progpow_kernel::selected_round(prog, mix, context.l1_cache, item, r);
 }
 
-mix_array init_mix(uint32_t* hash_seed)
+void init_mix(uint32_t* hash_seed, mix_regs& mix)
 {
     const uint32_t z = fnv1a(fnv_offset_basis, static_cast<uint32_t>(hash_seed[0]));
     const uint32_t w = fnv1a(z, static_cast<uint32_t>(hash_seed[1]));
 
-    mix_array mix;
-    for (uint32_t l = 0; l < mix.size(); ++l)
+    for (uint32_t l = 0; l < num_lanes; ++l)
     {
         const uint32_t jsr = fnv1a(w, l);
         const uint32_t jcong = fnv1a(jsr, l);
         kiss99 rng{z, w, jsr, jcong};
 
-        for (auto& row : mix[l])
-            row = rng();
+        for (uint32_t i = 0; i < num_regs; ++i)
+            mix.regs[i][l] = rng();
     }
-    return mix;
 }
 
 hash256 hash_mix(
     const epoch_context& context, int block_number, uint32_t * seed, lookup_fn lookup) noexcept
 {
-    auto mix = init_mix(seed);
+    mix_regs mix;
+    init_mix(seed, mix);
     auto number = uint64_t(block_number / period_length);
     uint32_t new_state[2];
     new_state[0] = number;
     new_state[1] = number >> 32;
-    mix_rng_state state{new_state};
+    const progpow_kernel::program prog = build_program(mix_rng_state{new_state});
 
     for (uint32_t i = 0; i < 64; ++i)
-        round(context, i, mix, state, lookup);
+        round(context, i, mix, prog, lookup);
 
     // Reduce mix data to a single per-lane result.
     uint32_t lane_hash[num_lanes];
@@ -281,7 +217,7 @@ hash256 hash_mix(
     {
         lane_hash[l] = fnv_offset_basis;
         for (uint32_t i = 0; i < num_regs; ++i)
-            lane_hash[l] = fnv1a(lane_hash[l], mix[l][i]);
+            lane_hash[l] = fnv1a(lane_hash[l], mix.regs[i][l]);
     }
 
     // Reduce all lanes to a single 256-bit result.
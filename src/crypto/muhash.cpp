@@ -0,0 +1,279 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Copyright (c) 2017-2019 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/chacha20.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <limits>
+
+namespace {
+
+typedef Num3072::limb_t limb_t;
+typedef Num3072::double_limb_t double_limb_t;
+const int LIMBS = Num3072::LIMBS;
+const int LIMB_SIZE = Num3072::LIMB_SIZE;
+/** 2^3072 - 1103717 is the largest 3072-bit safe prime. */
+const limb_t MAX_PRIME_DIFF = 1103717;
+
+/** Extract the lowest limb of [c0,c1,c2] into n, and shift the number right by one limb. */
+inline void extract3(limb_t& c0, limb_t& c1, limb_t& c2, limb_t& n)
+{
+    n = c0;
+    c0 = c1;
+    c1 = c2;
+    c2 = 0;
+}
+
+/** [c0,c1] = a * b */
+inline void mul(limb_t& c0, limb_t& c1, const limb_t& a, const limb_t& b)
+{
+    double_limb_t t = (double_limb_t)a * b;
+    c1 = t >> LIMB_SIZE;
+    c0 = t;
+}
+
+/** [c0,c1,c2] += n * [d0,d1,d2]. c2 is 0 initially. */
+inline void mulnadd3(limb_t& c0, limb_t& c1, limb_t& c2, limb_t& d0, limb_t& d1, limb_t& d2, const limb_t& n)
+{
+    double_limb_t t = (double_limb_t)d0 * n + c0;
+    c0 = t;
+    t >>= LIMB_SIZE;
+    t += (double_limb_t)d1 * n + c1;
+    c1 = t;
+    t >>= LIMB_SIZE;
+    c2 = t + d2 * n;
+}
+
+/** [low,high] *= n */
+inline void muln2(limb_t& low, limb_t& high, const limb_t& n)
+{
+    double_limb_t t = (double_limb_t)low * n;
+    low = t;
+    t >>= LIMB_SIZE;
+    t += (double_limb_t)high * n;
+    high = t;
+}
+
+/** [c0,c1,c2] += a * b */
+inline void muladd3(limb_t& c0, limb_t& c1, limb_t& c2, const limb_t& a, const limb_t& b)
+{
+    double_limb_t t = (double_limb_t)a * b;
+    limb_t th = t >> LIMB_SIZE;
+    limb_t tl = t;
+
+    c0 += tl;
+    th += (c0 < tl) ? 1 : 0;
+    c1 += th;
+    c2 += (c1 < th) ? 1 : 0;
+}
+
+/** Add a to [c0,c1], then extract the lowest limb into n and shift the number right by one limb. */
+inline void addnextract2(limb_t& c0, limb_t& c1, const limb_t& a, limb_t& n)
+{
+    limb_t c2 = 0;
+
+    c0 += a;
+    if (c0 < a) {
+        c1 += 1;
+        if (c1 == 0) c2 = 1;
+    }
+
+    n = c0;
+    c0 = c1;
+    c1 = c2;
+}
+
+} // namespace
+
+Num3072::Num3072(const unsigned char* data)
+{
+    for (int i = 0; i < LIMBS; ++i) {
+#ifdef __SIZEOF_INT128__
+        limbs[i] = ReadLE64(data + 8 * i);
+#else
+        limbs[i] = ReadLE32(data + 4 * i);
+#endif
+    }
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; ++i) limbs[i] = 0;
+}
+
+/** Whether the number is at least the modulus, i.e. not fully reduced. */
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF) return false;
+    for (int i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != std::numeric_limits<limb_t>::max()) return false;
+    }
+    return true;
+}
+
+/** Subtract the modulus, by adding MAX_PRIME_DIFF and dropping the carry. */
+void Num3072::FullReduce()
+{
+    limb_t c0 = MAX_PRIME_DIFF;
+    limb_t c1 = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        addnextract2(c0, c1, limbs[i], limbs[i]);
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    limb_t c0 = 0, c1 = 0, c2 = 0;
+    Num3072 tmp;
+
+    // Compute limbs 0..N-2 of this*a into tmp, folding the limbs above 3072
+    // bits back in, as 2^3072 == MAX_PRIME_DIFF.
+    for (int j = 0; j < LIMBS - 1; ++j) {
+        limb_t d0 = 0, d1 = 0, d2 = 0;
+        mul(d0, d1, limbs[1 + j], a.limbs[LIMBS + j - (1 + j)]);
+        for (int i = 2 + j; i < LIMBS; ++i) muladd3(d0, d1, d2, limbs[i], a.limbs[LIMBS + j - i]);
+        mulnadd3(c0, c1, c2, d0, d1, d2, MAX_PRIME_DIFF);
+        for (int i = 0; i < j + 1; ++i) muladd3(c0, c1, c2, limbs[i], a.limbs[j - i]);
+        extract3(c0, c1, c2, tmp.limbs[j]);
+    }
+
+    // Compute limb N-1 of this*a into tmp.
+    assert(c2 == 0);
+    for (int i = 0; i < LIMBS; ++i) muladd3(c0, c1, c2, limbs[i], a.limbs[LIMBS - 1 - i]);
+    extract3(c0, c1, c2, tmp.limbs[LIMBS - 1]);
+
+    // Fold the remaining carry back in.
+    muln2(c0, c1, MAX_PRIME_DIFF);
+    for (int j = 0; j < LIMBS; ++j) {
+        addnextract2(c0, c1, tmp.limbs[j], limbs[j]);
+    }
+
+    assert(c1 == 0);
+    assert(c0 == 0 || c0 == 1);
+
+    // Up to two more reductions, if the result is not below the modulus or
+    // the addition above overflowed.
+    if (IsOverflow()) FullReduce();
+    if (c0) FullReduce();
+}
+
+/** Compute this^(p-2) mod p, which is the inverse of this by Fermat's little theorem. */
+Num3072 Num3072::GetInverse() const
+{
+    // The exponent p - 2 = 2^3072 - MAX_PRIME_DIFF - 2, processed 4 bits at a time.
+    limb_t exponent[LIMBS];
+    exponent[0] = std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF - 1;
+    for (int i = 1; i < LIMBS; ++i) exponent[i] = std::numeric_limits<limb_t>::max();
+
+    Num3072 powers[16];
+    powers[1] = *this;
+    for (int i = 2; i < 16; ++i) {
+        powers[i] = powers[i - 1];
+        powers[i].Multiply(*this);
+    }
+
+    Num3072 out;
+    for (int bit = LIMBS * LIMB_SIZE - 4; bit >= 0; bit -= 4) {
+        for (int i = 0; i < 4; ++i) {
+            Num3072 square = out;
+            out.Multiply(square);
+        }
+        const int window = (exponent[bit / LIMB_SIZE] >> (bit % LIMB_SIZE)) & 15;
+        if (window) out.Multiply(powers[window]);
+    }
+    return out;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    if (IsOverflow()) FullReduce();
+
+    Num3072 b = a;
+    if (b.IsOverflow()) b.FullReduce();
+    Multiply(b.GetInverse());
+
+    if (IsOverflow()) FullReduce();
+}
+
+void Num3072::ToBytes(unsigned char* out)
+{
+    if (IsOverflow()) FullReduce();
+    for (int i = 0; i < LIMBS; ++i) {
+#ifdef __SIZEOF_INT128__
+        WriteLE64(out + 8 * i, limbs[i]);
+#else
+        WriteLE32(out + 4 * i, limbs[i]);
+#endif
+    }
+}
+
+bool Num3072::operator==(const Num3072& other) const
+{
+    return memcmp(limbs, other.limbs, sizeof(limbs)) == 0;
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char key[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(key);
+    unsigned char stream[Num3072::BYTE_SIZE];
+    ChaCha20(key, sizeof(key)).Output(stream, sizeof(stream));
+    return Num3072(stream);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char hash[32])
+{
+    numerator.Divide(denominator);
+    denominator.SetToOne();
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    numerator.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(hash);
+}
+
+void MuHash3072::ToBytes(unsigned char* out)
+{
+    numerator.ToBytes(out);
+    denominator.ToBytes(out + Num3072::BYTE_SIZE);
+}
+
+void MuHash3072::FromBytes(const unsigned char* data)
+{
+    numerator = Num3072(data);
+    denominator = Num3072(data + Num3072::BYTE_SIZE);
+}
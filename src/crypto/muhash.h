@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Copyright (c) 2017-2019 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEOWCOIN_CRYPTO_MUHASH_H
+#define MEOWCOIN_CRYPTO_MUHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** A number modulo the prime 2^3072 - 1103717. */
+class Num3072
+{
+public:
+#ifdef __SIZEOF_INT128__
+    typedef unsigned __int128 double_limb_t;
+    typedef uint64_t limb_t;
+    static const int LIMBS = 48;
+    static const int LIMB_SIZE = 64;
+#else
+    typedef uint64_t double_limb_t;
+    typedef uint32_t limb_t;
+    static const int LIMBS = 96;
+    static const int LIMB_SIZE = 32;
+#endif
+    static const size_t BYTE_SIZE = 384;
+
+    limb_t limbs[LIMBS];
+
+    Num3072() { SetToOne(); }
+    /** Read a little-endian number of BYTE_SIZE bytes. */
+    explicit Num3072(const unsigned char* data);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    /** Write the fully reduced number as BYTE_SIZE little-endian bytes. */
+    void ToBytes(unsigned char* out);
+
+    bool operator==(const Num3072& other) const;
+
+private:
+    bool IsOverflow() const;
+    void FullReduce();
+    Num3072 GetInverse() const;
+};
+
+/**
+ * A rolling hash of a multiset of byte strings, the MuHash3072 construction.
+ *
+ * Every element is hashed to a number modulo a 3072-bit prime and the hash of
+ * the set is the product of those numbers, so elements can be added and
+ * removed in any order, and the hashes of two sets can be combined. Removals
+ * are collected in a separate denominator, so that only Finalize() has to
+ * compute a modular inverse.
+ *
+ * The state of an object (see ToBytes()) depends on the order of its
+ * operations; Finalize() does not.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    static const size_t SERIALIZED_SIZE = 2 * Num3072::BYTE_SIZE;
+
+    /** The hash of the empty set. */
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    /** Add or remove all elements of another set. */
+    MuHash3072& operator*=(const MuHash3072& mul);
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** Compute the 32-byte hash of the set. This normalizes the state. */
+    void Finalize(unsigned char hash[32]);
+
+    /** Save and restore the state, SERIALIZED_SIZE bytes. */
+    void ToBytes(unsigned char* out);
+    void FromBytes(const unsigned char* data);
+};
+
+#endif // MEOWCOIN_CRYPTO_MUHASH_H
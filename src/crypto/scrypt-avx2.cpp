@@ -0,0 +1,184 @@
+/*
+ * Copyright 2009 Colin Percival, 2011 ArtForz, 2012-2013 pooler
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file was originally written by Colin Percival as part of the Tarsnap
+ * online backup system.
+ */
+
+/*
+ * Multi-lane scrypt(1024, 1, 1) using AVX2. Every 256-bit register holds the
+ * same four words of two independent hashes, one per 128-bit half, in the
+ * layout of scrypt-sse2.cpp, so the in-lane shuffles of the SSE2 salsa20/8
+ * work unchanged. Two such pairs are interleaved to hide the latency of the
+ * random scratchpad reads. This file is compiled with AVX2_CXXFLAGS;
+ * scrypt_detect_batch() only selects it after checking the CPU.
+ */
+
+#if defined(ENABLE_AVX2)
+
+#include <crypto/scrypt.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <immintrin.h>
+
+#define ROTL_AVX2(x, n) _mm256_xor_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+/* One quarter step of salsa20/8 on every pair: a ^= ROTL(b + c, n). */
+#define SALSA_STEP(a, b, c, n) \
+	for (p = 0; p < P; p++) \
+		a[p] = _mm256_xor_si256(a[p], ROTL_AVX2(_mm256_add_epi32(b[p], c[p]), n))
+
+#define SALSA_SHUFFLE(x, imm) \
+	for (p = 0; p < P; p++) \
+		x[p] = _mm256_shuffle_epi32(x[p], imm)
+
+template<int P>
+static inline __attribute__((always_inline)) void xor_salsa8_avx2(__m256i B[][8], int b, int bx)
+{
+	__m256i X0[P], X1[P], X2[P], X3[P];
+	int i, p;
+
+	for (p = 0; p < P; p++) {
+		X0[p] = B[p][b + 0] = _mm256_xor_si256(B[p][b + 0], B[p][bx + 0]);
+		X1[p] = B[p][b + 1] = _mm256_xor_si256(B[p][b + 1], B[p][bx + 1]);
+		X2[p] = B[p][b + 2] = _mm256_xor_si256(B[p][b + 2], B[p][bx + 2]);
+		X3[p] = B[p][b + 3] = _mm256_xor_si256(B[p][b + 3], B[p][bx + 3]);
+	}
+
+	for (i = 0; i < 8; i += 2) {
+		/* Operate on "columns". */
+		SALSA_STEP(X1, X0, X3, 7);
+		SALSA_STEP(X2, X1, X0, 9);
+		SALSA_STEP(X3, X2, X1, 13);
+		SALSA_STEP(X0, X3, X2, 18);
+
+		/* Rearrange data. */
+		SALSA_SHUFFLE(X1, 0x93);
+		SALSA_SHUFFLE(X2, 0x4E);
+		SALSA_SHUFFLE(X3, 0x39);
+
+		/* Operate on "rows". */
+		SALSA_STEP(X3, X0, X1, 7);
+		SALSA_STEP(X2, X3, X0, 9);
+		SALSA_STEP(X1, X2, X3, 13);
+		SALSA_STEP(X0, X1, X2, 18);
+
+		/* Rearrange data. */
+		SALSA_SHUFFLE(X1, 0x39);
+		SALSA_SHUFFLE(X2, 0x4E);
+		SALSA_SHUFFLE(X3, 0x93);
+	}
+
+	for (p = 0; p < P; p++) {
+		B[p][b + 0] = _mm256_add_epi32(B[p][b + 0], X0[p]);
+		B[p][b + 1] = _mm256_add_epi32(B[p][b + 1], X1[p]);
+		B[p][b + 2] = _mm256_add_epi32(B[p][b + 2], X2[p]);
+		B[p][b + 3] = _mm256_add_epi32(B[p][b + 3], X3[p]);
+	}
+}
+
+/* Hash 2 * P consecutive 80-byte inputs, using 2 * P * 128 KiB of scratchpad. */
+template<int P>
+static void scrypt_1024_1_1_256_sp_avx2(const char *input, char *output, char *scratchpad)
+{
+	uint8_t B[128];
+	uint32_t W[2][32];
+	__m256i X[P][8];
+	__m256i *V[P];
+	uint32_t i, j0, j1, k;
+	int p, h;
+
+	V[0] = (__m256i *)(((uintptr_t)(scratchpad) + 63) & ~ (uintptr_t)(63));
+	for (p = 1; p < P; p++)
+		V[p] = V[p - 1] + 1024 * 8;
+
+	for (p = 0; p < P; p++) {
+		for (h = 0; h < 2; h++) {
+			const uint8_t *in = (const uint8_t *)input + 80 * (2 * p + h);
+			PBKDF2_SHA256(in, 80, in, 80, 1, B, 128);
+			for (k = 0; k < 2; k++) {
+				for (i = 0; i < 16; i++) {
+					W[h][k * 16 + i] = le32dec(&B[(k * 16 + (i * 5 % 16)) * 4]);
+				}
+			}
+		}
+		for (k = 0; k < 8; k++) {
+			X[p][k] = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)&W[0][4 * k])),
+				_mm_loadu_si128((const __m128i *)&W[1][4 * k]), 1);
+		}
+	}
+
+	for (i = 0; i < 1024; i++) {
+		for (p = 0; p < P; p++) {
+			for (k = 0; k < 8; k++)
+				V[p][i * 8 + k] = X[p][k];
+		}
+		xor_salsa8_avx2<P>(X, 0, 4);
+		xor_salsa8_avx2<P>(X, 4, 0);
+	}
+	for (i = 0; i < 1024; i++) {
+		for (p = 0; p < P; p++) {
+			/* Word 16 of each hash selects its own scratchpad entry. */
+			j0 = 8 * (_mm256_extract_epi32(X[p][4], 0) & 1023);
+			j1 = 8 * (_mm256_extract_epi32(X[p][4], 4) & 1023);
+			for (k = 0; k < 8; k++)
+				X[p][k] = _mm256_xor_si256(X[p][k], _mm256_blend_epi32(V[p][j0 + k], V[p][j1 + k], 0xF0));
+		}
+		xor_salsa8_avx2<P>(X, 0, 4);
+		xor_salsa8_avx2<P>(X, 4, 0);
+	}
+
+	for (p = 0; p < P; p++) {
+		for (k = 0; k < 8; k++) {
+			_mm_storeu_si128((__m128i *)&W[0][4 * k], _mm256_castsi256_si128(X[p][k]));
+			_mm_storeu_si128((__m128i *)&W[1][4 * k], _mm256_extracti128_si256(X[p][k], 1));
+		}
+		for (h = 0; h < 2; h++) {
+			const uint8_t *in = (const uint8_t *)input + 80 * (2 * p + h);
+			for (k = 0; k < 2; k++) {
+				for (i = 0; i < 16; i++) {
+					le32enc(&B[(k * 16 + (i * 5 % 16)) * 4], W[h][k * 16 + i]);
+				}
+			}
+			PBKDF2_SHA256(in, 80, B, 128, 1, (uint8_t *)output + 32 * (2 * p + h), 32);
+		}
+	}
+}
+
+void scrypt_1024_1_1_256_sp_avx2_2way(const char *input, char *output, char *scratchpad)
+{
+	scrypt_1024_1_1_256_sp_avx2<1>(input, output, scratchpad);
+}
+
+void scrypt_1024_1_1_256_sp_avx2_4way(const char *input, char *output, char *scratchpad)
+{
+	scrypt_1024_1_1_256_sp_avx2<2>(input, output, scratchpad);
+}
+
+#endif // ENABLE_AVX2
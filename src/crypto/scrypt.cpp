@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <memory>
 #include <openssl/sha.h>
 
 #if defined(USE_SSE2) && !defined(USE_SSE2_ALWAYS)
@@ -43,6 +44,13 @@
 #include <cpuid.h>
 #endif
 #endif
+
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#define USE_SCRYPT_AVX2 1
+void scrypt_1024_1_1_256_sp_avx2_2way(const char *input, char *output, char *scratchpad);
+void scrypt_1024_1_1_256_sp_avx2_4way(const char *input, char *output, char *scratchpad);
+#endif
 #ifndef __FreeBSD__
 static inline uint32_t be32dec(const void *pp)
 {
@@ -326,8 +334,97 @@ std::string scrypt_detect_sse2()
 }
 #endif
 
+/*
+ * The scratchpad of the calling thread, large enough for the widest batch
+ * kernel. It is allocated on first use and then reused, so threads that never
+ * hash do not pay for it.
+ */
+static char *scrypt_thread_scratchpad()
+{
+	static thread_local std::unique_ptr<char[]> scratchpad;
+	if (!scratchpad)
+		scratchpad.reset(new char[SCRYPT_BATCH_MAX_WAYS * 131072 + 63]);
+	return scratchpad.get();
+}
+
+// The multi-lane kernels, null until scrypt_detect_batch() selects them.
+static void (*scrypt_1024_1_1_256_sp_2way)(const char *input, char *output, char *scratchpad) = nullptr;
+static void (*scrypt_1024_1_1_256_sp_4way)(const char *input, char *output, char *scratchpad) = nullptr;
+
+#if defined(USE_SCRYPT_AVX2)
+static bool scrypt_cpu_has_avx2()
+{
+	uint32_t eax, ebx, ecx, edx;
+	if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	// The OS must save the YMM registers on context switches.
+	if (((ecx >> 27) & 1) == 0)
+		return false;
+	uint32_t xcr0_lo, xcr0_hi;
+	__asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+	if ((xcr0_lo & 6) != 6)
+		return false;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx >> 5) & 1;
+}
+
+/* Check that the multi-lane kernels hash like the generic code. */
+static bool scrypt_batch_self_test()
+{
+	char input[4 * 80], expected[4 * 32], output[4 * 32];
+	char *scratchpad = scrypt_thread_scratchpad();
+	for (int i = 0; i < (int)sizeof(input); i++)
+		input[i] = (char)(i * 7 + i / 80);
+	for (int i = 0; i < 4; i++)
+		scrypt_1024_1_1_256_sp_generic(input + 80 * i, expected + 32 * i, scratchpad);
+	if (scrypt_1024_1_1_256_sp_4way) {
+		memset(output, 0, sizeof(output));
+		scrypt_1024_1_1_256_sp_4way(input, output, scratchpad);
+		if (memcmp(output, expected, sizeof(output)))
+			return false;
+	}
+	if (scrypt_1024_1_1_256_sp_2way) {
+		memset(output, 0, sizeof(output));
+		scrypt_1024_1_1_256_sp_2way(input, output, scratchpad);
+		scrypt_1024_1_1_256_sp_2way(input + 160, output + 64, scratchpad);
+		if (memcmp(output, expected, sizeof(output)))
+			return false;
+	}
+	return true;
+}
+#endif
+
+std::string scrypt_detect_batch()
+{
+#if defined(USE_SCRYPT_AVX2)
+	if (scrypt_cpu_has_avx2()) {
+		scrypt_1024_1_1_256_sp_2way = &scrypt_1024_1_1_256_sp_avx2_2way;
+		scrypt_1024_1_1_256_sp_4way = &scrypt_1024_1_1_256_sp_avx2_4way;
+		if (scrypt_batch_self_test())
+			return "scrypt: using avx2 2-way and 4-way batch kernels";
+	}
+#endif
+	scrypt_1024_1_1_256_sp_2way = nullptr;
+	scrypt_1024_1_1_256_sp_4way = nullptr;
+	return "scrypt: no batch kernel, hashing one input at a time";
+}
+
 void scrypt_1024_1_1_256(const char *input, char *output)
 {
-	char scratchpad[SCRYPT_SCRATCHPAD_SIZE];
-    scrypt_1024_1_1_256_sp(input, output, scratchpad);
+	scrypt_1024_1_1_256_sp(input, output, scrypt_thread_scratchpad());
+}
+
+void scrypt_1024_1_1_256_batch(const char *input, char *output, size_t count)
+{
+	char *scratchpad = scrypt_thread_scratchpad();
+	if (scrypt_1024_1_1_256_sp_4way) {
+		for (; count >= 4; count -= 4, input += 4 * 80, output += 4 * 32)
+			scrypt_1024_1_1_256_sp_4way(input, output, scratchpad);
+	}
+	if (scrypt_1024_1_1_256_sp_2way) {
+		for (; count >= 2; count -= 2, input += 2 * 80, output += 2 * 32)
+			scrypt_1024_1_1_256_sp_2way(input, output, scratchpad);
+	}
+	for (; count > 0; count--, input += 80, output += 32)
+		scrypt_1024_1_1_256_sp(input, output, scratchpad);
 }
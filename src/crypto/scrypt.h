@@ -3,14 +3,27 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string>
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
+/** The most inputs scrypt_1024_1_1_256_batch() hashes at once. */
+static const int SCRYPT_BATCH_MAX_WAYS = 4;
+
 void scrypt_1024_1_1_256(const char *input, char *output);
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
+/**
+ * Hash count consecutive 80-byte inputs into count consecutive 32-byte
+ * outputs. Groups of inputs are hashed together by the multi-lane kernel
+ * selected by scrypt_detect_batch(), the rest one at a time.
+ */
+void scrypt_1024_1_1_256_batch(const char *input, char *output, size_t count);
+
+/** Select the multi-lane kernel used by scrypt_1024_1_1_256_batch(). */
+std::string scrypt_detect_batch();
+
 #if defined(USE_SSE2)
-#include <string>
 #if defined(_M_X64) || defined(__x86_64__) || defined(_M_AMD64) || (defined(MAC_OSX) && defined(__i386__))
 #define USE_SSE2_ALWAYS 1
 #define scrypt_1024_1_1_256_sp(input, output, scratchpad) scrypt_1024_1_1_256_sp_sse2((input), (output), (scratchpad))
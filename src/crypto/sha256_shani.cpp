@@ -0,0 +1,218 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2017-2019 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// SHA-256 using the Intel SHA extensions. This file is compiled with
+// SHANI_CXXFLAGS; SHA256AutoDetect() only selects it after checking the CPU.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <immintrin.h>
+
+namespace {
+
+alignas(__m128i) const uint8_t MASK[16] = {0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04, 0x0b, 0x0a, 0x09, 0x08, 0x0f, 0x0e, 0x0d, 0x0c};
+
+alignas(__m128i) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/** Four rounds of SHA-256, with the message words already added to the round constants. */
+void inline __attribute__((always_inline)) QuadRound(__m128i& state0, __m128i& state1, __m128i msg)
+{
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+/** Compute message words 4*i..4*i+3 from the previous 16, stored in m[i % 4] .. m[(i + 3) % 4]. */
+void inline __attribute__((always_inline)) Schedule(__m128i& m0, __m128i m1, __m128i m2, __m128i m3)
+{
+    m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), _mm_alignr_epi8(m3, m2, 4)), m3);
+}
+
+/** Convert between the a..h state words and the ABEF/CDGH layout used by the SHA instructions. */
+void inline __attribute__((always_inline)) Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+void inline __attribute__((always_inline)) Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+__m128i inline __attribute__((always_inline)) Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_load_si128((const __m128i*)MASK));
+}
+
+__m128i inline __attribute__((always_inline)) RoundKeys(int i)
+{
+    return _mm_load_si128((const __m128i*)(K + 4 * i));
+}
+
+void inline __attribute__((always_inline)) Save(unsigned char* out, __m128i s)
+{
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(s, _mm_load_si128((const __m128i*)MASK)));
+}
+
+/** Round constants plus the message schedule of the padding block of a 64-byte message. */
+struct PaddingSchedule
+{
+    alignas(__m128i) uint32_t kw[64];
+
+    PaddingSchedule()
+    {
+        uint32_t w[64] = {0x80000000ul};
+        w[15] = 512;
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = (w[i - 15] >> 7 | w[i - 15] << 25) ^ (w[i - 15] >> 18 | w[i - 15] << 14) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = (w[i - 2] >> 17 | w[i - 2] << 15) ^ (w[i - 2] >> 19 | w[i - 2] << 13) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        for (int i = 0; i < 64; ++i) {
+            kw[i] = K[i] + w[i];
+        }
+    }
+};
+
+/** Compress one message block into two independent states at once, so the rounds of
+ *  both can overlap. ma and mb hold the 16 message words of each block. */
+void inline __attribute__((always_inline)) Compress2(__m128i& sa0, __m128i& sa1, __m128i ma[4], __m128i& sb0, __m128i& sb1, __m128i mb[4])
+{
+    const __m128i ao0 = sa0, ao1 = sa1, bo0 = sb0, bo1 = sb1;
+    for (int i = 0; i < 16; ++i) {
+        if (i >= 4) {
+            Schedule(ma[i & 3], ma[(i + 1) & 3], ma[(i + 2) & 3], ma[(i + 3) & 3]);
+            Schedule(mb[i & 3], mb[(i + 1) & 3], mb[(i + 2) & 3], mb[(i + 3) & 3]);
+        }
+        QuadRound(sa0, sa1, _mm_add_epi32(ma[i & 3], RoundKeys(i)));
+        QuadRound(sb0, sb1, _mm_add_epi32(mb[i & 3], RoundKeys(i)));
+    }
+    sa0 = _mm_add_epi32(sa0, ao0);
+    sa1 = _mm_add_epi32(sa1, ao1);
+    sb0 = _mm_add_epi32(sb0, bo0);
+    sb1 = _mm_add_epi32(sb1, bo1);
+}
+
+} // namespace
+
+namespace sha256_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i m0, m1, m2, m3, s0, s1, so0, so1;
+
+    /* Load state */
+    s0 = _mm_loadu_si128((const __m128i*)s);
+    s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+
+    while (blocks--) {
+        /* Remember old state */
+        so0 = s0;
+        so1 = s1;
+
+        /* Load data and transform */
+        m0 = Load(chunk);
+        QuadRound(s0, s1, _mm_add_epi32(m0, RoundKeys(0)));
+        m1 = Load(chunk + 16);
+        QuadRound(s0, s1, _mm_add_epi32(m1, RoundKeys(1)));
+        m2 = Load(chunk + 32);
+        QuadRound(s0, s1, _mm_add_epi32(m2, RoundKeys(2)));
+        m3 = Load(chunk + 48);
+        QuadRound(s0, s1, _mm_add_epi32(m3, RoundKeys(3)));
+        for (int i = 4; i < 16; i += 4) {
+            Schedule(m0, m1, m2, m3);
+            QuadRound(s0, s1, _mm_add_epi32(m0, RoundKeys(i)));
+            Schedule(m1, m2, m3, m0);
+            QuadRound(s0, s1, _mm_add_epi32(m1, RoundKeys(i + 1)));
+            Schedule(m2, m3, m0, m1);
+            QuadRound(s0, s1, _mm_add_epi32(m2, RoundKeys(i + 2)));
+            Schedule(m3, m0, m1, m2);
+            QuadRound(s0, s1, _mm_add_epi32(m3, RoundKeys(i + 3)));
+        }
+
+        /* Combine with old state */
+        s0 = _mm_add_epi32(s0, so0);
+        s1 = _mm_add_epi32(s1, so1);
+
+        /* Advance */
+        chunk += 64;
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+} // namespace sha256_shani
+
+namespace sha256d64_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    static const PaddingSchedule padding;
+    alignas(__m128i) static const uint32_t INIT[8] = {0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
+    __m128i init0 = _mm_load_si128((const __m128i*)INIT);
+    __m128i init1 = _mm_load_si128((const __m128i*)(INIT + 4));
+    Shuffle(init0, init1);
+
+    __m128i sa0 = init0, sa1 = init1, sb0 = init0, sb1 = init1;
+    __m128i ma[4], mb[4];
+
+    /* First hash: the 64-byte inputs */
+    for (int i = 0; i < 4; ++i) {
+        ma[i] = Load(in + 16 * i);
+        mb[i] = Load(in + 64 + 16 * i);
+    }
+    Compress2(sa0, sa1, ma, sb0, sb1, mb);
+
+    /* Their padding block, whose message schedule is constant */
+    const __m128i ao0 = sa0, ao1 = sa1, bo0 = sb0, bo1 = sb1;
+    for (int i = 0; i < 16; ++i) {
+        const __m128i kw = _mm_load_si128((const __m128i*)(padding.kw + 4 * i));
+        QuadRound(sa0, sa1, kw);
+        QuadRound(sb0, sb1, kw);
+    }
+    sa0 = _mm_add_epi32(sa0, ao0);
+    sa1 = _mm_add_epi32(sa1, ao1);
+    sb0 = _mm_add_epi32(sb0, bo0);
+    sb1 = _mm_add_epi32(sb1, bo1);
+
+    /* Second hash: the 32-byte first hashes, padded in the same block */
+    Unshuffle(sa0, sa1);
+    Unshuffle(sb0, sb1);
+    ma[0] = sa0;
+    ma[1] = sa1;
+    mb[0] = sb0;
+    mb[1] = sb1;
+    ma[2] = mb[2] = _mm_set_epi32(0, 0, 0, 0x80000000);
+    ma[3] = mb[3] = _mm_set_epi32(0x100, 0, 0, 0);
+    sa0 = sb0 = init0;
+    sa1 = sb1 = init1;
+    Compress2(sa0, sa1, ma, sb0, sb1, mb);
+
+    Unshuffle(sa0, sa1);
+    Unshuffle(sb0, sb1);
+    Save(out, sa0);
+    Save(out + 16, sa1);
+    Save(out + 32, sb0);
+    Save(out + 48, sb1);
+}
+} // namespace sha256d64_shani
+
+#endif
@@ -6,6 +6,7 @@
 #include "dbwrapper.h"
 
 #include "fs.h"
+#include "sync.h"
 #include "util.h"
 #include "random.h"
 
@@ -99,15 +100,19 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize, size_t maxFileSize)
+static leveldb::Options GetOptions(const CDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    options.block_cache = leveldb::NewLRUCache(dbOptions.nCacheSize / 2);
+    if (dbOptions.nWriteBufferSize)
+        options.write_buffer_size = dbOptions.nWriteBufferSize;
+    else
+        options.write_buffer_size = dbOptions.nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
+    options.filter_policy = dbOptions.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits) : nullptr;
+    options.compression = dbOptions.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.block_size = dbOptions.nBlockSize;
     options.info_log = new CMeowcoinLevelDBLogger();
-    options.max_file_size = maxFileSize;
+    options.max_file_size = dbOptions.nMaxFileSize;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -117,14 +122,81 @@ static leveldb::Options GetOptions(size_t nCacheSize, size_t maxFileSize)
     return options;
 }
 
+bool DBCompressionAvailable()
+{
+#ifdef USE_SNAPPY
+    return true;
+#else
+    return false;
+#endif
+}
+
+CDBOptions DBOptionsFromArgs(const std::string& strName, size_t nCacheSize, size_t nMaxFileSize)
+{
+    const std::string strPrefix = "-" + strName + "db";
+    CDBOptions dbOptions(nCacheSize, nMaxFileSize);
+    dbOptions.strName = strName;
+    dbOptions.fCompression = gArgs.GetArg(strPrefix + "compression", "none") == "snappy" && DBCompressionAvailable();
+    dbOptions.nBloomBits = std::max<int64_t>(gArgs.GetArg(strPrefix + "bloombits", DEFAULT_DB_BLOOM_BITS), 0);
+    dbOptions.nBlockSize = std::max<int64_t>(gArgs.GetArg(strPrefix + "blocksize", DEFAULT_DB_BLOCK_SIZE), 1) << 10;
+    dbOptions.nWriteBufferSize = std::max<int64_t>(gArgs.GetArg(strPrefix + "writebuffer", 0), 0) << 20;
+    if (gArgs.IsArgSet(strPrefix + "maxfilesize"))
+        dbOptions.nMaxFileSize = std::max<int64_t>(gArgs.GetArg(strPrefix + "maxfilesize", 0), 1) << 20;
+    return dbOptions;
+}
+
+bool CheckDBOptionsArgs(const std::string& strName, std::string& strError)
+{
+    const std::string strPrefix = "-" + strName + "db";
+    const std::string strCompression = gArgs.GetArg(strPrefix + "compression", "none");
+    if (strCompression != "none" && strCompression != "snappy") {
+        strError = strprintf("Unknown %scompression '%s', use none or snappy", strPrefix, strCompression);
+        return false;
+    }
+    const int64_t nBloomBits = gArgs.GetArg(strPrefix + "bloombits", DEFAULT_DB_BLOOM_BITS);
+    if (nBloomBits < 0 || nBloomBits > 64) {
+        strError = strprintf("%sbloombits must be between 0 and 64", strPrefix);
+        return false;
+    }
+    for (const char* pszSize : {"blocksize", "writebuffer", "maxfilesize"}) {
+        const std::string strArg = strPrefix + pszSize;
+        if (gArgs.IsArgSet(strArg) && (gArgs.GetArg(strArg, 0) < 1 || gArgs.GetArg(strArg, 0) > MAX_DB_SIZE_ARG)) {
+            strError = strprintf("%s must be between 1 and %d", strArg, MAX_DB_SIZE_ARG);
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+//! Guards vOpenDBs, and keeps the databases in it open while it is held
+CCriticalSection cs_open_dbs;
+std::vector<const CDBWrapper*> vOpenDBs;
+
+} // namespace
+
+void ForEachOpenDB(const std::function<void(const CDBWrapper&)>& func)
+{
+    LOCK(cs_open_dbs);
+    for (const CDBWrapper* pdbw : vOpenDBs)
+        func(*pdbw);
+}
+
 CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, size_t maxFileSize)
+    : CDBWrapper(path, CDBOptions(nCacheSize, maxFileSize), fMemory, fWipe, obfuscate)
+{
+}
+
+CDBWrapper::CDBWrapper(const fs::path& pathIn, const CDBOptions& dbOptionsIn, bool fMemory, bool fWipe, bool obfuscate)
+    : dboptions(dbOptionsIn), path(pathIn)
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, maxFileSize);
+    options = GetOptions(dboptions);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -166,10 +238,22 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    if (!dboptions.strName.empty()) {
+        LogPrint(BCLog::LEVELDB, "LevelDB %s: compression=%s bloombits=%d blocksize=%u writebuffer=%u maxfilesize=%u\n",
+            dboptions.strName, dboptions.fCompression ? "snappy" : "none", dboptions.nBloomBits, dboptions.nBlockSize,
+            options.write_buffer_size, dboptions.nMaxFileSize);
+        LOCK(cs_open_dbs);
+        vOpenDBs.push_back(this);
+    }
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(cs_open_dbs);
+        vOpenDBs.erase(std::remove(vOpenDBs.begin(), vOpenDBs.end(), this), vOpenDBs.end());
+    }
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
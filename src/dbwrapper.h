@@ -14,12 +14,21 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <functional>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+//! -<db>dbbloombits default
+static const int DEFAULT_DB_BLOOM_BITS = 10;
+//! -<db>dbblocksize default (KiB)
+static const int64_t DEFAULT_DB_BLOCK_SIZE = 4;
+//! max. -<db>dbblocksize, -<db>dbwritebuffer and -<db>dbmaxfilesize
+static const int64_t MAX_DB_SIZE_ARG = 1024;
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -28,6 +37,45 @@ public:
 
 class CDBWrapper;
 
+/** LevelDB settings of one database */
+struct CDBOptions
+{
+    //! Name of the database in the -<db>db* arguments, empty for none
+    std::string strName;
+    //! Size of the block cache is half of this
+    size_t nCacheSize;
+    //! Compress blocks with Snappy, if LevelDB was built with it
+    bool fCompression;
+    //! Bits per key of the bloom filters, 0 for none
+    int nBloomBits;
+    //! Approximate size of the data in a block, before compression
+    size_t nBlockSize;
+    //! Size of the memtable, 0 for a quarter of nCacheSize
+    size_t nWriteBufferSize;
+    size_t nMaxFileSize;
+
+    explicit CDBOptions(size_t nCacheSizeIn = 0, size_t nMaxFileSizeIn = 2 << 20) :
+        nCacheSize(nCacheSizeIn), fCompression(false), nBloomBits(DEFAULT_DB_BLOOM_BITS),
+        nBlockSize(DEFAULT_DB_BLOCK_SIZE << 10), nWriteBufferSize(0), nMaxFileSize(nMaxFileSizeIn) {}
+};
+
+/** Whether LevelDB was built with Snappy, without which fCompression has no effect */
+bool DBCompressionAvailable();
+
+/**
+ * Build the options of a database from the -<strName>db* arguments:
+ * -<strName>dbcompression, -<strName>dbbloombits, -<strName>dbblocksize (KiB),
+ * -<strName>dbwritebuffer (MiB) and -<strName>dbmaxfilesize (MiB). nMaxFileSize
+ * is the default of the latter.
+ */
+CDBOptions DBOptionsFromArgs(const std::string& strName, size_t nCacheSize, size_t nMaxFileSize = 2 << 20);
+
+/** Check the -<strName>db* arguments, returning false with an error message if one is invalid */
+bool CheckDBOptionsArgs(const std::string& strName, std::string& strError);
+
+/** Call func on each open database that has a name, in the order they were opened */
+void ForEachOpenDB(const std::function<void(const CDBWrapper&)>& func);
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -184,6 +232,12 @@ private:
     //! database options used
     leveldb::Options options;
 
+    //! the settings the options were made from
+    CDBOptions dboptions;
+
+    //! location of the database
+    fs::path path;
+
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
@@ -220,8 +274,22 @@ public:
      *                        with a zero'd byte array.
      */
     CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, size_t maxFileSize = 2 << 20);
+    /**
+     * @param[in] dbOptionsIn LevelDB settings. If it has a name, the database
+     *                        is listed by ForEachOpenDB while open.
+     */
+    CDBWrapper(const fs::path& path, const CDBOptions& dbOptionsIn, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
     ~CDBWrapper();
 
+    const CDBOptions& GetDBOptions() const { return dboptions; }
+    const fs::path& GetPath() const { return path; }
+
+    /** Read a LevelDB property such as "leveldb.stats", see leveldb::DB::GetProperty */
+    bool GetProperty(const std::string& strProperty, std::string& strValue) const
+    {
+        return pdb->GetProperty(strProperty, &strValue);
+    }
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
@@ -302,6 +370,28 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Take a consistent snapshot of the database, which any number of
+     * iterators from NewIterator(snapshot) can read concurrently while the
+     * database keeps being written. Release it with ReleaseSnapshot().
+     */
+    const leveldb::Snapshot *GetSnapshot() const
+    {
+        return pdb->GetSnapshot();
+    }
+
+    void ReleaseSnapshot(const leveldb::Snapshot *snapshot) const
+    {
+        pdb->ReleaseSnapshot(snapshot);
+    }
+
+    CDBIterator *NewIterator(const leveldb::Snapshot *snapshot) const
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot;
+        return new CDBIterator(*this, pdb->NewIterator(options));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "ethashprefetch.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validationinterface.h"
+
+#include <crypto/ethash/include/ethash/ethash.hpp>
+
+#include <algorithm>
+#include <memory>
+
+#include <boost/thread.hpp>
+
+namespace {
+
+/**
+ * Watches the active tip and hands the next epoch to the prefetch thread once
+ * the tip is within nPrefetchBlocks of the epoch boundary.
+ */
+class CEthashPrefetcher : public CValidationInterface
+{
+public:
+    explicit CEthashPrefetcher(int nPrefetchBlocksIn) : nPrefetchBlocks(nPrefetchBlocksIn), nRequestedEpoch(-1), nLastEpoch(-1) {}
+
+    void ThreadPrefetch()
+    {
+        SetThreadPriority(THREAD_PRIORITY_LOWEST);
+        while (true) {
+            int nEpoch;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (nRequestedEpoch < 0)
+                    cond.wait(lock);
+                nEpoch = nRequestedEpoch;
+                nRequestedEpoch = -1;
+            }
+
+            int64_t nStart = GetTimeMillis();
+            if (ethash_prefetch_global_epoch_context(nEpoch))
+                LogPrintf("%s: built ethash context for epoch %d in %dms\n", __func__, nEpoch, GetTimeMillis() - nStart);
+        }
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override
+    {
+        // Headers race through epochs during initial sync, a prefetched context would be outdated at once.
+        if (fInitialDownload || pindexNew->nTime < nKAWPOWActivationTime)
+            return;
+
+        const int nNextEpoch = ethash::get_epoch_number(pindexNew->nHeight) + 1;
+        if (nNextEpoch * ethash::epoch_length - pindexNew->nHeight > nPrefetchBlocks)
+            return;
+
+        boost::lock_guard<boost::mutex> lock(mutex);
+        if (nNextEpoch == nLastEpoch)
+            return;
+        nLastEpoch = nNextEpoch;
+        nRequestedEpoch = nNextEpoch;
+        cond.notify_one();
+    }
+
+private:
+    const int nPrefetchBlocks;
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    //! Epoch waiting to be built by the prefetch thread, -1 if none
+    int nRequestedEpoch;
+    //! Last epoch handed to the prefetch thread
+    int nLastEpoch;
+};
+
+std::unique_ptr<CEthashPrefetcher> g_ethash_prefetcher;
+
+} // namespace
+
+void StartEthashPrefetch(boost::thread_group& threadGroup)
+{
+    int nPrefetchBlocks = gArgs.GetArg("-ethashprefetch", DEFAULT_ETHASH_PREFETCH_BLOCKS);
+    if (nPrefetchBlocks <= 0)
+        return;
+
+    g_ethash_prefetcher.reset(new CEthashPrefetcher(std::min(nPrefetchBlocks, ethash::epoch_length)));
+    threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "ethashprefetch",
+        boost::function<void()>(boost::bind(&CEthashPrefetcher::ThreadPrefetch, g_ethash_prefetcher.get()))));
+    RegisterValidationInterface(g_ethash_prefetcher.get());
+}
+
+void StopEthashPrefetch()
+{
+    if (g_ethash_prefetcher)
+        UnregisterValidationInterface(g_ethash_prefetcher.get());
+}
@@ -0,0 +1,23 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Background pre-generation of the next KAWPOW/MEOWPOW epoch context.
+ */
+#ifndef MEOWCOIN_ETHASHPREFETCH_H
+#define MEOWCOIN_ETHASHPREFETCH_H
+
+namespace boost {
+class thread_group;
+} // namespace boost
+
+/** Default for -ethashprefetch, the distance in blocks from the next epoch at which its context is built */
+static const int DEFAULT_ETHASH_PREFETCH_BLOCKS = 500;
+
+/** Start the low priority thread that builds the next epoch context as the tip approaches an epoch boundary */
+void StartEthashPrefetch(boost::thread_group& threadGroup);
+/** Stop following the tip. The thread itself is interrupted with the thread group */
+void StopEthashPrefetch();
+
+#endif // MEOWCOIN_ETHASHPREFETCH_H
@@ -0,0 +1,332 @@
+// Copyright (c) 2017-2019 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEOWCOIN_FLATMAP_H
+#define MEOWCOIN_FLATMAP_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** Hash map with open addressing, whose elements live in a pooled arena.
+ *
+ * This is a replacement for std::unordered_map for large, hot maps such as
+ * the coins cache, where the per-element heap allocation and the pointer
+ * chasing through bucket lists of std::unordered_map dominate:
+ *
+ * - The table is a flat power-of-two array of (element pointer, hash) slots,
+ *   probed linearly. The full hash is kept in the slot, so probing compares
+ *   keys only on a hash match and growing the table never rehashes a key.
+ * - Elements are allocated from chunks of a pool that grow geometrically and
+ *   are reused through a free list, so an insertion rarely calls malloc, and
+ *   clear() releases everything in a handful of frees.
+ * - Erasing leaves a tombstone in the slot, so erase() never moves other
+ *   slots. Like std::unordered_map, erasing an element only invalidates
+ *   iterators to it, and the usual "erase(it++)" loop works.
+ *
+ * The addresses of elements are stable until they are erased, also when the
+ * table grows. Iterators are invalidated by any insertion that grows the
+ * table, as with a rehash of std::unordered_map.
+ */
+template <typename K, typename T, typename Hash = std::hash<K> >
+class flatmap {
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    /** A pool node holds an element, or the next free node while unused. */
+    union Node {
+        Node* next;
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type data;
+    };
+
+    /** A slot is empty (node null, hash 0), a tombstone (node null, hash 1) or in use. */
+    struct Slot {
+        value_type* node;
+        size_t hash;
+    };
+
+    enum : size_t {
+        MIN_BUCKETS = 16,
+        MIN_CHUNK = 16,    //!< Nodes in the first pool chunk
+        MAX_CHUNK = 4096,  //!< Chunks double in size up to this many nodes
+    };
+
+    std::vector<Slot> slots;
+    size_t nSize;
+    size_t nTombstones;
+    Hash hasher;
+
+    std::vector<std::unique_ptr<Node[]> > chunks;
+    size_t nPoolNodes;
+    size_t nChunkSize;
+    size_t nChunkUsed;
+    Node* freeList;
+
+    template <typename S, typename V>
+    class iterator_base {
+        friend class flatmap;
+        S* ptr;
+        S* last;
+
+        void skip() { while (ptr != last && ptr->node == nullptr) ++ptr; }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename std::remove_const<V>::type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef V* pointer;
+        typedef V& reference;
+
+        iterator_base() : ptr(nullptr), last(nullptr) {}
+        iterator_base(S* ptr_, S* last_) : ptr(ptr_), last(last_) { skip(); }
+        template <typename S2, typename V2, typename = typename std::enable_if<std::is_convertible<S2*, S*>::value>::type>
+        iterator_base(const iterator_base<S2, V2>& it) : ptr(it.ptr), last(it.last) {}
+
+        V& operator*() const { return *ptr->node; }
+        V* operator->() const { return ptr->node; }
+        iterator_base& operator++() { ++ptr; skip(); return *this; }
+        iterator_base operator++(int) { iterator_base copy(*this); ++(*this); return copy; }
+        template <typename S2, typename V2>
+        bool operator==(const iterator_base<S2, V2>& it) const { return ptr == it.ptr; }
+        template <typename S2, typename V2>
+        bool operator!=(const iterator_base<S2, V2>& it) const { return ptr != it.ptr; }
+
+        template <typename S2, typename V2> friend class iterator_base;
+    };
+
+public:
+    typedef iterator_base<Slot, value_type> iterator;
+    typedef iterator_base<const Slot, const value_type> const_iterator;
+
+    explicit flatmap(const Hash& hasherIn = Hash()) : nSize(0), nTombstones(0), hasher(hasherIn), nPoolNodes(0), nChunkSize(0), nChunkUsed(0), freeList(nullptr) {}
+
+    flatmap(const flatmap&) = delete;
+    flatmap& operator=(const flatmap&) = delete;
+
+    ~flatmap() { clear(); }
+
+    iterator begin() { return iterator(slots.data(), slots.data() + slots.size()); }
+    iterator end() { return iterator(slots.data() + slots.size(), slots.data() + slots.size()); }
+    const_iterator begin() const { return const_iterator(slots.data(), slots.data() + slots.size()); }
+    const_iterator end() const { return const_iterator(slots.data() + slots.size(), slots.data() + slots.size()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return nSize == 0; }
+    size_type size() const { return nSize; }
+    size_type bucket_count() const { return slots.size(); }
+
+    iterator find(const K& key)
+    {
+        Slot* slot = Lookup(key, hasher(key));
+        return slot ? iterator(slot, slots.data() + slots.size()) : end();
+    }
+
+    const_iterator find(const K& key) const
+    {
+        const Slot* slot = const_cast<flatmap*>(this)->Lookup(key, hasher(key));
+        return slot ? const_iterator(slot, slots.data() + slots.size()) : end();
+    }
+
+    size_type count(const K& key) const { return find(key) != end(); }
+
+    /** Construct an element in place, unless its key is already present. */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        Node* node = AllocateNode();
+        value_type* value;
+        try {
+            value = new (&node->data) value_type(std::forward<Args>(args)...);
+        } catch (...) {
+            FreeNode(node);
+            throw;
+        }
+        const size_t hash = hasher(value->first);
+        Slot* slot = Lookup(value->first, hash);
+        if (slot) {
+            value->~value_type();
+            FreeNode(node);
+            return std::make_pair(iterator(slot, slots.data() + slots.size()), false);
+        }
+        return std::make_pair(Insert(value, hash), true);
+    }
+
+    T& operator[](const K& key)
+    {
+        const size_t hash = hasher(key);
+        Slot* slot = Lookup(key, hash);
+        if (slot) return slot->node->second;
+        Node* node = AllocateNode();
+        value_type* value;
+        try {
+            value = new (&node->data) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
+        } catch (...) {
+            FreeNode(node);
+            throw;
+        }
+        return Insert(value, hash)->second;
+    }
+
+    /** Erase an element and return the iterator to the next one. */
+    iterator erase(iterator it)
+    {
+        Slot* slot = it.ptr;
+        assert(slot->node != nullptr);
+        DestroyNode(slot->node);
+        slot->node = nullptr;
+        slot->hash = 1;
+        --nSize;
+        ++nTombstones;
+        return ++it;
+    }
+
+    iterator erase(const_iterator it) { return erase(iterator(const_cast<Slot*>(it.ptr), const_cast<Slot*>(it.last))); }
+
+    size_type erase(const K& key)
+    {
+        iterator it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    /** Destroy all elements and release the table and the pool. */
+    void clear()
+    {
+        for (Slot& slot : slots) {
+            if (slot.node) slot.node->~value_type();
+        }
+        std::vector<Slot>().swap(slots);
+        std::vector<std::unique_ptr<Node[]> >().swap(chunks);
+        nSize = 0;
+        nTombstones = 0;
+        nPoolNodes = 0;
+        nChunkSize = 0;
+        nChunkUsed = 0;
+        freeList = nullptr;
+    }
+
+    /** Exchange the contents, including the hashers, with another map. */
+    void swap(flatmap& other)
+    {
+        std::swap(slots, other.slots);
+        std::swap(nSize, other.nSize);
+        std::swap(nTombstones, other.nTombstones);
+        std::swap(hasher, other.hasher);
+        std::swap(chunks, other.chunks);
+        std::swap(nPoolNodes, other.nPoolNodes);
+        std::swap(nChunkSize, other.nChunkSize);
+        std::swap(nChunkUsed, other.nChunkUsed);
+        std::swap(freeList, other.freeList);
+    }
+
+    /** Size the table for n elements without growing. */
+    void reserve(size_type n)
+    {
+        if (BucketsFor(n) > slots.size()) Rehash(BucketsFor(n));
+    }
+
+    /** Heap memory of the slot table, and of the element pool. */
+    size_t bucket_memory() const { return slots.capacity() * sizeof(Slot); }
+    size_t pool_memory() const { return nPoolNodes * sizeof(Node); }
+
+private:
+    /** Number of buckets to hold n elements at a load factor of at most 1/2. */
+    static size_t BucketsFor(size_t n)
+    {
+        size_t buckets = MIN_BUCKETS;
+        while (buckets < 2 * n) buckets *= 2;
+        return buckets;
+    }
+
+    Slot* Lookup(const K& key, size_t hash)
+    {
+        if (slots.empty()) return nullptr;
+        const size_t mask = slots.size() - 1;
+        for (size_t pos = hash & mask; ; pos = (pos + 1) & mask) {
+            Slot& slot = slots[pos];
+            if (slot.node == nullptr) {
+                if (slot.hash == 0) return nullptr;
+            } else if (slot.hash == hash && slot.node->first == key) {
+                return &slot;
+            }
+        }
+    }
+
+    /** Put a new element into the first free slot of its probe sequence. */
+    iterator Insert(value_type* value, size_t hash)
+    {
+        // Keep at least a quarter of the slots empty, so probes stay short.
+        if ((nSize + nTombstones + 1) * 4 > slots.size() * 3) {
+            Rehash(std::max(slots.size(), BucketsFor(nSize + 1)));
+        }
+        const size_t mask = slots.size() - 1;
+        size_t pos = hash & mask;
+        while (slots[pos].node != nullptr) pos = (pos + 1) & mask;
+        if (slots[pos].hash == 1) --nTombstones;
+        slots[pos].node = value;
+        slots[pos].hash = hash;
+        ++nSize;
+        return iterator(&slots[pos], slots.data() + slots.size());
+    }
+
+    /** Move all elements into a fresh table of the given size, dropping tombstones. */
+    void Rehash(size_t buckets)
+    {
+        std::vector<Slot> old(buckets, Slot{nullptr, 0});
+        old.swap(slots);
+        const size_t mask = buckets - 1;
+        for (const Slot& slot : old) {
+            if (slot.node == nullptr) continue;
+            size_t pos = slot.hash & mask;
+            while (slots[pos].node != nullptr) pos = (pos + 1) & mask;
+            slots[pos] = slot;
+        }
+        nTombstones = 0;
+    }
+
+    Node* AllocateNode()
+    {
+        if (freeList) {
+            Node* node = freeList;
+            freeList = node->next;
+            return node;
+        }
+        if (nChunkUsed == nChunkSize) {
+            // Double the pool, up to chunks of MAX_CHUNK nodes.
+            nChunkSize = std::min(std::max<size_t>(MIN_CHUNK, nPoolNodes), (size_t)MAX_CHUNK);
+            chunks.emplace_back(new Node[nChunkSize]);
+            nPoolNodes += nChunkSize;
+            nChunkUsed = 0;
+        }
+        return &chunks.back()[nChunkUsed++];
+    }
+
+    void FreeNode(Node* node)
+    {
+        node->next = freeList;
+        freeList = node;
+    }
+
+    void DestroyNode(value_type* value)
+    {
+        value->~value_type();
+        FreeNode(reinterpret_cast<Node*>(value));
+    }
+};
+
+#endif // MEOWCOIN_FLATMAP_H
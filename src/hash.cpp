@@ -10,9 +10,31 @@
 #include "pubkey.h"
 #include "util.h"
 
+#include "algo/sph_blake.h"
+#include "algo/sph_bmw.h"
+#include "algo/sph_groestl.h"
+#include "algo/sph_jh.h"
+#include "algo/sph_keccak.h"
+#include "algo/sph_skein.h"
+#include "algo/sph_luffa.h"
+#include "algo/sph_cubehash.h"
+#include "algo/sph_shavite.h"
+#include "algo/sph_simd.h"
+#include "algo/sph_echo.h"
+#include "algo/sph_hamsi.h"
+#include "algo/sph_fugue.h"
+#include "algo/sph_shabal.h"
+#include "algo/sph_whirlpool.h"
+#include "algo/sph_sha2.h"
+#include "algo/sph_tiger.h"
+
 #include <crypto/ethash/include/ethash/progpow.hpp>
 #include <crypto/ethash/include/ethash/meowpow.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <string.h>
+
 
 //TODO remove these
 double algoHashTotal[16];
@@ -257,46 +279,183 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     return v0 ^ v1 ^ v2 ^ v3;
 }
 
-uint256 KAWPOWHash(const CBlockHeader& blockHeader, uint256& mix_hash)
+namespace {
+
+/** Freshly initialized contexts of every X16R/X16RV2 step function. Each step starts
+ *  from a copy of these instead of running the sph init function again. */
+struct X16RContexts
 {
-    static ethash::epoch_context_ptr context{nullptr, nullptr};
+    sph_blake512_context     blake512;
+    sph_bmw512_context       bmw512;
+    sph_groestl512_context   groestl512;
+    sph_jh512_context        jh512;
+    sph_keccak512_context    keccak512;
+    sph_skein512_context     skein512;
+    sph_luffa512_context     luffa512;
+    sph_cubehash512_context  cubehash512;
+    sph_shavite512_context   shavite512;
+    sph_simd512_context      simd512;
+    sph_echo512_context      echo512;
+    sph_hamsi512_context     hamsi512;
+    sph_fugue512_context     fugue512;
+    sph_shabal512_context    shabal512;
+    sph_whirlpool_context    whirlpool;
+    sph_sha512_context       sha512;
+    sph_tiger_context        tiger;
+
+    X16RContexts()
+    {
+        sph_blake512_init(&blake512);
+        sph_bmw512_init(&bmw512);
+        sph_groestl512_init(&groestl512);
+        sph_jh512_init(&jh512);
+        sph_keccak512_init(&keccak512);
+        sph_skein512_init(&skein512);
+        sph_luffa512_init(&luffa512);
+        sph_cubehash512_init(&cubehash512);
+        sph_shavite512_init(&shavite512);
+        sph_simd512_init(&simd512);
+        sph_echo512_init(&echo512);
+        sph_hamsi512_init(&hamsi512);
+        sph_fugue512_init(&fugue512);
+        sph_shabal512_init(&shabal512);
+        sph_whirlpool_init(&whirlpool);
+        sph_sha512_init(&sha512);
+        sph_tiger_init(&tiger);
+    }
+};
 
-    // Get the context from the block height
-    const auto epoch_number = ethash::get_epoch_number(blockHeader.nHeight);
+const X16RContexts& X16RTemplates()
+{
+    static const X16RContexts templates;
+    return templates;
+}
+
+#define X16R_RUN(algo) \
+    { \
+        sph_##algo##_context ctx = templates.algo; \
+        sph_##algo(&ctx, input, len); \
+        sph_##algo##_close(&ctx, output); \
+    }
+
+/** Tiger writes 24 bytes; X16RV2 hashes them zero-padded to 64. */
+void HashTiger(const unsigned char* input, size_t len, unsigned char* output)
+{
+    const X16RContexts& templates = X16RTemplates();
+    X16R_RUN(tiger);
+    memset(output + 24, 0, 40);
+}
+
+uint256 HashX16RChain(const unsigned char* data, size_t len, const uint256& PrevBlockHash, bool fV2)
+{
+    // Every step only reads the previous result, so two buffers are enough.
+    unsigned char hash[2][64];
+    const unsigned char* input = data;
+    for (int i = 0; i < 16; i++) {
+        unsigned char* output = hash[i & 1];
+        const int algo = GetHashSelection(PrevBlockHash, i);
+        if (fV2 && (algo == 4 || algo == 6 || algo == 15)) {
+            // X16RV2 runs tiger before keccak, luffa and sha512.
+            HashTiger(input, len, output);
+            input = output;
+            len = 64;
+        }
+        HashX16RAlgo(algo, input, len, output);
+        input = output;
+        len = 64;
+    }
+
+    uint256 result;
+    memcpy(result.begin(), hash[1], 32);
+    return result;
+}
+
+} // namespace
+
+void HashX16RAlgo(int algo, const unsigned char* input, size_t len, unsigned char* output)
+{
+    const X16RContexts& templates = X16RTemplates();
+    switch (algo) {
+        case 0: X16R_RUN(blake512); break;
+        case 1: X16R_RUN(bmw512); break;
+        case 2: X16R_RUN(groestl512); break;
+        case 3: X16R_RUN(jh512); break;
+        case 4: X16R_RUN(keccak512); break;
+        case 5: X16R_RUN(skein512); break;
+        case 6: X16R_RUN(luffa512); break;
+        case 7: X16R_RUN(cubehash512); break;
+        case 8: X16R_RUN(shavite512); break;
+        case 9: X16R_RUN(simd512); break;
+        case 10: X16R_RUN(echo512); break;
+        case 11: X16R_RUN(hamsi512); break;
+        case 12: X16R_RUN(fugue512); break;
+        case 13: X16R_RUN(shabal512); break;
+        case 14: X16R_RUN(whirlpool); break;
+        case 15: X16R_RUN(sha512); break;
+        default: assert(false);
+    }
+}
 
-    if (!context || context->epoch_number != epoch_number)
-        context = ethash::create_epoch_context(epoch_number);
+#undef X16R_RUN
+
+uint256 HashX16R(const unsigned char* data, size_t len, const uint256& PrevBlockHash)
+{
+    return HashX16RChain(data, len, PrevBlockHash, false);
+}
+
+uint256 HashX16RV2(const unsigned char* data, size_t len, const uint256& PrevBlockHash)
+{
+    return HashX16RChain(data, len, PrevBlockHash, true);
+}
+
+// uint256 keeps its bytes in the reverse order of its hex form while ethash
+// keeps them in hex order, so the bytes are swapped end to end.
+ethash::hash256 ToHash256(const uint256& hash)
+{
+    ethash::hash256 result;
+    std::reverse_copy(hash.begin(), hash.end(), result.bytes);
+    return result;
+}
+
+uint256 FromHash256(const ethash::hash256& hash)
+{
+    uint256 result;
+    std::reverse_copy(std::begin(hash.bytes), std::end(hash.bytes), result.begin());
+    return result;
+}
+
+uint256 KAWPOWHash(const CBlockHeader& blockHeader, uint256& mix_hash)
+{
+    // Get the shared context from the block height
+    const auto epoch_number = ethash::get_epoch_number(blockHeader.nHeight);
+    const auto& context = ethash::get_global_epoch_context(epoch_number);
 
     // Build the header_hash
     uint256 nHeaderHash = blockHeader.GetKAWPOWHeaderHash();
-    const auto header_hash = to_hash256(nHeaderHash.GetHex());
+    const auto header_hash = ToHash256(nHeaderHash);
 
     // ProgPow hash
-    const auto result = progpow::hash(*context, blockHeader.nHeight, header_hash, blockHeader.nNonce64);
+    const auto result = progpow::hash(context, blockHeader.nHeight, header_hash, blockHeader.nNonce64);
 
-    mix_hash = uint256S(to_hex(result.mix_hash));
-    return uint256S(to_hex(result.final_hash));
+    mix_hash = FromHash256(result.mix_hash);
+    return FromHash256(result.final_hash);
 }
 
 uint256 MEOWPOWHash(const CBlockHeader& blockHeader, uint256& mix_hash)
 {
-    static ethash::epoch_context_ptr context{nullptr, nullptr};
-
-    // Get the context from the block height
+    // Get the shared context from the block height
     const auto epoch_number = ethash::get_epoch_number(blockHeader.nHeight);
-
-    if (!context || context->epoch_number != epoch_number)
-        context = ethash::create_epoch_context(epoch_number);
+    const auto& context = ethash::get_global_epoch_context(epoch_number);
 
     // Build the header_hash
     uint256 nHeaderHash = blockHeader.GetMEOWPOWHeaderHash();
-    const auto header_hash = to_hash256(nHeaderHash.GetHex());
+    const auto header_hash = ToHash256(nHeaderHash);
 
     // ProgPow hash
-    const auto result = meowpow::hash(*context, blockHeader.nHeight, header_hash, blockHeader.nNonce64);
+    const auto result = meowpow::hash(context, blockHeader.nHeight, header_hash, blockHeader.nNonce64);
 
-    mix_hash = uint256S(to_hex(result.mix_hash));
-    return uint256S(to_hex(result.final_hash));
+    mix_hash = FromHash256(result.mix_hash);
+    return FromHash256(result.final_hash);
 }
 
 
@@ -305,24 +464,24 @@ uint256 KAWPOWHash_OnlyMix(const CBlockHeader& blockHeader)
 {
     // Build the header_hash
     uint256 nHeaderHash = blockHeader.GetKAWPOWHeaderHash();
-    const auto header_hash = to_hash256(nHeaderHash.GetHex());
+    const auto header_hash = ToHash256(nHeaderHash);
 
     // ProgPow hash
-    const auto result = progpow::hash_no_verify(blockHeader.nHeight, header_hash, to_hash256(blockHeader.mix_hash.GetHex()), blockHeader.nNonce64);
+    const auto result = progpow::hash_no_verify(blockHeader.nHeight, header_hash, ToHash256(blockHeader.mix_hash), blockHeader.nNonce64);
 
-    return uint256S(to_hex(result));
+    return FromHash256(result);
 }
 
 uint256 MEOWPOWHash_OnlyMix(const CBlockHeader& blockHeader)
 {
     // Build the header_hash
     uint256 nHeaderHash = blockHeader.GetMEOWPOWHeaderHash();
-    const auto header_hash = to_hash256(nHeaderHash.GetHex());
+    const auto header_hash = ToHash256(nHeaderHash);
 
     // ProgPow hash
-    const auto result = meowpow::hash_no_verify(blockHeader.nHeight, header_hash, to_hash256(blockHeader.mix_hash.GetHex()), blockHeader.nNonce64);
+    const auto result = meowpow::hash_no_verify(blockHeader.nHeight, header_hash, ToHash256(blockHeader.mix_hash), blockHeader.nNonce64);
 
-    return uint256S(to_hex(result));
+    return FromHash256(result);
 }
 
 
@@ -15,28 +15,6 @@
 #include "uint256.h"
 #include "version.h"
 
-#include "algo/sph_blake.h"
-#include "algo/sph_bmw.h"
-#include "algo/sph_groestl.h"
-#include "algo/sph_jh.h"
-#include "algo/sph_keccak.h"
-#include "algo/sph_skein.h"
-#include "algo/sph_luffa.h"
-#include "algo/sph_cubehash.h"
-#include "algo/sph_shavite.h"
-#include "algo/sph_simd.h"
-#include "algo/sph_echo.h"
-#include "algo/sph_hamsi.h"
-#include "algo/sph_fugue.h"
-#include "algo/sph_shabal.h"
-#include "algo/sph_whirlpool.h"
-#include "algo/sph_sha2.h"
-#include "algo/sph_haval.h"
-
-#include "algo/sph_tiger.h"
-#include "algo/lyra2.h"
-#include "algo/gost_streebog.h"
-
 #include <crypto/ethash/helpers.hpp>
 
 #include <vector>
@@ -331,280 +309,35 @@ extern int algoHashHits[16];
 
 
 
+/** Run X16R step function algo (0..15, see GetHashSelection) over len bytes of input,
+ *  writing its 64-byte result to output. output may equal input. */
+void HashX16RAlgo(int algo, const unsigned char* input, size_t len, unsigned char* output);
+
+/** X16R and X16RV2 of len bytes of data, chaining the step functions in the order
+ *  given by the last 16 nibbles of PrevBlockHash. */
+uint256 HashX16R(const unsigned char* data, size_t len, const uint256& PrevBlockHash);
+uint256 HashX16RV2(const unsigned char* data, size_t len, const uint256& PrevBlockHash);
+
 template<typename T1>
 inline uint256 HashX16R(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
 {
-//      static std::chrono::duration<double>[16];
-    int hashSelection;
-
-    sph_blake512_context     ctx_blake;      //0
-    sph_bmw512_context       ctx_bmw;        //1
-    sph_groestl512_context   ctx_groestl;    //2
-    sph_jh512_context        ctx_jh;         //3
-    sph_keccak512_context    ctx_keccak;     //4
-    sph_skein512_context     ctx_skein;      //5
-    sph_luffa512_context     ctx_luffa;      //6
-    sph_cubehash512_context  ctx_cubehash;   //7
-    sph_shavite512_context   ctx_shavite;    //8
-    sph_simd512_context      ctx_simd;       //9
-    sph_echo512_context      ctx_echo;       //A
-    sph_hamsi512_context     ctx_hamsi;      //B
-    sph_fugue512_context     ctx_fugue;      //C
-    sph_shabal512_context    ctx_shabal;     //D
-    sph_whirlpool_context    ctx_whirlpool;  //E
-    sph_sha512_context       ctx_sha512;     //F
-
-
-
     static unsigned char pblank[1];
-
-    uint512 hash[16];
-
-    for (int i=0;i<16;i++)
-    {
-        const void *toHash;
-        int lenToHash;
-        if (i == 0) {
-            toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-            lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
-        } else {
-            toHash = static_cast<const void*>(&hash[i-1]);
-            lenToHash = 64;
-        }
-
-        hashSelection = GetHashSelection(PrevBlockHash, i);
-
-        switch(hashSelection) {
-            case 0:
-                sph_blake512_init(&ctx_blake);
-                sph_blake512 (&ctx_blake, toHash, lenToHash);
-                sph_blake512_close(&ctx_blake, static_cast<void*>(&hash[i]));
-                break;
-            case 1:
-                sph_bmw512_init(&ctx_bmw);
-                sph_bmw512 (&ctx_bmw, toHash, lenToHash);
-                sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[i]));
-                break;
-            case 2:
-                sph_groestl512_init(&ctx_groestl);
-                sph_groestl512 (&ctx_groestl, toHash, lenToHash);
-                sph_groestl512_close(&ctx_groestl, static_cast<void*>(&hash[i]));
-                break;
-            case 3:
-                sph_jh512_init(&ctx_jh);
-                sph_jh512 (&ctx_jh, toHash, lenToHash);
-                sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[i]));
-                break;
-            case 4:
-                sph_keccak512_init(&ctx_keccak);
-                sph_keccak512 (&ctx_keccak, toHash, lenToHash);
-                sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hash[i]));
-                break;
-            case 5:
-                sph_skein512_init(&ctx_skein);
-                sph_skein512 (&ctx_skein, toHash, lenToHash);
-                sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[i]));
-                break;
-            case 6:
-                sph_luffa512_init(&ctx_luffa);
-                sph_luffa512 (&ctx_luffa, toHash, lenToHash);
-                sph_luffa512_close(&ctx_luffa, static_cast<void*>(&hash[i]));
-                break;
-            case 7:
-                sph_cubehash512_init(&ctx_cubehash);
-                sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
-                sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(&hash[i]));
-                break;
-            case 8:
-                sph_shavite512_init(&ctx_shavite);
-                sph_shavite512(&ctx_shavite, toHash, lenToHash);
-                sph_shavite512_close(&ctx_shavite, static_cast<void*>(&hash[i]));
-                break;
-            case 9:
-                sph_simd512_init(&ctx_simd);
-                sph_simd512 (&ctx_simd, toHash, lenToHash);
-                sph_simd512_close(&ctx_simd, static_cast<void*>(&hash[i]));
-                break;
-            case 10:
-                sph_echo512_init(&ctx_echo);
-                sph_echo512 (&ctx_echo, toHash, lenToHash);
-                sph_echo512_close(&ctx_echo, static_cast<void*>(&hash[i]));
-                break;
-            case 11:
-                sph_hamsi512_init(&ctx_hamsi);
-                sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
-                sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(&hash[i]));
-                break;
-            case 12:
-                sph_fugue512_init(&ctx_fugue);
-                sph_fugue512 (&ctx_fugue, toHash, lenToHash);
-                sph_fugue512_close(&ctx_fugue, static_cast<void*>(&hash[i]));
-                break;
-            case 13:
-                sph_shabal512_init(&ctx_shabal);
-                sph_shabal512 (&ctx_shabal, toHash, lenToHash);
-                sph_shabal512_close(&ctx_shabal, static_cast<void*>(&hash[i]));
-                break;
-            case 14:
-                sph_whirlpool_init(&ctx_whirlpool);
-                sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
-                sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(&hash[i]));
-                break;
-            case 15:
-                sph_sha512_init(&ctx_sha512);
-                sph_sha512 (&ctx_sha512, toHash, lenToHash);
-                sph_sha512_close(&ctx_sha512, static_cast<void*>(&hash[i]));
-                break;
-        }
-    }
-
-    return hash[15].trim256();
+    const unsigned char* data = pbegin == pend ? pblank : reinterpret_cast<const unsigned char*>(&pbegin[0]);
+    return HashX16R(data, (pend - pbegin) * sizeof(pbegin[0]), PrevBlockHash);
 }
 
 template<typename T1>
 inline uint256 HashX16RV2(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
 {
-//      static std::chrono::duration<double>[16];
-    int hashSelection;
-
-    sph_blake512_context     ctx_blake;      //0
-    sph_bmw512_context       ctx_bmw;        //1
-    sph_groestl512_context   ctx_groestl;    //2
-    sph_jh512_context        ctx_jh;         //3
-    sph_keccak512_context    ctx_keccak;     //4
-    sph_skein512_context     ctx_skein;      //5
-    sph_luffa512_context     ctx_luffa;      //6
-    sph_cubehash512_context  ctx_cubehash;   //7
-    sph_shavite512_context   ctx_shavite;    //8
-    sph_simd512_context      ctx_simd;       //9
-    sph_echo512_context      ctx_echo;       //A
-    sph_hamsi512_context     ctx_hamsi;      //B
-    sph_fugue512_context     ctx_fugue;      //C
-    sph_shabal512_context    ctx_shabal;     //D
-    sph_whirlpool_context    ctx_whirlpool;  //E
-
-    sph_sha512_context        ctx_sha512;
-    sph_tiger_context         ctx_tiger;
-
-
-
     static unsigned char pblank[1];
-
-    uint512 hash[16];
-
-    for (int i=0;i<16;i++)
-    {
-        const void *toHash;
-        int lenToHash;
-        if (i == 0) {
-            toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-            lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
-        } else {
-            toHash = static_cast<const void*>(&hash[i-1]);
-            lenToHash = 64;
-        }
-
-        hashSelection = GetHashSelection(PrevBlockHash, i);
-
-        switch(hashSelection) {
-            case 0:
-                sph_blake512_init(&ctx_blake);
-                sph_blake512 (&ctx_blake, toHash, lenToHash);
-                sph_blake512_close(&ctx_blake, static_cast<void*>(&hash[i]));
-                break;
-            case 1:
-                sph_bmw512_init(&ctx_bmw);
-                sph_bmw512 (&ctx_bmw, toHash, lenToHash);
-                sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[i]));
-                break;
-            case 2:
-                sph_groestl512_init(&ctx_groestl);
-                sph_groestl512 (&ctx_groestl, toHash, lenToHash);
-                sph_groestl512_close(&ctx_groestl, static_cast<void*>(&hash[i]));
-                break;
-            case 3:
-                sph_jh512_init(&ctx_jh);
-                sph_jh512 (&ctx_jh, toHash, lenToHash);
-                sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[i]));
-                break;
-            case 4:
-                sph_tiger_init(&ctx_tiger);
-                sph_tiger (&ctx_tiger, toHash, lenToHash);
-                sph_tiger_close(&ctx_tiger, static_cast<void*>(&hash[i]));
-
-                sph_keccak512_init(&ctx_keccak);
-                sph_keccak512 (&ctx_keccak, static_cast<const void*>(&hash[i]), 64);
-                sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hash[i]));
-                break;
-            case 5:
-                sph_skein512_init(&ctx_skein);
-                sph_skein512 (&ctx_skein, toHash, lenToHash);
-                sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[i]));
-                break;
-            case 6:
-                sph_tiger_init(&ctx_tiger);
-                sph_tiger (&ctx_tiger, toHash, lenToHash);
-                sph_tiger_close(&ctx_tiger, static_cast<void*>(&hash[i]));
-
-                sph_luffa512_init(&ctx_luffa);
-                sph_luffa512 (&ctx_luffa, static_cast<const void*>(&hash[i]), 64);
-                sph_luffa512_close(&ctx_luffa, static_cast<void*>(&hash[i]));
-                break;
-            case 7:
-                sph_cubehash512_init(&ctx_cubehash);
-                sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
-                sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(&hash[i]));
-                break;
-            case 8:
-                sph_shavite512_init(&ctx_shavite);
-                sph_shavite512(&ctx_shavite, toHash, lenToHash);
-                sph_shavite512_close(&ctx_shavite, static_cast<void*>(&hash[i]));
-                break;
-            case 9:
-                sph_simd512_init(&ctx_simd);
-                sph_simd512 (&ctx_simd, toHash, lenToHash);
-                sph_simd512_close(&ctx_simd, static_cast<void*>(&hash[i]));
-                break;
-            case 10:
-                sph_echo512_init(&ctx_echo);
-                sph_echo512 (&ctx_echo, toHash, lenToHash);
-                sph_echo512_close(&ctx_echo, static_cast<void*>(&hash[i]));
-                break;
-            case 11:
-                sph_hamsi512_init(&ctx_hamsi);
-                sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
-                sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(&hash[i]));
-                break;
-            case 12:
-                sph_fugue512_init(&ctx_fugue);
-                sph_fugue512 (&ctx_fugue, toHash, lenToHash);
-                sph_fugue512_close(&ctx_fugue, static_cast<void*>(&hash[i]));
-                break;
-            case 13:
-                sph_shabal512_init(&ctx_shabal);
-                sph_shabal512 (&ctx_shabal, toHash, lenToHash);
-                sph_shabal512_close(&ctx_shabal, static_cast<void*>(&hash[i]));
-                break;
-            case 14:
-                sph_whirlpool_init(&ctx_whirlpool);
-                sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
-                sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(&hash[i]));
-                break;
-            case 15:
-                sph_tiger_init(&ctx_tiger);
-                sph_tiger (&ctx_tiger, toHash, lenToHash);
-                sph_tiger_close(&ctx_tiger, static_cast<void*>(&hash[i]));
-
-                sph_sha512_init(&ctx_sha512);
-                sph_sha512 (&ctx_sha512, static_cast<const void*>(&hash[i]), 64);
-                sph_sha512_close(&ctx_sha512, static_cast<void*>(&hash[i]));
-                break;
-        }
-    }
-
-    return hash[15].trim256();
+    const unsigned char* data = pbegin == pend ? pblank : reinterpret_cast<const unsigned char*>(&pbegin[0]);
+    return HashX16RV2(data, (pend - pbegin) * sizeof(pbegin[0]), PrevBlockHash);
 }
 
+/** Convert between uint256 and the ethash hash type without going through hex strings. */
+ethash::hash256 ToHash256(const uint256& hash);
+uint256 FromHash256(const ethash::hash256& hash);
+
 uint256 KAWPOWHash(const CBlockHeader& blockHeader, uint256& mix_hash);
 uint256 KAWPOWHash_OnlyMix(const CBlockHeader& blockHeader);
 
@@ -0,0 +1,254 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/address.h"
+
+#include "coins.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/thread.hpp>
+
+static const char DB_ADDRESSINDEX = 'a';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+
+std::unique_ptr<CAddressIndex> g_addressindex;
+
+int GetIndexAddress(const CTxOut& out, bool fAssets, uint160& hashBytes, std::string& assetName, CAmount& nAmount)
+{
+    const CScript& script = out.scriptPubKey;
+    assetName = MEWC;
+    nAmount = out.nValue;
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+2, script.begin()+22));
+        return 2;
+    }
+    if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+3, script.begin()+23));
+        return 1;
+    }
+    if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin()+1, script.end()-1);
+        return 1;
+    }
+    /** MEWC START */
+    if (fAssets && ParseAssetScript(script, hashBytes, assetName, nAmount))
+        return 1;
+    /** MEWC END */
+    hashBytes.SetNull();
+    assetName = MEWC;
+    nAmount = out.nValue;
+    return 0;
+}
+
+CAddressIndex::CAddressIndex(size_t nCacheSize, bool fMemory, bool fWipe) :
+    CBaseIndex("addressindex", GetDataDir() / "indexes" / "address", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CAddressIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    uint160 hashBytes;
+    std::string assetName;
+    CAmount nAmount;
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txhash = tx.GetHash();
+
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+            for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                int type = GetIndexAddress(coin.out, info.fAssets, hashBytes, assetName, nAmount);
+                if (type == 0)
+                    continue;
+                // record spending activity and remove the output from the unspent index
+                batch.Write(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hashBytes, assetName, info.nHeight, i, txhash, j, true)), nAmount * -1);
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hashBytes, assetName, tx.vin[j].prevout.hash, tx.vin[j].prevout.n)));
+            }
+        }
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            int type = GetIndexAddress(out, info.fAssets, hashBytes, assetName, nAmount);
+            if (type == 0)
+                continue;
+            // record receiving activity and the unspent output
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hashBytes, assetName, info.nHeight, i, txhash, k, false)), nAmount);
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hashBytes, assetName, txhash, k)),
+                CAddressUnspentValue(nAmount, out.scriptPubKey, info.nHeight));
+        }
+    }
+    return true;
+}
+
+bool CAddressIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    uint160 hashBytes;
+    std::string assetName;
+    CAmount nAmount;
+    // undo transactions in reverse order, so outputs spent within the block end up erased
+    for (unsigned int i = block.vtx.size(); i-- > 0;) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txhash = tx.GetHash();
+
+        for (unsigned int k = tx.vout.size(); k-- > 0;) {
+            int type = GetIndexAddress(tx.vout[k], info.fAssets, hashBytes, assetName, nAmount);
+            if (type == 0)
+                continue;
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hashBytes, assetName, info.nHeight, i, txhash, k, false)));
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hashBytes, assetName, txhash, k)));
+        }
+
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+            for (unsigned int j = tx.vin.size(); j-- > 0;) {
+                const Coin& coin = txundo.vprevout[j];
+                int type = GetIndexAddress(coin.out, info.fAssets, hashBytes, assetName, nAmount);
+                if (type == 0)
+                    continue;
+                // undo spending activity and restore the unspent output
+                batch.Erase(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hashBytes, assetName, info.nHeight, i, txhash, j, true)));
+                batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hashBytes, assetName, tx.vin[j].prevout.hash, tx.vin[j].prevout.n)),
+                    CAddressUnspentValue(nAmount, coin.out.scriptPubKey, coin.nHeight));
+            }
+        }
+    }
+    return true;
+}
+
+static bool SameKey(const CAddressIndexKey& a, const CAddressIndexKey& b)
+{
+    return a.asset == b.asset && a.blockHeight == b.blockHeight && a.txindex == b.txindex &&
+           a.txhash == b.txhash && a.index == b.index && a.spending == b.spending;
+}
+
+static bool SameKey(const CAddressUnspentKey& a, const CAddressUnspentKey& b)
+{
+    return a.asset == b.asset && a.txhash == b.txhash && a.index == b.index;
+}
+
+bool CAddressIndex::ForEachAddressIndex(uint160 addressHash, int type, const std::string& assetName, int start, int end,
+                                        const CAddressIndexKey* pkeyAfter,
+                                        const std::function<bool(const CAddressIndexKey&, CAmount)>& func)
+{
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+
+    if (pkeyAfter) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, *pkeyAfter));
+    } else if (!assetName.empty() && start > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, assetName, start)));
+    } else if (!assetName.empty()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != (unsigned int)type ||
+                key.second.hashBytes != addressHash || (!assetName.empty() && key.second.asset != assetName))
+            break;
+        if (pkeyAfter && SameKey(key.second, *pkeyAfter))
+            continue;
+        if (start > 0 && key.second.blockHeight < start)
+            continue;
+        if (end > 0 && key.second.blockHeight > end) {
+            // heights only increase within an asset
+            if (!assetName.empty())
+                break;
+            continue;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+        if (!func(key.second, nValue))
+            break;
+    }
+
+    return true;
+}
+
+bool CAddressIndex::ForEachAddressUnspent(uint160 addressHash, int type, const std::string& assetName,
+                                          const CAddressUnspentKey* pkeyAfter,
+                                          const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& func)
+{
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+
+    if (pkeyAfter) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, *pkeyAfter));
+    } else if (!assetName.empty()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != (unsigned int)type ||
+                key.second.hashBytes != addressHash || (!assetName.empty() && key.second.asset != assetName))
+            break;
+        if (pkeyAfter && SameKey(key.second, *pkeyAfter))
+            continue;
+        CAddressUnspentValue nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address unspent value");
+        if (!func(key.second, nValue))
+            break;
+    }
+
+    return true;
+}
+
+bool CAddressIndex::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+    return ForEachAddressUnspent(addressHash, type, assetName, nullptr,
+        [&unspentOutputs](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+            unspentOutputs.push_back(std::make_pair(key, value));
+            return true;
+        });
+}
+
+bool CAddressIndex::ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+    return ForEachAddressUnspent(addressHash, type, "", nullptr,
+        [&unspentOutputs](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+            if (key.asset != "MEWC") {
+                unspentOutputs.push_back(std::make_pair(key, value));
+            }
+            return true;
+        });
+}
+
+bool CAddressIndex::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                     int start, int end) {
+    return ForEachAddressIndex(addressHash, type, assetName, start, end, nullptr,
+        [&addressIndex](const CAddressIndexKey& key, CAmount nValue) {
+            addressIndex.push_back(std::make_pair(key, nValue));
+            return true;
+        });
+}
+
+bool CAddressIndex::ReadAddressIndex(uint160 addressHash, int type,
+                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                     int start, int end) {
+
+    return ReadAddressIndex(addressHash, type, "", addressIndex, start, end);
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEOWCOIN_INDEX_ADDRESS_H
+#define MEOWCOIN_INDEX_ADDRESS_H
+
+#include "addressindex.h"
+#include "index/base.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CTxOut;
+
+/**
+ * The address an output pays to as the address and spent indexes record it:
+ * 2 for P2SH, 1 for P2PKH, P2PK and, if fAssets, asset scripts, 0 for anything
+ * else. assetName and nAmount are the asset and amount the output carries.
+ */
+int GetIndexAddress(const CTxOut& out, bool fAssets, uint160& hashBytes, std::string& assetName, CAmount& nAmount);
+
+/**
+ * -addressindex: the coins received and spent by each address, and the
+ * unspent outputs of each address, in indexes/address.
+ */
+class CAddressIndex : public CBaseIndex
+{
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+
+public:
+    explicit CAddressIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /**
+     * Visit the entries of an address in key order, which is by asset, then
+     * height and position in the block, without loading them all. An empty
+     * assetName visits every asset; start and end, if positive, bound the
+     * height. With pkeyAfter, start right after that key. Stops early when
+     * func returns false.
+     */
+    bool ForEachAddressIndex(uint160 addressHash, int type, const std::string& assetName, int start, int end,
+                             const CAddressIndexKey* pkeyAfter,
+                             const std::function<bool(const CAddressIndexKey&, CAmount)>& func);
+    /** Visit the unspent outputs of an address in key order, like ForEachAddressIndex */
+    bool ForEachAddressUnspent(uint160 addressHash, int type, const std::string& assetName,
+                               const CAddressUnspentKey* pkeyAfter,
+                               const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& func);
+
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                          int start = 0, int end = 0);
+    bool ReadAddressIndex(uint160 addressHash, int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                          int start = 0, int end = 0);
+};
+
+/** The address index, if -addressindex */
+extern std::unique_ptr<CAddressIndex> g_addressindex;
+
+#endif // MEOWCOIN_INDEX_ADDRESS_H
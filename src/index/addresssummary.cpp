@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/addresssummary.h"
+
+#include "coins.h"
+#include "index/address.h"
+#include "primitives/block.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+
+#include <map>
+
+#include <boost/thread.hpp>
+
+static const char DB_ADDRESSSUMMARY = 's';
+static const char DB_SUMMARY_UNDO = 'U';
+
+std::unique_ptr<CAddressSummaryIndex> g_addresssummaryindex;
+
+namespace {
+
+/** What a block changes in the summary of an address */
+struct SummaryDelta {
+    CAmount balance = 0;
+    CAmount received = 0;
+    int64_t txCount = 0;
+    //! Position in the block of the last transaction counted
+    int nLastTx = -1;
+
+    void Add(int nTx, CAmount nAmount)
+    {
+        balance += nAmount;
+        if (nAmount > 0)
+            received += nAmount;
+        if (nTx != nLastTx) {
+            txCount++;
+            nLastTx = nTx;
+        }
+    }
+};
+
+} // namespace
+
+CAddressSummaryIndex::CAddressSummaryIndex(size_t nCacheSize, bool fMemory, bool fWipe) :
+    CBaseIndex("addresssummaryindex", GetDataDir() / "indexes" / "addresssummary", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CAddressSummaryIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    // Add up the block first, so each summary is read and written once
+    std::map<CAddressSummaryKey, SummaryDelta> deltas;
+    uint160 hashBytes;
+    std::string assetName;
+    CAmount nAmount;
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+            for (const Coin& coin : txundo.vprevout) {
+                int type = GetIndexAddress(coin.out, info.fAssets, hashBytes, assetName, nAmount);
+                if (type != 0)
+                    deltas[CAddressSummaryKey(type, hashBytes, assetName)].Add(i, -nAmount);
+            }
+        }
+        for (const CTxOut& out : tx.vout) {
+            int type = GetIndexAddress(out, info.fAssets, hashBytes, assetName, nAmount);
+            if (type != 0)
+                deltas[CAddressSummaryKey(type, hashBytes, assetName)].Add(i, nAmount);
+        }
+    }
+
+    std::vector<std::pair<CAddressSummaryKey, CAddressSummary> > vUndo;
+    vUndo.reserve(deltas.size());
+    for (const auto& it : deltas) {
+        CAddressSummary summary;
+        if (!ReadAddressSummary(it.first, summary))
+            return error("%s: failed to read address summary", __func__);
+        vUndo.emplace_back(it.first, summary);
+        if (summary.IsNull())
+            summary.firstHeight = info.nHeight;
+        summary.balance += it.second.balance;
+        summary.received += it.second.received;
+        summary.txCount += it.second.txCount;
+        summary.lastHeight = info.nHeight;
+        batch.Write(std::make_pair(DB_ADDRESSSUMMARY, it.first), summary);
+    }
+    // Kept for every block, as a reorg or invalidateblock can disconnect a block at any depth
+    batch.Write(std::make_pair(DB_SUMMARY_UNDO, info.nHeight), std::make_pair(info.hash, vUndo));
+    return true;
+}
+
+bool CAddressSummaryIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    std::pair<uint256, std::vector<std::pair<CAddressSummaryKey, CAddressSummary> > > undo;
+    if (!db->Read(std::make_pair(DB_SUMMARY_UNDO, info.nHeight), undo) || undo.first != info.hash)
+        return error("%s: no summary undo data for block %s", __func__, info.hash.ToString());
+    for (const auto& it : undo.second) {
+        if (it.second.IsNull())
+            batch.Erase(std::make_pair(DB_ADDRESSSUMMARY, it.first));
+        else
+            batch.Write(std::make_pair(DB_ADDRESSSUMMARY, it.first), it.second);
+    }
+    batch.Erase(std::make_pair(DB_SUMMARY_UNDO, info.nHeight));
+    return true;
+}
+
+bool CAddressSummaryIndex::ReadAddressSummary(const CAddressSummaryKey& key, CAddressSummary& summary)
+{
+    if (!db->Read(std::make_pair(DB_ADDRESSSUMMARY, key), summary))
+        summary.SetNull();
+    return true;
+}
+
+bool CAddressSummaryIndex::ReadAddressSummaries(uint160 addressHash, int type, std::vector<std::pair<CAddressSummaryKey, CAddressSummary> >& summaries)
+{
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSSUMMARY, CAddressIndexIteratorKey(type, addressHash)));
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressSummaryKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSSUMMARY || key.second.type != (unsigned int)type ||
+                key.second.hashBytes != addressHash)
+            break;
+        CAddressSummary summary;
+        if (!pcursor->GetValue(summary))
+            return error("failed to get address summary value");
+        summaries.emplace_back(key.second, summary);
+    }
+    return true;
+}
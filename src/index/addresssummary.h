@@ -0,0 +1,41 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEOWCOIN_INDEX_ADDRESSSUMMARY_H
+#define MEOWCOIN_INDEX_ADDRESSSUMMARY_H
+
+#include "addressindex.h"
+#include "index/base.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * -addresssummaryindex: the balance, amount received, number of transactions
+ * and first and last height of each address in each asset, in
+ * indexes/addresssummary, so a balance is one lookup however long the
+ * history of the address. Each block also keeps the summaries it replaced,
+ * which is what disconnecting it puts back.
+ */
+class CAddressSummaryIndex : public CBaseIndex
+{
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+
+public:
+    explicit CAddressSummaryIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** The summary of an address in one asset, null if the address never used it */
+    bool ReadAddressSummary(const CAddressSummaryKey& key, CAddressSummary& summary);
+    /** The summaries of an address in every asset it used */
+    bool ReadAddressSummaries(uint160 addressHash, int type, std::vector<std::pair<CAddressSummaryKey, CAddressSummary> >& summaries);
+};
+
+/** The address summary index, if -addresssummaryindex */
+extern std::unique_ptr<CAddressSummaryIndex> g_addresssummaryindex;
+
+#endif // MEOWCOIN_INDEX_ADDRESSSUMMARY_H
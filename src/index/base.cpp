@@ -0,0 +1,386 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/base.h"
+
+#include "chainparams.h"
+#include "init.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+#include "versionbits.h"
+#include "warnings.h"
+
+
+static const char DB_BEST_BLOCK = 'B';
+static const char DB_PENDING_BLOCK = 'P';
+
+/** Blocks queued with their contents; beyond this the thread reads them from disk */
+static const size_t MAX_QUEUED_BLOCKS = 32;
+
+namespace {
+
+/**
+ * Where to find a block the index wrote, kept until the block tree database
+ * has the block, so it can be taken out of the index after a crash.
+ */
+struct CPendingBlock
+{
+    uint256 hashPrev;
+    int nHeight;
+    CDiskBlockPos pos;
+    CDiskBlockPos posUndo;
+    bool fAssets;
+
+    CPendingBlock() : nHeight(0), fAssets(false) {}
+    CPendingBlock(const uint256& hashPrevIn, int nHeightIn, const CDiskBlockPos& posIn, const CDiskBlockPos& posUndoIn, bool fAssetsIn) :
+        hashPrev(hashPrevIn), nHeight(nHeightIn), pos(posIn), posUndo(posUndoIn), fAssets(fAssetsIn) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashPrev);
+        READWRITE(nHeight);
+        READWRITE(pos);
+        READWRITE(posUndo);
+        READWRITE(fAssets);
+    }
+};
+
+bool FatalError(const std::string& strMessage)
+{
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+    return false;
+}
+
+/** Whether ConnectBlock indexed asset scripts for the block, which is when assets were active at its parent */
+bool AssetsActiveFor(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    return VersionBitsState(pindex->pprev, GetParams().GetConsensus(), Consensus::DEPLOYMENT_ASSETS, versionbitscache) == THRESHOLD_ACTIVE;
+}
+
+} // namespace
+
+CBaseIndex::CBaseIndex(const std::string& strNameIn, const fs::path& pathIn, size_t nCacheSize, bool fMemoryIn, bool fWipe) :
+    strName(strNameIn), path(pathIn), dbOptions(DBOptionsFromArgs(strNameIn, nCacheSize)), fMemory(fMemoryIn),
+    nQueued(0), nDone(0), fInterrupt(false), fSynced(false), pindexBest(nullptr), nBestHeight(-1),
+    db(new CDBWrapper(pathIn, dbOptions, fMemoryIn, fWipe))
+{
+}
+
+CBaseIndex::~CBaseIndex()
+{
+    Stop();
+}
+
+bool CBaseIndex::Interrupted()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return fInterrupt;
+}
+
+/**
+ * Take the blocks the block index does not know out of the index, from the
+ * positions stored when they were written. If those are missing or unreadable,
+ * the index is rebuilt from scratch.
+ */
+bool CBaseIndex::RewindUnknown(const uint256& hashBest)
+{
+    uint256 hash = hashBest;
+    while (true) {
+        {
+            LOCK(cs_main);
+            BlockMap::const_iterator it = mapBlockIndex.find(hash);
+            if (it != mapBlockIndex.end()) {
+                SetBest(it->second);
+                return true;
+            }
+        }
+
+        CPendingBlock pending;
+        CBlock block;
+        CBlockUndo blockundo;
+        if (!db->Read(std::make_pair(DB_PENDING_BLOCK, hash), pending) ||
+                !ReadBlockFromDisk(block, pending.pos, GetParams().GetConsensus()) || block.GetHash() != hash ||
+                !UndoReadFromDisk(blockundo, pending.posUndo, pending.hashPrev)) {
+            LogPrintf("%s: cannot take unknown block %s out of the %s, rebuilding it\n", __func__, hash.ToString(), strName);
+            db.reset();
+            db.reset(new CDBWrapper(path, dbOptions, fMemory, true));
+            SetBest(nullptr);
+            return true;
+        }
+
+        CDBBatch batch(*db);
+        if (!EraseBlock(batch, block, blockundo, BlockInfo{hash, pending.nHeight, pending.fAssets}))
+            return error("%s: failed to erase block %s from the %s", __func__, hash.ToString(), strName);
+        batch.Erase(std::make_pair(DB_PENDING_BLOCK, hash));
+        batch.Write(DB_BEST_BLOCK, pending.hashPrev);
+        db->WriteBatch(batch, true);
+        LogPrintf("%s: took unknown block %s out of the %s\n", __func__, hash.ToString(), strName);
+        hash = pending.hashPrev;
+    }
+}
+
+/** Forget the stored positions of the blocks the block tree database has by now. */
+bool CBaseIndex::ForgetPendingBlocks()
+{
+    CDBBatch batch(*db);
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_PENDING_BLOCK, uint256())); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_PENDING_BLOCK)
+            break;
+        if (pblocktree->HaveBlockIndex(key.second))
+            batch.Erase(key);
+    }
+    return db->WriteBatch(batch);
+}
+
+void CBaseIndex::SetBest(const CBlockIndex* pindex)
+{
+    pindexBest = pindex;
+    nBestHeight = pindex ? pindex->nHeight : -1;
+}
+
+bool CBaseIndex::Init()
+{
+    uint256 hashBest;
+    if (db->Read(DB_BEST_BLOCK, hashBest) && !hashBest.IsNull()) {
+        if (!RewindUnknown(hashBest))
+            return false;
+    }
+    if (!ForgetPendingBlocks())
+        return false;
+    LogPrintf("%s: %s at height %d\n", __func__, strName, pindexBest ? pindexBest->nHeight : -1);
+    return true;
+}
+
+bool CBaseIndex::ApplyBlock(JobType type, const CBlock& block, const CBlockIndex* pindex, const CDiskBlockPos& posUndo, bool fAssets)
+{
+    const BlockInfo info{pindex->GetBlockHash(), pindex->nHeight, fAssets};
+    CBlockUndo blockundo;
+    if (pindex->pprev && !UndoReadFromDisk(blockundo, posUndo, pindex->pprev->GetBlockHash()))
+        return error("%s: failed to read undo data of block %s", __func__, info.hash.ToString());
+
+    CDBBatch batch(*db);
+    if (type == JOB_CONNECT) {
+        if (pindex->pprev) {
+            if (!WriteBlock(batch, block, blockundo, info))
+                return error("%s: failed to write block %s to the %s", __func__, info.hash.ToString(), strName);
+            CPendingBlock pending(pindex->pprev->GetBlockHash(), pindex->nHeight, pindex->GetBlockPos(), posUndo, fAssets);
+            batch.Write(std::make_pair(DB_PENDING_BLOCK, info.hash), pending);
+        }
+        batch.Write(DB_BEST_BLOCK, info.hash);
+        db->WriteBatch(batch);
+        SetBest(pindex);
+    } else {
+        if (pindex->pprev && !EraseBlock(batch, block, blockundo, info))
+            return error("%s: failed to erase block %s from the %s", __func__, info.hash.ToString(), strName);
+        batch.Erase(std::make_pair(DB_PENDING_BLOCK, info.hash));
+        batch.Write(DB_BEST_BLOCK, pindex->pprev ? pindex->pprev->GetBlockHash() : uint256());
+        db->WriteBatch(batch);
+        SetBest(pindex->pprev);
+    }
+    return true;
+}
+
+void CBaseIndex::ThreadSync()
+{
+    RenameThread(("meowcoin-" + strName).c_str());
+    const Consensus::Params& consensusParams = GetParams().GetConsensus();
+    try {
+        // Catch up with the active chain from disk, going back first if the
+        // index is on a fork of it.
+        int64_t nLastLog = GetTime();
+        while (true) {
+            if (Interrupted())
+                return;
+            JobType type = JOB_CONNECT;
+            const CBlockIndex* pindex;
+            CDiskBlockPos pos, posUndo;
+            bool fAssets;
+            {
+                LOCK(cs_main);
+                if (pindexBest && !chainActive.Contains(pindexBest)) {
+                    type = JOB_DISCONNECT;
+                    pindex = pindexBest;
+                } else {
+                    pindex = pindexBest ? chainActive.Next(pindexBest) : chainActive.Genesis();
+                    if (!pindex) {
+                        fSynced = true;
+                        break;
+                    }
+                }
+                pos = pindex->GetBlockPos();
+                posUndo = pindex->GetUndoPos();
+                fAssets = AssetsActiveFor(pindex);
+            }
+
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pos, consensusParams)) {
+                FatalError(strprintf("%s: failed to read block %s for the %s", __func__, pindex->GetBlockHash().ToString(), strName));
+                break;
+            }
+            if (!ApplyBlock(type, block, pindex, posUndo, fAssets)) {
+                FatalError(strprintf("%s: failed to update the %s", __func__, strName));
+                break;
+            }
+            if (GetTime() - nLastLog >= 30) {
+                LogPrintf("%s is catching up with the chain at height %d\n", strName, pindex->nHeight);
+                nLastLog = GetTime();
+            }
+        }
+        if (fSynced)
+            LogPrintf("%s is in sync with the chain at height %d\n", strName, pindexBest ? pindexBest->nHeight : -1);
+
+        // Follow the chain through the notifications.
+        while (fSynced) {
+            Job job;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (queue.empty() && !fInterrupt)
+                    cond.wait(lock);
+                if (fInterrupt)
+                    return;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            bool fOk = true;
+            if (job.type == JOB_FLUSHED) {
+                fOk = ForgetPendingBlocks();
+            } else if ((job.type == JOB_CONNECT && job.pindex->pprev != pindexBest) ||
+                    (job.type == JOB_DISCONNECT && job.pindex != pindexBest)) {
+                fOk = error("%s: %s is at %s, out of step with block %s", __func__, strName,
+                    pindexBest ? pindexBest->GetBlockHash().ToString() : "null", job.pindex->GetBlockHash().ToString());
+            } else {
+                std::shared_ptr<const CBlock> pblock = job.pblock;
+                if (!pblock) {
+                    std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+                    if (ReadBlockFromDisk(*pblockRead, job.pindex->GetBlockPos(), consensusParams))
+                        pblock = pblockRead;
+                }
+                fOk = pblock && ApplyBlock(job.type, *pblock, job.pindex, job.posUndo, job.fAssets);
+            }
+            if (!fOk) {
+                FatalError(strprintf("%s: failed to update the %s", __func__, strName));
+                break;
+            }
+
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                nDone++;
+            }
+            cond.notify_all();
+        }
+    } catch (const std::exception& e) {
+        FatalError(strprintf("%s: %s: %s", __func__, strName, e.what()));
+    }
+
+    // Release BlockUntilSyncedToCurrentChain after a failure.
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fInterrupt = true;
+    }
+    cond.notify_all();
+}
+
+void CBaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    LOCK(cs_main);
+    if (!fSynced)
+        return;
+    Job job{JOB_CONNECT, pblock, pindex, pindex->GetUndoPos(), AssetsActiveFor(pindex)};
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (queue.size() >= MAX_QUEUED_BLOCKS)
+            job.pblock = nullptr;
+        queue.push_back(std::move(job));
+        nQueued++;
+    }
+    cond.notify_all();
+}
+
+void CBaseIndex::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock)
+{
+    LOCK(cs_main);
+    if (!fSynced)
+        return;
+    BlockMap::const_iterator it = mapBlockIndex.find(pblock->GetHash());
+    if (it == mapBlockIndex.end())
+        return;
+    Job job{JOB_DISCONNECT, pblock, it->second, it->second->GetUndoPos(), AssetsActiveFor(it->second)};
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (queue.size() >= MAX_QUEUED_BLOCKS)
+            job.pblock = nullptr;
+        queue.push_back(std::move(job));
+        nQueued++;
+    }
+    cond.notify_all();
+}
+
+void CBaseIndex::SetBestChain(const CBlockLocator& locator)
+{
+    // The block index may have been written, so the stored positions of the
+    // blocks it has can go.
+    LOCK(cs_main);
+    if (!fSynced)
+        return;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        queue.push_back(Job{JOB_FLUSHED, nullptr, nullptr, CDiskBlockPos(), false});
+        nQueued++;
+    }
+    cond.notify_all();
+}
+
+bool CBaseIndex::Start()
+{
+    if (!Init())
+        return false;
+    RegisterValidationInterface(this);
+    thread = std::thread(&CBaseIndex::ThreadSync, this);
+    return true;
+}
+
+void CBaseIndex::Stop()
+{
+    UnregisterValidationInterface(this);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fInterrupt = true;
+    }
+    cond.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+bool CBaseIndex::IsSynced() const
+{
+    LOCK(cs_main);
+    return fSynced;
+}
+
+bool CBaseIndex::BlockUntilSyncedToCurrentChain()
+{
+    {
+        LOCK(cs_main);
+        if (!fSynced)
+            return false;
+    }
+    boost::unique_lock<boost::mutex> lock(mutex);
+    const uint64_t nTarget = nQueued;
+    while (nDone < nTarget && !fInterrupt)
+        cond.wait(lock);
+    return nDone >= nTarget;
+}
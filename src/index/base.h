@@ -0,0 +1,131 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEOWCOIN_INDEX_BASE_H
+#define MEOWCOIN_INDEX_BASE_H
+
+#include "chain.h"
+#include "dbwrapper.h"
+#include "primitives/block.h"
+#include "uint256.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+class CBlockUndo;
+
+/**
+ * Base of the optional indexes that have a database of their own under
+ * indexes/. They are not written by ConnectBlock: the thread of an index first
+ * brings it up to date with the active chain from the block and undo files,
+ * and then follows the chain through BlockConnected and BlockDisconnected,
+ * which only queue the blocks. Index writes therefore never hold up block
+ * validation, and a compaction of one index database stalls nothing else.
+ *
+ * Each block is written in one batch with the new best block of the index, so
+ * the index matches some chain at all times. The blocks it wrote that the
+ * block tree database may not have yet are also remembered with their disk
+ * positions, so that after a crash they can be taken out again even though
+ * the block index no longer knows them.
+ */
+class CBaseIndex : public CValidationInterface
+{
+public:
+    /** The block being written to or erased from an index */
+    struct BlockInfo {
+        uint256 hash;
+        int nHeight;
+        //! Whether assets were active for the block, so asset scripts are indexed
+        bool fAssets;
+    };
+
+private:
+    enum JobType {
+        JOB_CONNECT,
+        JOB_DISCONNECT,
+        //! The block index may have been flushed, see SetBestChain
+        JOB_FLUSHED,
+    };
+
+    struct Job {
+        JobType type;
+        std::shared_ptr<const CBlock> pblock;
+        const CBlockIndex* pindex;
+        CDiskBlockPos posUndo;
+        bool fAssets;
+    };
+
+    const std::string strName;
+    const fs::path path;
+    const CDBOptions dbOptions;
+    const bool fMemory;
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<Job> queue;
+    //! Number of jobs queued and done, for BlockUntilSyncedToCurrentChain
+    uint64_t nQueued;
+    uint64_t nDone;
+    bool fInterrupt;
+    //! Whether the index caught up with the chain, after which it follows the notifications. Guarded by cs_main
+    bool fSynced;
+    //! Last block written, or null if none. Only changed by the index thread
+    const CBlockIndex* pindexBest;
+    //! Height of pindexBest, for status reports
+    std::atomic<int> nBestHeight;
+
+    std::thread thread;
+
+    bool Init();
+    bool RewindUnknown(const uint256& hashBest);
+    bool ApplyBlock(JobType type, const CBlock& block, const CBlockIndex* pindex, const CDiskBlockPos& posUndo, bool fAssets);
+    bool ForgetPendingBlocks();
+    void SetBest(const CBlockIndex* pindex);
+    bool Interrupted();
+    void ThreadSync();
+
+protected:
+    std::unique_ptr<CDBWrapper> db;
+
+    CBaseIndex(const std::string& strNameIn, const fs::path& pathIn, size_t nCacheSize, bool fMemoryIn, bool fWipe);
+
+    /** Add the entries of a block to batch. Not called for the genesis block */
+    virtual bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) = 0;
+    /** Add to batch what undoes WriteBlock for the same block */
+    virtual bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) = 0;
+
+    void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
+    void SetBestChain(const CBlockLocator& locator) override;
+
+public:
+    virtual ~CBaseIndex();
+
+    const std::string& GetName() const { return strName; }
+    const CDBWrapper& GetDB() const { return *db; }
+    int GetBestHeight() const { return nBestHeight; }
+    /** Whether the index caught up with the chain and follows it block by block */
+    bool IsSynced() const;
+
+    /** Recover from an unclean shutdown, then start following the chain in a thread of the index */
+    bool Start();
+    /** Stop following the chain. Blocks not written yet are picked up again by the next Start() */
+    void Stop();
+
+    /**
+     * Wait until the index has written every block of the active chain as of
+     * the call, so lookups see the current tip. Returns false at once if the
+     * index is still catching up with the chain. cs_main must not be held.
+     */
+    bool BlockUntilSyncedToCurrentChain();
+};
+
+#endif // MEOWCOIN_INDEX_BASE_H
@@ -0,0 +1,57 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/spent.h"
+
+#include "coins.h"
+#include "index/address.h"
+#include "primitives/block.h"
+#include "undo.h"
+#include "util.h"
+
+static const char DB_SPENTINDEX = 'p';
+
+std::unique_ptr<CSpentIndex> g_spentindex;
+
+CSpentIndex::CSpentIndex(size_t nCacheSize, bool fMemory, bool fWipe) :
+    CBaseIndex("spentindex", GetDataDir() / "indexes" / "spent", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CSpentIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    uint160 hashBytes;
+    std::string assetName;
+    CAmount nAmount;
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& txundo = blockundo.vtxundo[i-1];
+        if (txundo.vprevout.size() != tx.vin.size())
+            return error("%s: transaction and undo data inconsistent", __func__);
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            const CTxOut& prevout = txundo.vprevout[j].out;
+            int type = GetIndexAddress(prevout, info.fAssets, hashBytes, assetName, nAmount);
+            // the txid and input that spent an output, and the amount and address of the output
+            batch.Write(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(tx.vin[j].prevout.hash, tx.vin[j].prevout.n)),
+                CSpentIndexValue(tx.GetHash(), j, info.nHeight, prevout.nValue, type, hashBytes));
+        }
+    }
+    return true;
+}
+
+bool CSpentIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        for (const CTxIn& txin : block.vtx[i]->vin)
+            batch.Erase(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(txin.prevout.hash, txin.prevout.n)));
+    }
+    return true;
+}
+
+bool CSpentIndex::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
+    return db->Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEOWCOIN_INDEX_SPENT_H
+#define MEOWCOIN_INDEX_SPENT_H
+
+#include "index/base.h"
+#include "spentindex.h"
+
+#include <memory>
+
+/**
+ * -spentindex: for each spent output, the input that spent it with the amount
+ * and address of the output, in indexes/spent.
+ */
+class CSpentIndex : public CBaseIndex
+{
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+
+public:
+    explicit CSpentIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+};
+
+/** The spent index, if -spentindex */
+extern std::unique_ptr<CSpentIndex> g_spentindex;
+
+#endif // MEOWCOIN_INDEX_SPENT_H
@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/timestamp.h"
+
+#include "primitives/block.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/thread.hpp>
+
+static const char DB_TIMESTAMPINDEX = 's';
+static const char DB_BLOCKHASHINDEX = 'z';
+
+std::unique_ptr<CTimestampIndex> g_timestampindex;
+
+CTimestampIndex::CTimestampIndex(size_t nCacheSize, bool fMemory, bool fWipe) :
+    CBaseIndex("timestampindex", GetDataDir() / "indexes" / "timestamp", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CTimestampIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    unsigned int logicalTS = block.nTime;
+    unsigned int prevLogicalTS = 0;
+
+    // retrieve logical timestamp of the previous block
+    if (!ReadTimestampBlockIndex(block.hashPrevBlock, prevLogicalTS))
+        LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+
+    if (logicalTS <= prevLogicalTS) {
+        logicalTS = prevLogicalTS + 1;
+        LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, block.nTime, prevLogicalTS, logicalTS);
+    }
+
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexKey(logicalTS, info.hash)), 0);
+    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(info.hash)), CTimestampBlockIndexValue(logicalTS));
+    return true;
+}
+
+bool CTimestampIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info)
+{
+    // Disconnected blocks stay listed, for getblockhashes without noOrphans,
+    // and get the same logical timestamp if they are connected again.
+    return true;
+}
+
+bool CTimestampIndex::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
+
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
+            if (fActiveOnly) {
+                if (HashOnchainActive(key.second.blockHash)) {
+                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+                }
+            } else {
+                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+            }
+
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CTimestampIndex::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
+
+    CTimestampBlockIndexValue lts;
+    if (!db->Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
+        return false;
+
+    ltimestamp = lts.ltimestamp;
+    return true;
+}
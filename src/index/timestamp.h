@@ -0,0 +1,36 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEOWCOIN_INDEX_TIMESTAMP_H
+#define MEOWCOIN_INDEX_TIMESTAMP_H
+
+#include "index/base.h"
+#include "timestampindex.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * -timestampindex: block hashes by logical timestamp, which is the block time
+ * made strictly increasing along the chain, in indexes/timestamp.
+ */
+class CTimestampIndex : public CBaseIndex
+{
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override;
+
+public:
+    explicit CTimestampIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    /** Blocks with logical timestamps in [low, high). If fActiveOnly, only those in the active chain; cs_main must be held then */
+    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
+    bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+};
+
+/** The timestamp index, if -timestampindex */
+extern std::unique_ptr<CTimestampIndex> g_timestampindex;
+
+#endif // MEOWCOIN_INDEX_TIMESTAMP_H
@@ -15,11 +15,17 @@
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
+#include "coinprefetch.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "ethashprefetch.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "index/address.h"
+#include "index/addresssummary.h"
+#include "index/spent.h"
+#include "index/timestamp.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -74,14 +80,14 @@ using namespace boost::placeholders;
 #include "zmq/zmqnotificationinterface.h"
 #endif
 
-#ifdef USE_SSE2
 #include <crypto/scrypt.h>
-#endif
+#include <crypto/ethash/include/ethash/ethash.h>
 
 bool fFeeEstimatesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+static const bool DEFAULT_PERSIST_ETHASH_CACHE = true;
 
 std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
@@ -207,6 +213,9 @@ void PrepareShutdown()
     FlushWallets();
 #endif
     GenerateMeowcoins(false, 0, GetParams());
+    g_templateassembler.reset();
+    StopEthashPrefetch();
+    StopCoinPrefetch();
 
     MapPort(false);
 
@@ -242,6 +251,19 @@ void PrepareShutdown()
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    // Stop the index threads while the block tree database is still there.
+    // Blocks they did not get to are picked up on the next start. The threads
+    // call into the derived index, so they must be stopped before it is destroyed.
+    for (CBaseIndex* index : {(CBaseIndex*)g_addressindex.get(), (CBaseIndex*)g_addresssummaryindex.get(),
+                              (CBaseIndex*)g_spentindex.get(), (CBaseIndex*)g_timestampindex.get()}) {
+        if (index)
+            index->Stop();
+    }
+    g_addressindex.reset();
+    g_addresssummaryindex.reset();
+    g_spentindex.reset();
+    g_timestampindex.reset();
+
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
     // would too. The only reason to do the above flushes is to let the wallet catch
@@ -448,7 +470,20 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug) {
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
     }
+    strUsage += HelpMessageOpt("-coinprefetch=<n>", strprintf(_("Set the number of threads looking up the coins spent by upcoming blocks before they are connected (0 to disable, up to %d, default: %d)"), MAX_COIN_PREFETCH_THREADS, DEFAULT_COIN_PREFETCH_THREADS));
+    strUsage += HelpMessageOpt("-asyncflush", strprintf(_("Write the coins cache to disk in the background when it fills up, so block validation does not stall; may use up to twice -dbcache meanwhile (default: %u)"), DEFAULT_ASYNC_FLUSH));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    {
+        std::string strDBNames;
+        for (const char* pszName : DB_ARG_NAMES)
+            strDBNames += (strDBNames.empty() ? "" : ", ") + std::string(pszName);
+        strUsage += HelpMessageOpt("-<db>dbcompression=<type>", strprintf(_("Compress the blocks of LevelDB database <db> (one of: %s) with <type>, none or snappy, which applies to newly written files (default: none)%s"),
+            strDBNames, DBCompressionAvailable() ? "" : _("; this build has no snappy")));
+        strUsage += HelpMessageOpt("-<db>dbbloombits=<n>", strprintf(_("Use <n> bits per key for the bloom filters of database <db>, 0 for none (default: %d)"), DEFAULT_DB_BLOOM_BITS));
+        strUsage += HelpMessageOpt("-<db>dbblocksize=<n>", strprintf(_("Set the block size of database <db> in kilobytes (default: %d)"), DEFAULT_DB_BLOCK_SIZE));
+        strUsage += HelpMessageOpt("-<db>dbwritebuffer=<n>", _("Set the write buffer size of database <db> in megabytes (default: a quarter of its cache)"));
+        strUsage += HelpMessageOpt("-<db>dbmaxfilesize=<n>", strprintf(_("Set the table file size of database <db> in megabytes (default: %d)"), DEFAULT_DB_MAX_FILE_SIZE));
+    }
     strUsage += HelpMessageOpt("-disablemessaging", strprintf(_("Turn off the databasing the messages sent with assets (default: %u)"), false));
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
@@ -463,6 +498,8 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()));
     }
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
+    strUsage += HelpMessageOpt("-ethashprefetch=<n>", strprintf(_("Build the next KAWPOW/MEOWPOW epoch context in the background once the tip is within <n> blocks of the epoch boundary (0 to disable, default: %d)"), DEFAULT_ETHASH_PREFETCH_BLOCKS));
+    strUsage += HelpMessageOpt("-persistethashcache", strprintf(_("Whether to keep KAWPOW/MEOWPOW light caches in blocks/ethash and memory-map them on restart (default: %u)"), DEFAULT_PERSIST_ETHASH_CACHE));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
@@ -480,9 +517,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-utxostats", strprintf(_("Maintain a rolling hash and totals of the UTXO set, used by gettxoutsetinfo \"muhash\" (default: %u)"), DEFAULT_UTXOSTATS));
     strUsage += HelpMessageOpt("-assetindex", _("Keep an index of assets, used by the requestsnapshot rpc call. Requires a -reindex."));
 
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-addresssummaryindex", strprintf(_("Maintain the balance and totals of every address, so getaddressbalance does not go through the address history (default: %u)"), DEFAULT_ADDRESSSUMMARYINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
 
@@ -533,6 +572,7 @@ std::string HelpMessage(HelpMessageMode mode)
 #if ENABLE_ZMQ
     strUsage += HelpMessageGroup(_("ZeroMQ notification options:"));
     strUsage += HelpMessageOpt("-zmqpubhashblock=<address>", _("Enable publish hash block in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubblocktemplate=<address>", _("Enable publish block template header on new tips in <address>"));
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
@@ -547,6 +587,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkblocktemplate", strprintf("Check each incrementally updated block template against a full rebuild (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used");
@@ -560,6 +601,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf("Do not accept transactions whose size with all in-mempool ancestors exceeds <n> kilobytes (default: %u)", DEFAULT_ANCESTOR_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)", DEFAULT_DESCENDANT_LIMIT));
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
+        strUsage += HelpMessageOpt("-limitclustercount=<n>", strprintf("Do not accept transactions whose cluster (the transactions joined to them through in-mempool dependencies, including themselves) would have more than <n> transactions (default: %u)", DEFAULT_CLUSTER_LIMIT));
         strUsage += HelpMessageOpt("-vbparams=deployment:start:end", "Use given start/end times for specified version bits deployment (regtest-only)");
     }
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
@@ -605,6 +647,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockmaxweight=<n>", strprintf(_("Set maximum BIP141 block weight (default: %d)"), MAX_BLOCK_WEIGHT - 4000));
     strUsage += HelpMessageOpt("-blockmaxsize=<n>", _("Set maximum BIP141 block weight to this * 4. Deprecated, use blockmaxweight"));
     strUsage += HelpMessageOpt("-blockmintxfee=<amt>", strprintf(_("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)));
+    strUsage += HelpMessageOpt("-incrementaltemplate", strprintf(_("Update the block template of getblocktemplate with the mempool changes since the last one instead of assembling it anew (default: %u)"), DEFAULT_INCREMENTAL_TEMPLATE));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
@@ -1013,6 +1056,9 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || gArgs.GetBoolArg("-addresssummaryindex", DEFAULT_ADDRESSSUMMARYINDEX) ||
+                gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) || gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex, -addresssummaryindex, -spentindex and -timestampindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1089,6 +1135,20 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fUTXOStats = gArgs.GetBoolArg("-utxostats", DEFAULT_UTXOSTATS);
+    fAsyncFlush = gArgs.GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH);
+    fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    fAddressSummaryIndex = gArgs.GetBoolArg("-addresssummaryindex", DEFAULT_ADDRESSSUMMARYINDEX);
+    fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+    fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+
+    for (const char* pszName : DB_ARG_NAMES) {
+        std::string strError;
+        if (!CheckDBOptionsArgs(pszName, strError))
+            return InitError(strError);
+        if (gArgs.GetArg(strprintf("-%sdbcompression", pszName), "none") == "snappy" && !DBCompressionAvailable())
+            InitWarning(strprintf(_("-%sdbcompression=snappy ignored, this build has no snappy."), pszName));
+    }
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1298,6 +1358,8 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string progpow_kernel = ethash_progpow_autodetect();
+    LogPrintf("Using the '%s' ProgPoW kernel\n", progpow_kernel);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1352,8 +1414,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadHeaderPoWCheck);
+            threadGroup.create_thread(&ThreadTxPreVerify);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1380,6 +1445,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     std::string sse2detect = scrypt_detect_sse2();
     LogPrintf("%s\n", sse2detect);
 #endif
+    LogPrintf("%s\n", scrypt_detect_batch());
 
     // ********************************************************* Step 5: verify wallet database integrity
 #ifdef ENABLE_WALLET
@@ -1509,6 +1575,19 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     fReindex = gArgs.GetBoolArg("-reindex", false);
     bool fReindexChainState = gArgs.GetBoolArg("-reindex-chainstate", false);
 
+    if (gArgs.GetBoolArg("-persistethashcache", DEFAULT_PERSIST_ETHASH_CACHE)) {
+        fs::path ethashCacheDir = GetDataDir() / "blocks" / "ethash";
+        try {
+            fs::create_directories(ethashCacheDir);
+            ethash_set_light_cache_dir(ethashCacheDir.string().c_str());
+            LogPrintf("Using ethash light cache directory %s\n", ethashCacheDir.string());
+        } catch (const fs::filesystem_error& e) {
+            LogPrintf("Unable to create ethash light cache directory %s: %s\n", ethashCacheDir.string(), e.what());
+        }
+    }
+    StartEthashPrefetch(threadGroup);
+    StartCoinPrefetch(threadGroup);
+
     // block tree db settings
     size_t dbMaxFileSize = gArgs.GetArg("-dbmaxfilesize", DEFAULT_DB_MAX_FILE_SIZE) << 20;
 
@@ -1522,6 +1601,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int nIndexes = fAddressIndex + fAddressSummaryIndex + fSpentIndex + fTimestampIndex;
+    int64_t nIndexDBCache = 0;
+    if (nIndexes > 0) {
+        nIndexDBCache = std::min(nTotalCache / 8, (nMaxIndexDBCache << 20) * nIndexes) / nIndexes;
+        nTotalCache -= nIndexDBCache * nIndexes;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1529,6 +1614,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (nIndexes > 0)
+        LogPrintf("* Using %.1fMiB for each of %d index databases\n", nIndexDBCache * (1.0 / 1024 / 1024), nIndexes);
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1661,24 +1748,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                // Check for changed -addressindex state
-                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -addressindex");
-                    break;
-                }
-
-                // Check for changed -spentindex state
-                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -spentindex");
-                    break;
-                }
-
-                // Check for changed -timestampindex state
-                if (fTimestampIndex != gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -timestampindex");
-                    break;
-                }
-
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1716,6 +1785,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 // The on-disk coinsdb is now in a good state, create the cache
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                LoadUTXOStats();
 
                 bool is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -1804,6 +1874,26 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    // The indexes catch up with the chain in threads of their own, and start
+    // over if the chain is rebuilt.
+    bool fWipeIndexes = fReindex || fReindexChainState;
+    if (fAddressIndex)
+        g_addressindex.reset(new CAddressIndex(nIndexDBCache, false, fWipeIndexes));
+    if (fAddressSummaryIndex)
+        g_addresssummaryindex.reset(new CAddressSummaryIndex(nIndexDBCache, false, fWipeIndexes));
+    if (fSpentIndex)
+        g_spentindex.reset(new CSpentIndex(nIndexDBCache, false, fWipeIndexes));
+    if (fTimestampIndex)
+        g_timestampindex.reset(new CTimestampIndex(nIndexDBCache, false, fWipeIndexes));
+    for (CBaseIndex* index : {(CBaseIndex*)g_addressindex.get(), (CBaseIndex*)g_addresssummaryindex.get(),
+                              (CBaseIndex*)g_spentindex.get(), (CBaseIndex*)g_timestampindex.get()}) {
+        if (index && !index->Start())
+            return InitError(strprintf(_("Error loading the %s database"), index->GetName()));
+    }
+
+    if (gArgs.GetBoolArg("-incrementaltemplate", DEFAULT_INCREMENTAL_TEMPLATE))
+        g_templateassembler.reset(new IncrementalBlockAssembler(chainparams, gArgs.GetBoolArg("-checkblocktemplate", chainparams.DefaultConsistencyChecks())));
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -6,6 +6,7 @@
 #ifndef MEOWCOIN_MEMUSAGE_H
 #define MEOWCOIN_MEMUSAGE_H
 
+#include "flatmap.h"
 #include "indirectmap.h"
 
 #include <stdlib.h>
@@ -131,6 +132,14 @@ static inline size_t IncrementalDynamicUsage(const indirectmap<X, Y>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X*, Y> >));
 }
 
+// flatmap allocates its elements from a few large pool chunks
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const flatmap<X, Y, Z>& m)
+{
+    return MallocUsage(m.bucket_memory()) + MallocUsage(m.pool_memory());
+}
+
 template<typename X>
 static inline size_t DynamicUsage(const std::unique_ptr<X>& p)
 {
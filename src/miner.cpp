@@ -33,11 +33,19 @@
 //#include "wallet/rpcwallet.h"
 
 
+#include <crypto/ethash/include/ethash/progpow.hpp>
+#include <crypto/ethash/include/ethash/meowpow.hpp>
+
+#include <boost/bind/bind.hpp>
 #include <boost/thread.hpp>
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <queue>
 #include <utility>
 
+using namespace boost::placeholders;
+
 
 extern std::vector<CWalletRef> vpwallets;
 //////////////////////////////////////////////////////////////////////////////
@@ -53,9 +61,26 @@ extern std::vector<CWalletRef> vpwallets;
 
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockWeight = 0;
-uint64_t nMiningTimeStart = 0;
-uint64_t nHashesPerSec = 0;
-uint64_t nHashesDone = 0;
+
+/** Number of nonces a miner thread searches before it checks for a new tip. */
+static const uint64_t MINER_SEARCH_BATCH = 256;
+
+/** Counters of one built-in miner thread, shared with getmininginfo. */
+struct CMinerThreadCounters
+{
+    std::atomic<uint64_t> nHashesDone{0};
+    std::atomic<uint64_t> nHashesPerSec{0};
+    std::atomic<uint64_t> nStaleTemplates{0};
+    std::atomic<uint64_t> nStaleBlocks{0};
+};
+
+static CCriticalSection cs_minerstats;
+static std::vector<std::shared_ptr<CMinerThreadCounters>> vMinerCounters;
+
+/** Mempool changes an IncrementalBlockAssembler records before it gives up and rebuilds the next template. */
+static const unsigned int MAX_TEMPLATE_CHANGES = 100000;
+
+std::unique_ptr<IncrementalBlockAssembler> g_templateassembler;
 
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev, bool fIsAuxPow)
@@ -73,6 +98,24 @@ int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParam
     return nNewTime - nOldTime;
 }
 
+CAmount GetMinerSubsidy(int nHeight, const Consensus::Params& consensusParams)
+{
+    CAmount nSubsidy = GetBlockSubsidy(nHeight, consensusParams);
+    return (100 - GetParams().CommunityAutonomousAmount()) * nSubsidy / 100;
+}
+
+CAmount CreateEmptyBlockHeader(CBlockHeader& header, const CBlockIndex* pindexPrev, const CChainParams& chainparams)
+{
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+    header.SetNull();
+    header.nVersion.SetBaseVersion(ComputeBlockVersion(pindexPrev, consensusParams), consensusParams.nAuxpowChainId);
+    header.hashPrevBlock = pindexPrev->GetBlockHash();
+    header.nHeight = pindexPrev->nHeight + 1;
+    UpdateTime(&header, consensusParams, pindexPrev);
+    header.nBits = GetNextWorkRequired(pindexPrev, &header, consensusParams);
+    return GetMinerSubsidy(header.nHeight, consensusParams);
+}
+
 BlockAssembler::Options::Options() {
     blockMinFeeRate = CFeeRate(DEFAULT_BLOCK_MIN_TX_FEE);
     nBlockMaxWeight = GetMaxBlockWeight() - 4000;
@@ -117,6 +160,9 @@ void BlockAssembler::resetBlock()
     // These counters do not include coinbase tx
     nBlockTx = 0;
     nFees = 0;
+
+    fBlockFull = false;
+    lowestPackageFeeRate = CFeeRate();
 }
 
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTx, bool fIsAuxPow)
@@ -139,6 +185,51 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     LOCK2(cs_main, mempool.cs);
     CBlockIndex* pindexPrev = chainActive.Tip();
     assert(pindexPrev != nullptr);
+    InitBlock(pindexPrev, fMineWitnessTx);
+
+    int nPackagesSelected = 0;
+    addPackageTxs(nPackagesSelected);
+
+    int64_t nTime1 = GetTimeMicros();
+
+    FinishBlock(scriptPubKeyIn, pindexPrev, fIsAuxPow);
+
+    CValidationState state;
+    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false, fIsAuxPow)) {
+        if (state.IsTransactionError()) {
+            if (gArgs.GetBoolArg("-autofixmempool", false)) {
+                {
+                    TRY_LOCK(mempool.cs, fLockMempool);
+                    if (fLockMempool) {
+                        LogPrintf("%s failed because of a transaction %s. -autofixmempool is set to true. Clearing the mempool\n", __func__,
+                                  state.GetFailedTransaction().GetHex());
+                        mempool.clear();
+                    }
+                }
+            } else {
+                {
+                    TRY_LOCK(mempool.cs, fLockMempool);
+                    if (fLockMempool) {
+                        auto mempoolTx = mempool.get(state.GetFailedTransaction());
+                        if (mempoolTx) {
+                            LogPrintf("%s : Failed because of a transaction %s. Trying to remove the transaction from the mempool\n", __func__, state.GetFailedTransaction().GetHex());
+                            mempool.removeRecursive(*mempoolTx, MemPoolRemovalReason::CONFLICT);
+                        }
+                    }
+                }
+            }
+        }
+        throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
+    }
+    int64_t nTime2 = GetTimeMicros();
+
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d chunks), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+
+    return std::move(pblocktemplate);
+}
+
+void BlockAssembler::InitBlock(CBlockIndex* pindexPrev, bool fMineWitnessTx)
+{
     nHeight = pindexPrev->nHeight + 1;
 
     const int32_t nChainId = chainparams.GetConsensus().nAuxpowChainId;
@@ -161,13 +252,10 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     // TODO: replace this with a call to main to assess validity of a mempool
     // transaction (which in most cases can be a no-op).
     fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus()) && fMineWitnessTx;
+}
 
-    int nPackagesSelected = 0;
-    int nDescendantsUpdated = 0;
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
-
-    int64_t nTime1 = GetTimeMicros();
-
+void BlockAssembler::FinishBlock(const CScript& scriptPubKeyIn, CBlockIndex* pindexPrev, bool fIsAuxPow)
+{
     nLastBlockTx = nBlockTx;
     nLastBlockWeight = nBlockWeight;
 
@@ -182,7 +270,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     coinbaseTx.vout.resize(2);
     coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
-    coinbaseTx.vout[0].nValue = nFees + ( (100-nCommunityAutonomousAmount) * nSubsidy / 100 );
+    coinbaseTx.vout[0].nValue = nFees + GetMinerSubsidy(nHeight, chainparams.GetConsensus());
 
     // Assign the set % in chainparams.cpp to the TX
 	std::string  GetCommunityAutonomousAddress 	= GetParams().CommunityAutonomousAddress();
@@ -220,52 +308,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblock->nNonce64         = 0;
     pblock->nHeight          = nHeight;
     pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
-
-    CValidationState state;
-    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false, fIsAuxPow)) {
-        if (state.IsTransactionError()) {
-            if (gArgs.GetBoolArg("-autofixmempool", false)) {
-                {
-                    TRY_LOCK(mempool.cs, fLockMempool);
-                    if (fLockMempool) {
-                        LogPrintf("%s failed because of a transaction %s. -autofixmempool is set to true. Clearing the mempool\n", __func__,
-                                  state.GetFailedTransaction().GetHex());
-                        mempool.clear();
-                    }
-                }
-            } else {
-                {
-                    TRY_LOCK(mempool.cs, fLockMempool);
-                    if (fLockMempool) {
-                        auto mempoolTx = mempool.get(state.GetFailedTransaction());
-                        if (mempoolTx) {
-                            LogPrintf("%s : Failed because of a transaction %s. Trying to remove the transaction from the mempool\n", __func__, state.GetFailedTransaction().GetHex());
-                            mempool.removeRecursive(*mempoolTx, MemPoolRemovalReason::CONFLICT);
-                        }
-                    }
-                }
-            }
-        }
-        throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
-    }
-    int64_t nTime2 = GetTimeMicros();
-
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
-
-    return std::move(pblocktemplate);
-}
-
-void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
-{
-    for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
-        // Only test txs not already in the block
-        if (inBlock.count(*iit)) {
-            testSet.erase(iit++);
-        }
-        else {
-            iit++;
-        }
-    }
 }
 
 bool BlockAssembler::TestPackage(uint64_t packageSize, int64_t packageSigOpsCost) const
@@ -312,83 +354,24 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     }
 }
 
-int BlockAssembler::UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded,
-        indexed_modified_transaction_set &mapModifiedTx)
-{
-    int nDescendantsUpdated = 0;
-    for (const CTxMemPool::txiter it : alreadyAdded) {
-        CTxMemPool::setEntries descendants;
-        mempool.CalculateDescendants(it, descendants);
-        // Insert all descendants (not yet in block) into the modified set
-        for (CTxMemPool::txiter desc : descendants) {
-            if (alreadyAdded.count(desc))
-                continue;
-            ++nDescendantsUpdated;
-            modtxiter mit = mapModifiedTx.find(desc);
-            if (mit == mapModifiedTx.end()) {
-                CTxMemPoolModifiedEntry modEntry(desc);
-                modEntry.nSizeWithAncestors -= it->GetTxSize();
-                modEntry.nModFeesWithAncestors -= it->GetModifiedFee();
-                modEntry.nSigOpCostWithAncestors -= it->GetSigOpCost();
-                mapModifiedTx.insert(modEntry);
-            } else {
-                mapModifiedTx.modify(mit, update_for_parent_inclusion(it));
-            }
-        }
-    }
-    return nDescendantsUpdated;
-}
-
-// Skip entries in mapTx that are already in a block or are present
-// in mapModifiedTx (which implies that the mapTx ancestor state is
-// stale due to ancestor inclusion in the block)
-// Also skip transactions that we've already failed to add. This can happen if
-// we consider a transaction in mapModifiedTx and it fails: we can then
-// potentially consider it again while walking mapTx.  It's currently
-// guaranteed to fail again, but as a belt-and-suspenders check we put it in
-// failedTx and avoid re-evaluation, since the re-evaluation would be using
-// cached size/sigops/fee values that are not actually correct.
-bool BlockAssembler::SkipMapTxEntry(CTxMemPool::txiter it, indexed_modified_transaction_set &mapModifiedTx, CTxMemPool::setEntries &failedTx)
-{
-    assert (it != mempool.mapTx.end());
-    return mapModifiedTx.count(it) || inBlock.count(it) || failedTx.count(it);
-}
-
-void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemPool::txiter entry, std::vector<CTxMemPool::txiter>& sortedEntries)
+// This transaction selection algorithm walks the chunks of the mempool
+// clusters by decreasing feerate. The chunks of a cluster come in the order of
+// its linearization, so the transactions of a chunk only depend on those of
+// earlier chunks of the same cluster, or on the chain. Once a chunk of a
+// cluster is left out, the later chunks of that cluster are skipped too.
+void BlockAssembler::addPackageTxs(int &nPackagesSelected)
 {
-    // Sort package by ancestor count
-    // If a transaction A depends on transaction B, then A's ancestor count
-    // must be greater than B's.  So this is sufficient to validly order the
-    // transactions for block inclusion.
-    sortedEntries.clear();
-    sortedEntries.insert(sortedEntries.begin(), package.begin(), package.end());
-    std::sort(sortedEntries.begin(), sortedEntries.end(), CompareTxIterByAncestorCount());
+    const CTxMemPool::setChunkRefs& chunks = mempool.GetChunks();
+    addChunks(chunks.begin(), chunks.end(), nPackagesSelected);
 }
 
-// This transaction selection algorithm orders the mempool based
-// on feerate of a transaction including all unconfirmed ancestors.
-// Since we don't remove transactions from the mempool as we select them
-// for block inclusion, we need an alternate method of updating the feerate
-// of a transaction with its not-yet-selected ancestors as we go.
-// This is accomplished by walking the in-mempool descendants of selected
-// transactions and storing a temporary modified state in mapModifiedTxs.
-// Each time through the loop, we compare the best transaction in
-// mapModifiedTxs with the next transaction in the mempool to decide what
-// transaction package to work on next.
-void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated)
+template <typename ChunkIter>
+CFeeRate BlockAssembler::addChunks(ChunkIter begin, ChunkIter end, int &nPackagesSelected)
 {
-    // mapModifiedTx will store sorted packages after they are modified
-    // because some of their txs are already in the block
-    indexed_modified_transaction_set mapModifiedTx;
-    // Keep track of entries that failed inclusion, to avoid duplicate work
-    CTxMemPool::setEntries failedTx;
-
-    // Start by adding all descendants of previously added txs to mapModifiedTx
-    // and modifying them for their already included ancestors
-    UpdatePackagesForAdded(inBlock, mapModifiedTx);
-
-    CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = mempool.mapTx.get<ancestor_score>().begin();
-    CTxMemPool::txiter iter;
+    // The highest feerate of a chunk left out for lack of room
+    CFeeRate highestFailedFeeRate;
+    // Clusters with a chunk left out of the block
+    std::set<uint64_t> setFailedClusters;
 
     // Limit the number of attempts to add transactions to the block when it is
     // close to full; this is just a simple heuristic to finish quickly if the
@@ -396,67 +379,44 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
-    while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty())
-    {
-        // First try to find a new transaction in mapTx to evaluate.
-        if (mi != mempool.mapTx.get<ancestor_score>().end() &&
-                SkipMapTxEntry(mempool.mapTx.project<0>(mi), mapModifiedTx, failedTx)) {
-            ++mi;
-            continue;
-        }
-
-        // Now that mi is not stale, determine which transaction to evaluate:
-        // the next entry from mapTx, or the best from mapModifiedTx?
-        bool fUsingModified = false;
-
-        modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
-        if (mi == mempool.mapTx.get<ancestor_score>().end()) {
-            // We're out of entries in mapTx; use the entry from mapModifiedTx
-            iter = modit->iter;
-            fUsingModified = true;
-        } else {
-            // Try to compare the mapTx entry to the mapModifiedTx entry
-            iter = mempool.mapTx.project<0>(mi);
-            if (modit != mapModifiedTx.get<ancestor_score>().end() &&
-                    CompareModifiedEntry()(*modit, CTxMemPoolModifiedEntry(iter))) {
-                // The best entry in mapModifiedTx has higher score
-                // than the one from mapTx.
-                // Switch which transaction (package) to consider
-                iter = modit->iter;
-                fUsingModified = true;
-            } else {
-                // Either no entry in mapModifiedTx, or it's worse than mapTx.
-                // Increment mi for the next loop iteration.
-                ++mi;
-            }
+    for (ChunkIter chunkIt = begin; chunkIt != end; ++chunkIt) {
+        const CTxMemPool::ChunkRef& chunkRef = *chunkIt;
+        if (chunkRef.nModFees < blockMinFeeRate.GetFee(chunkRef.nSize)) {
+            // Everything else we might consider has a lower fee rate
+            break;
         }
 
-        // We skip mapTx entries that are inBlock, and mapModifiedTx shouldn't
-        // contain anything that is inBlock.
-        assert(!inBlock.count(iter));
-
-        uint64_t packageSize = iter->GetSizeWithAncestors();
-        CAmount packageFees = iter->GetModFeesWithAncestors();
-        int64_t packageSigOpsCost = iter->GetSigOpCostWithAncestors();
-        if (fUsingModified) {
-            packageSize = modit->nSizeWithAncestors;
-            packageFees = modit->nModFeesWithAncestors;
-            packageSigOpsCost = modit->nSigOpCostWithAncestors;
-        }
+        if (setFailedClusters.count(chunkRef.nClusterId))
+            continue;
 
-        if (packageFees < blockMinFeeRate.GetFee(packageSize)) {
-            // Everything else we might consider has a lower fee rate
-            return;
+        const CTxMemPool::Cluster* cluster = mempool.GetCluster(chunkRef.nClusterId);
+        assert(cluster);
+        const CTxMemPool::ClusterChunk& chunk = cluster->vChunks[chunkRef.nChunk];
+        size_t nBegin = chunkRef.nChunk == 0 ? 0 : cluster->vChunks[chunkRef.nChunk - 1].nEnd;
+
+        // Transactions may already be in the block (see IncrementalBlockAssembler::Update)
+        std::vector<CTxMemPool::txiter> vChunkTxs;
+        CTxMemPool::setEntries package;
+        uint64_t packageSize = 0;
+        int64_t packageSigOpsCost = 0;
+        for (size_t i = nBegin; i < chunk.nEnd; i++) {
+            CTxMemPool::txiter it = cluster->vTxs[i];
+            if (inBlock.count(it))
+                continue;
+            vChunkTxs.push_back(it);
+            package.insert(it);
+            packageSize += it->GetTxSize();
+            packageSigOpsCost += it->GetSigOpCost();
         }
+        if (vChunkTxs.empty())
+            continue;
 
+        CFeeRate packageFeeRate(chunkRef.nModFees, chunkRef.nSize);
         if (!TestPackage(packageSize, packageSigOpsCost)) {
-            if (fUsingModified) {
-                // Since we always look at the best entry in mapModifiedTx,
-                // we must erase failed entries so that we can consider the
-                // next best entry on the next loop iteration
-                mapModifiedTx.get<ancestor_score>().erase(modit);
-                failedTx.insert(iter);
-            }
+            fBlockFull = true;
+            setFailedClusters.insert(chunkRef.nClusterId);
+            if (packageFeeRate > highestFailedFeeRate)
+                highestFailedFeeRate = packageFeeRate;
 
             ++nConsecutiveFailed;
 
@@ -468,41 +428,215 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
             continue;
         }
 
-        CTxMemPool::setEntries ancestors;
-        uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
-        std::string dummy;
-        mempool.CalculateMemPoolAncestors(*iter, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
-
-        onlyUnconfirmed(ancestors);
-        ancestors.insert(iter);
-
         // Test if all tx's are Final
-        if (!TestPackageTransactions(ancestors)) {
-            if (fUsingModified) {
-                mapModifiedTx.get<ancestor_score>().erase(modit);
-                failedTx.insert(iter);
-            }
+        if (!TestPackageTransactions(package)) {
+            setFailedClusters.insert(chunkRef.nClusterId);
             continue;
         }
 
-        // This transaction will make it in; reset the failed counter.
+        // This chunk will make it in; reset the failed counter.
         nConsecutiveFailed = 0;
 
-        // Package can be added. Sort the entries in a valid order.
-        std::vector<CTxMemPool::txiter> sortedEntries;
-        SortForBlock(ancestors, iter, sortedEntries);
+        if (nBlockTx == 0 || packageFeeRate < lowestPackageFeeRate)
+            lowestPackageFeeRate = packageFeeRate;
 
-        for (size_t i=0; i<sortedEntries.size(); ++i) {
-            AddToBlock(sortedEntries[i]);
-            // Erase from the modified set, if present
-            mapModifiedTx.erase(sortedEntries[i]);
+        // The linearization already orders the chunk validly
+        for (CTxMemPool::txiter it : vChunkTxs) {
+            AddToBlock(it);
         }
 
         ++nPackagesSelected;
+    }
+    return highestFailedFeeRate;
+}
+
+IncrementalBlockAssembler::IncrementalBlockAssembler(const CChainParams& params, bool fCheckIn) :
+    assembler(params), fCheck(fCheckIn), nChanges(0), pindexPrev(nullptr), fMineWitnessTx(true), nTransactionsUpdated(0)
+{
+    mempool.NotifyEntryAdded.connect(boost::bind(&IncrementalBlockAssembler::TransactionAdded, this, _1));
+    mempool.NotifyEntryRemoved.connect(boost::bind(&IncrementalBlockAssembler::TransactionRemoved, this, _1, _2));
+}
+
+IncrementalBlockAssembler::~IncrementalBlockAssembler()
+{
+    mempool.NotifyEntryAdded.disconnect(boost::bind(&IncrementalBlockAssembler::TransactionAdded, this, _1));
+    mempool.NotifyEntryRemoved.disconnect(boost::bind(&IncrementalBlockAssembler::TransactionRemoved, this, _1, _2));
+}
+
+void IncrementalBlockAssembler::TransactionAdded(CTransactionRef tx)
+{
+    LOCK(cs_changes);
+    // Past the limit only count changes, the next template is rebuilt anyway
+    if (++nChanges <= MAX_TEMPLATE_CHANGES)
+        vAdded.push_back(tx->GetHash());
+}
+
+void IncrementalBlockAssembler::TransactionRemoved(CTransactionRef tx, MemPoolRemovalReason reason)
+{
+    LOCK(cs_changes);
+    if (++nChanges <= MAX_TEMPLATE_CHANGES)
+        setRemoved.insert(tx->GetHash());
+}
+
+std::unique_ptr<CBlockTemplate> IncrementalBlockAssembler::Rebuild(const CScript& scriptPubKeyIn, bool fIsAuxPow)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+
+    // Start over if CreateNewBlock throws
+    pindexPrev = nullptr;
+    std::unique_ptr<CBlockTemplate> pblocktemplate = assembler.CreateNewBlock(scriptPubKeyIn, fMineWitnessTx, fIsAuxPow);
+
+    const CBlock& block = pblocktemplate->block;
+    vSelected.clear();
+    for (size_t i = 1; i < block.vtx.size(); i++)
+        vSelected.push_back(block.vtx[i]->GetHash());
+    pindexPrev = chainActive.Tip();
+
+    LOCK(cs_changes);
+    vAdded.clear();
+    setRemoved.clear();
+    nChanges = 0;
+    nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    return pblocktemplate;
+}
+
+std::unique_ptr<CBlockTemplate> IncrementalBlockAssembler::Update(const CScript& scriptPubKeyIn, bool fIsAuxPow)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(mempool.cs);
+
+    std::vector<uint256> vAddedNow;
+    std::set<uint256> setDropped;
+    {
+        LOCK(cs_changes);
+        // Any other change of the mempool (prioritisetransaction, clearing) is not tracked here
+        if (nChanges > MAX_TEMPLATE_CHANGES || mempool.GetTransactionsUpdated() != nTransactionsUpdated + nChanges)
+            return nullptr;
+        vAddedNow.swap(vAdded);
+        setDropped.swap(setRemoved);
+        nTransactionsUpdated += nChanges;
+        nChanges = 0;
+    }
+
+    BlockAssembler& a = assembler;
+    bool fWasFull = a.fBlockFull;
+    CFeeRate lowestPackageFeeRate = a.lowestPackageFeeRate;
+
+    a.resetBlock();
+    a.fBlockFull = fWasFull;
+    a.lowestPackageFeeRate = lowestPackageFeeRate;
+    a.pblocktemplate.reset(new CBlockTemplate());
+    a.pblock = &a.pblocktemplate->block;
+
+    // Add dummy coinbase tx as first transaction
+    a.pblock->vtx.emplace_back();
+    a.pblocktemplate->vTxFees.push_back(-1); // updated at end
+    a.pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
+
+    CBlockIndex* pindexTip = chainActive.Tip();
+    a.InitBlock(pindexTip, fMineWitnessTx);
+
+    // Take over the transactions of the last template that are still in the
+    // mempool, and whose inputs are not created by dropped transactions
+    std::vector<uint256> vKept;
+    vKept.reserve(vSelected.size());
+    for (const uint256& hash : vSelected) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        bool fDrop = setDropped.count(hash) || it == mempool.mapTx.end();
+        if (!fDrop && !setDropped.empty()) {
+            for (const CTxIn& txin : it->GetTx().vin) {
+                if (setDropped.count(txin.prevout.hash)) {
+                    fDrop = true;
+                    break;
+                }
+            }
+        }
+        if (fDrop) {
+            // A full rebuild could fill the room with packages left out before
+            if (fWasFull)
+                return nullptr;
+            setDropped.insert(hash);
+            continue;
+        }
+        a.AddToBlock(it);
+        vKept.push_back(hash);
+    }
+    vSelected.swap(vKept);
+
+    // Add the chunks of the clusters the new transactions joined, by
+    // decreasing feerate, like addPackageTxs walks those of the whole mempool
+    std::set<uint64_t> setClusters;
+    for (const uint256& hash : vAddedNow) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it != mempool.mapTx.end() && !a.inBlock.count(it))
+            setClusters.insert(it->nClusterId);
+    }
+    std::vector<CTxMemPool::ChunkRef> vChunks;
+    for (uint64_t nClusterId : setClusters) {
+        const CTxMemPool::Cluster* cluster = mempool.GetCluster(nClusterId);
+        if (!cluster)
+            continue;
+        for (size_t i = 0; i < cluster->vChunks.size(); i++)
+            vChunks.push_back(CTxMemPool::ChunkRef{nClusterId, i, cluster->vChunks[i].nModFees, cluster->vChunks[i].nSize});
+    }
+    std::sort(vChunks.begin(), vChunks.end(), CTxMemPool::CompareChunkByFeeRate());
+
+    int nPackagesSelected = 0;
+    // A full rebuild would take a chunk left out here before cheaper ones in the block
+    if (a.addChunks(vChunks.begin(), vChunks.end(), nPackagesSelected) > a.lowestPackageFeeRate)
+        return nullptr;
+    for (size_t i = 1 + vSelected.size(); i < a.pblock->vtx.size(); i++)
+        vSelected.push_back(a.pblock->vtx[i]->GetHash());
+
+    a.FinishBlock(scriptPubKeyIn, pindexTip, fIsAuxPow);
+    return std::move(a.pblocktemplate);
+}
 
-        // Update transactions that depend on each of these
-        nDescendantsUpdated += UpdatePackagesForAdded(ancestors, mapModifiedTx);
+static std::vector<uint256> GetTemplateTxids(const CBlockTemplate& blocktemplate)
+{
+    std::vector<uint256> vTxids;
+    for (size_t i = 1; i < blocktemplate.block.vtx.size(); i++)
+        vTxids.push_back(blocktemplate.block.vtx[i]->GetHash());
+    std::sort(vTxids.begin(), vTxids.end());
+    return vTxids;
+}
+
+std::unique_ptr<CBlockTemplate> IncrementalBlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTxIn, bool fIsAuxPow)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    LOCK2(cs_main, mempool.cs);
+    CBlockIndex* pindexTip = chainActive.Tip();
+    assert(pindexTip != nullptr);
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    if (pindexPrev == pindexTip && fMineWitnessTx == fMineWitnessTxIn)
+        pblocktemplate = Update(scriptPubKeyIn, fIsAuxPow);
+    if (!pblocktemplate) {
+        fMineWitnessTx = fMineWitnessTxIn;
+        return Rebuild(scriptPubKeyIn, fIsAuxPow);
     }
+
+    int64_t nTime1 = GetTimeMicros();
+    LogPrint(BCLog::BENCH, "IncrementalBlockAssembler: updated template: %.2fms (%u txs)\n", 0.001 * (nTime1 - nTimeStart), pblocktemplate->block.vtx.size() - 1);
+
+    if (fCheck) {
+        CValidationState state;
+        if (!TestBlockValidity(state, assembler.chainparams, pblocktemplate->block, pindexTip, false, false, fIsAuxPow)) {
+            LogPrintf("IncrementalBlockAssembler: updated template is invalid: %s, rebuilding\n", FormatStateMessage(state));
+            return Rebuild(scriptPubKeyIn, fIsAuxPow);
+        }
+        std::unique_ptr<CBlockTemplate> pfulltemplate = Rebuild(scriptPubKeyIn, fIsAuxPow);
+        if (GetTemplateTxids(*pfulltemplate) != GetTemplateTxids(*pblocktemplate)) {
+            LogPrintf("IncrementalBlockAssembler: updated template differs from a full rebuild (%u txs, fees %s vs %u txs, fees %s)\n",
+                      pblocktemplate->block.vtx.size() - 1, FormatMoney(-pblocktemplate->vTxFees[0]),
+                      pfulltemplate->block.vtx.size() - 1, FormatMoney(-pfulltemplate->vTxFees[0]));
+            return pfulltemplate;
+        }
+    }
+
+    return pblocktemplate;
 }
 
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
@@ -563,13 +697,53 @@ CWallet *GetFirstWallet() {
     return(NULL);
 }
 
-void static MeowcoinMiner(const CChainParams& chainparams)
+/**
+ * Searches the nonces [nStart, nStart + nCount) of the block, and returns the
+ * number of nonces tried. On success fFound is set, as is the nonce (and for
+ * KAWPOW/MEOWPOW the mix hash) of the block.
+ * KAWPOW and MEOWPOW blocks are searched on the shared full dataset of their
+ * epoch, which all miner threads fill in lazily.
+ */
+static uint64_t SearchBlockNonces(CBlock* pblock, const arith_uint256& hashTarget, uint64_t nStart, uint64_t nCount, bool& fFound)
+{
+    fFound = false;
+    if (pblock->nTime < nKAWPOWActivationTime) {
+        for (uint64_t i = 0; i < nCount; i++) {
+            pblock->nNonce = (uint32_t)(nStart + i);
+            if (UintToArith256(pblock->GetHash()) <= hashTarget) {
+                fFound = true;
+                return i + 1;
+            }
+        }
+        return nCount;
+    }
+
+    const ethash::epoch_context_full& context =
+        ethash::get_global_epoch_context_full(ethash::get_epoch_number(pblock->nHeight));
+    const ethash::hash256 boundary = ToHash256(ArithToUint256(hashTarget));
+
+    ethash::search_result result;
+    if (pblock->nTime < nMEOWPOWActivationTime)
+        result = progpow::search(context, pblock->nHeight, ToHash256(pblock->GetKAWPOWHeaderHash()), boundary, nStart, nCount);
+    else
+        result = meowpow::search(context, pblock->nHeight, ToHash256(pblock->GetMEOWPOWHeaderHash()), boundary, nStart, nCount);
+    if (!result.solution_found)
+        return nCount;
+
+    fFound = true;
+    pblock->nNonce64 = result.nonce;
+    pblock->mix_hash = FromHash256(result.mix_hash);
+    return result.nonce - nStart + 1;
+}
+
+void static MeowcoinMiner(const CChainParams& chainparams, int nThread, int nThreads, std::shared_ptr<CMinerThreadCounters> counters)
 {
     LogPrintf("MeowcoinMiner -- started\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("meowcoin-miner");
 
     unsigned int nExtraNonce = 0;
+    int64_t nMinerStartMicros = GetTimeMicros();
 
 
     CWallet * pWallet = NULL;
@@ -645,7 +819,10 @@ void static MeowcoinMiner(const CChainParams& chainparams)
                 return;
             }
             CBlock *pblock = &pblocktemplate->block;
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+            {
+                LOCK(cs_main);
+                IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+            }
 
             LogPrintf("MeowcoinMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
                 ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
@@ -655,51 +832,59 @@ void static MeowcoinMiner(const CChainParams& chainparams)
             //
             int64_t nStart = GetTime();
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+            // Threads may build identical templates, so each searches its own
+            // stride of the nonce space: batch k of thread t starts at
+            // (k * nThreads + t) * MINER_SEARCH_BATCH.
+            uint64_t nBatch = 0;
             while (true)
             {
+                const uint64_t nNonceStart = (nBatch * nThreads + nThread) * MINER_SEARCH_BATCH;
+                nBatch++;
+                bool fFound;
+                uint64_t nTried = SearchBlockNonces(pblock, hashTarget, nNonceStart, MINER_SEARCH_BATCH, fFound);
+
+                uint64_t nHashesDone = (counters->nHashesDone += nTried);
+                int64_t nElapsed = GetTimeMicros() - nMinerStartMicros;
+                if (nElapsed > 0)
+                    counters->nHashesPerSec = nHashesDone * 1000000 / nElapsed;
 
-                uint256 hash;
-                uint256 mix_hash;
-                while (true)
+                if (fFound)
                 {
-                    hash = pblock->GetHashFull(mix_hash);
-                    if (UintToArith256(hash) <= hashTarget)
+                    // Found a solution
+                    SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                    LogPrintf("MeowcoinMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", pblock->GetHash().GetHex(), hashTarget.GetHex());
+                    bool fStale;
                     {
-                        pblock->mix_hash = mix_hash;
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("MeowcoinMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
-
-                        break;
-                    }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if (nHashesDone % 500000 == 0) {   //Calculate hashing speed
-                        nHashesPerSec = nHashesDone / (((GetTimeMicros() - nMiningTimeStart) / 1000000) + 1);
+                        LOCK(cs_main);
+                        fStale = pblock->hashPrevBlock != chainActive.Tip()->GetBlockHash();
                     }
-                    if ((pblock->nNonce & 0xFF) == 0)
-                        break;
+                    if (fStale)
+                        counters->nStaleBlocks++;
+                    ProcessBlockFound(pblock, chainparams);
+                    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                    coinbaseScript->KeepScript();
+
+                    // In regression test mode, stop mining after a block is found. This
+                    // allows developers to controllably generate a block on demand.
+                    if (chainparams.MineBlocksOnDemand())
+                        throw boost::thread_interrupted();
+
+                    break;
                 }
 
                 // Check for stop or if block needs to be rebuilt
                 boost::this_thread::interruption_point();
-                // Regtest mode doesn't require peers
-                //if (vNodes.empty() && chainparams.MiningRequiresPeers())
-                //    break;
-                if (pblock->nNonce >= 0xffff0000)
+                if (pblock->nTime < nKAWPOWActivationTime && nNonceStart + (uint64_t)nThreads * MINER_SEARCH_BATCH >= 0xffff0000)
                     break;
                 if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
                     break;
-                if (pindexPrev != chainActive.Tip())
-                    break;
+                {
+                    LOCK(cs_main);
+                    if (pindexPrev != chainActive.Tip()) {
+                        counters->nStaleTemplates++;
+                        break;
+                    }
+                }
 
                 // Update nTime every few seconds
                 if (UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev) < 0)
@@ -740,20 +925,37 @@ int GenerateMeowcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
         delete minerThreads;
         minerThreads = NULL;
     }
+    {
+        LOCK(cs_minerstats);
+        vMinerCounters.clear();
+    }
 
     if (nThreads == 0 || !fGenerate)
         return numCores;
 
     minerThreads = new boost::thread_group();
 
-    //Reset metrics
-    nMiningTimeStart = GetTimeMicros();
-    nHashesDone = 0;
-    nHashesPerSec = 0;
-
+    LOCK(cs_minerstats);
     for (int i = 0; i < nThreads; i++){
-        minerThreads->create_thread(boost::bind(&MeowcoinMiner, boost::cref(chainparams)));
+        vMinerCounters.push_back(std::make_shared<CMinerThreadCounters>());
+        minerThreads->create_thread(boost::bind(&MeowcoinMiner, boost::cref(chainparams), i, nThreads, vMinerCounters.back()));
     }
 
     return(numCores);
 }
+
+std::vector<CMinerThreadStats> GetMinerThreadStats()
+{
+    LOCK(cs_minerstats);
+    std::vector<CMinerThreadStats> vStats;
+    for (size_t i = 0; i < vMinerCounters.size(); i++) {
+        CMinerThreadStats stats;
+        stats.nThread = i;
+        stats.nHashesDone = vMinerCounters[i]->nHashesDone;
+        stats.nHashesPerSec = vMinerCounters[i]->nHashesPerSec;
+        stats.nStaleTemplates = vMinerCounters[i]->nStaleTemplates;
+        stats.nStaleBlocks = vMinerCounters[i]->nStaleBlocks;
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
@@ -8,12 +8,13 @@
 #define MEOWCOIN_MINER_H
 
 #include "primitives/block.h"
+#include "sync.h"
 #include "txmempool.h"
 
 #include <stdint.h>
 #include <memory>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
+#include <set>
+#include <vector>
 
 class CBlockIndex;
 class CChainParams;
@@ -22,6 +23,7 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+static const bool DEFAULT_INCREMENTAL_TEMPLATE = true;
 
 struct CBlockTemplate
 {
@@ -31,58 +33,6 @@ struct CBlockTemplate
     std::vector<unsigned char> vchCoinbaseCommitment;
 };
 
-// Container for tracking updates to ancestor feerate as we include (parent)
-// transactions in a block
-struct CTxMemPoolModifiedEntry {
-    explicit CTxMemPoolModifiedEntry(CTxMemPool::txiter entry)
-    {
-        iter = entry;
-        nSizeWithAncestors = entry->GetSizeWithAncestors();
-        nModFeesWithAncestors = entry->GetModFeesWithAncestors();
-        nSigOpCostWithAncestors = entry->GetSigOpCostWithAncestors();
-    }
-
-    CTxMemPool::txiter iter;
-    uint64_t nSizeWithAncestors;
-    CAmount nModFeesWithAncestors;
-    int64_t nSigOpCostWithAncestors;
-};
-
-/** Comparator for CTxMemPool::txiter objects.
- *  It simply compares the internal memory address of the CTxMemPoolEntry object
- *  pointed to. This means it has no meaning, and is only useful for using them
- *  as key in other indexes.
- */
-struct CompareCTxMemPoolIter {
-    bool operator()(const CTxMemPool::txiter& a, const CTxMemPool::txiter& b) const
-    {
-        return &(*a) < &(*b);
-    }
-};
-
-struct modifiedentry_iter {
-    typedef CTxMemPool::txiter result_type;
-    result_type operator() (const CTxMemPoolModifiedEntry &entry) const
-    {
-        return entry.iter;
-    }
-};
-
-// This matches the calculation in CompareTxMemPoolEntryByAncestorFee,
-// except operating on CTxMemPoolModifiedEntry.
-// TODO: refactor to avoid duplication of this logic.
-struct CompareModifiedEntry {
-    bool operator()(const CTxMemPoolModifiedEntry &a, const CTxMemPoolModifiedEntry &b) const
-    {
-        double f1 = (double)a.nModFeesWithAncestors * b.nSizeWithAncestors;
-        double f2 = (double)b.nModFeesWithAncestors * a.nSizeWithAncestors;
-        if (f1 == f2) {
-            return CTxMemPool::CompareIteratorByHash()(a.iter, b.iter);
-        }
-        return f1 > f2;
-    }
-};
-
 // A comparator that sorts transactions based on number of ancestors.
 // This is sufficient to sort an ancestor package in an order that is valid
 // to appear in a block.
@@ -95,43 +45,11 @@ struct CompareTxIterByAncestorCount {
     }
 };
 
-typedef boost::multi_index_container<
-    CTxMemPoolModifiedEntry,
-    boost::multi_index::indexed_by<
-        boost::multi_index::ordered_unique<
-            modifiedentry_iter,
-            CompareCTxMemPoolIter
-        >,
-        // sorted by modified ancestor fee rate
-        boost::multi_index::ordered_non_unique<
-            // Reuse same tag from CTxMemPool's similar index
-            boost::multi_index::tag<ancestor_score>,
-            boost::multi_index::identity<CTxMemPoolModifiedEntry>,
-            CompareModifiedEntry
-        >
-    >
-> indexed_modified_transaction_set;
-
-typedef indexed_modified_transaction_set::nth_index<0>::type::iterator modtxiter;
-typedef indexed_modified_transaction_set::index<ancestor_score>::type::iterator modtxscoreiter;
-
-struct update_for_parent_inclusion
-{
-    explicit update_for_parent_inclusion(CTxMemPool::txiter it) : iter(it) {}
-
-    void operator() (CTxMemPoolModifiedEntry &e)
-    {
-        e.nModFeesWithAncestors -= iter->GetFee();
-        e.nSizeWithAncestors -= iter->GetTxSize();
-        e.nSigOpCostWithAncestors -= iter->GetSigOpCost();
-    }
-
-    CTxMemPool::txiter iter;
-};
-
 /** Generate a new block, without valid proof-of-work */
 class BlockAssembler
 {
+    friend class IncrementalBlockAssembler;
+
 private:
     // The constructed block template
     std::unique_ptr<CBlockTemplate> pblocktemplate;
@@ -149,6 +67,10 @@ private:
     uint64_t nBlockSigOpsCost;
     CAmount nFees;
     CTxMemPool::setEntries inBlock;
+    // Whether a package was left out for lack of room
+    bool fBlockFull;
+    // The lowest feerate of the packages added to the block
+    CFeeRate lowestPackageFeeRate;
 
     // Chain context for the block
     int nHeight;
@@ -174,16 +96,24 @@ private:
     void resetBlock();
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
+    /** Set up the header and chain context of a block on top of pindexPrev */
+    void InitBlock(CBlockIndex* pindexPrev, bool fMineWitnessTx);
+    /** Create the coinbase and fill in the rest of the header */
+    void FinishBlock(const CScript& scriptPubKeyIn, CBlockIndex* pindexPrev, bool fIsAuxPow);
 
     // Methods for how to add transactions to a block.
-    /** Add transactions based on feerate including unconfirmed ancestors
-      * Increments nPackagesSelected / nDescendantsUpdated with corresponding
-      * statistics from the package selection (for logging statistics). */
-    void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated);
-
-    // helper functions for addPackageTxs()
-    /** Remove confirmed (inBlock) entries from given set */
-    void onlyUnconfirmed(CTxMemPool::setEntries& testSet);
+    /** Add the chunks of the mempool clusters by decreasing feerate
+      * Increments nPackagesSelected with the number of chunks selected
+      * (for logging statistics). */
+    void addPackageTxs(int &nPackagesSelected);
+
+    /** Add the chunks [begin, end), which come by decreasing feerate, leaving
+      * out their transactions already in the block. Returns the highest
+      * feerate of a chunk left out for lack of room. */
+    template <typename ChunkIter>
+    CFeeRate addChunks(ChunkIter begin, ChunkIter end, int &nPackagesSelected);
+
+    // helper functions for addChunks()
     /** Test if a new package would "fit" in the block */
     bool TestPackage(uint64_t packageSize, int64_t packageSigOpsCost) const;
     /** Perform checks on each transaction in a package:
@@ -191,21 +121,82 @@ private:
       * These checks should always succeed, and they're here
       * only as an extra check in case of suboptimal node configuration */
     bool TestPackageTransactions(const CTxMemPool::setEntries& package);
-    /** Return true if given transaction from mapTx has already been evaluated,
-      * or if the transaction's cached data in mapTx is incorrect. */
-    bool SkipMapTxEntry(CTxMemPool::txiter it, indexed_modified_transaction_set &mapModifiedTx, CTxMemPool::setEntries &failedTx);
-    /** Sort the package in an order that is valid to appear in a block */
-    void SortForBlock(const CTxMemPool::setEntries& package, CTxMemPool::txiter entry, std::vector<CTxMemPool::txiter>& sortedEntries);
-    /** Add descendants of given transactions to mapModifiedTx with ancestor
-      * state updated assuming given transactions are inBlock. Returns number
-      * of updated descendants. */
-    int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/**
+ * Keeps the transactions of the last block template and updates them with the
+ * changes of the mempool since, instead of selecting all chunks again for every
+ * template. The chunks of the clusters that transactions entering the mempool
+ * joined are added by feerate while they fit, as addPackageTxs would, and
+ * removed transactions are dropped along with their selected descendants.
+ *
+ * A template is assembled from scratch with BlockAssembler when the tip
+ * changed, on mempool changes that are not single additions or removals
+ * (prioritisetransaction, clearing), when a removal left room in a full block,
+ * or when a new chunk does not fit but pays more than the cheapest chunk
+ * already selected. With fCheck, each incremental template is also checked
+ * with TestBlockValidity and compared to a full rebuild.
+ */
+class IncrementalBlockAssembler
+{
+private:
+    BlockAssembler assembler;
+    bool fCheck;
+
+    // Mempool changes since the last template
+    CCriticalSection cs_changes;
+    std::vector<uint256> vAdded;
+    std::set<uint256> setRemoved;
+    unsigned int nChanges;
+
+    // State of the last template, guarded by mempool.cs
+    const CBlockIndex* pindexPrev;
+    bool fMineWitnessTx;
+    unsigned int nTransactionsUpdated;
+    std::vector<uint256> vSelected;
+
+    void TransactionAdded(CTransactionRef tx);
+    void TransactionRemoved(CTransactionRef tx, MemPoolRemovalReason reason);
+
+    /** Assemble a template from scratch and take over its transactions */
+    std::unique_ptr<CBlockTemplate> Rebuild(const CScript& scriptPubKeyIn, bool fIsAuxPow);
+    /** Assemble a template from the last one and the changes since, returns nullptr if a rebuild is needed */
+    std::unique_ptr<CBlockTemplate> Update(const CScript& scriptPubKeyIn, bool fIsAuxPow);
+
+public:
+    IncrementalBlockAssembler(const CChainParams& params, bool fCheckIn);
+    ~IncrementalBlockAssembler();
+
+    /** Construct a new block template with coinbase to scriptPubKeyIn */
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTx=true, bool fIsAuxPow=true);
+};
+
+/** Template assembler of getblocktemplate, if -incrementaltemplate is set */
+extern std::unique_ptr<IncrementalBlockAssembler> g_templateassembler;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev, bool fIsAuxPow = false);
+/** The part of the block subsidy at nHeight that goes to the miner */
+CAmount GetMinerSubsidy(int nHeight, const Consensus::Params& consensusParams);
+/** Set up the header of an empty block on top of pindexPrev. Returns the coinbase value of the miner. */
+CAmount CreateEmptyBlockHeader(CBlockHeader& header, const CBlockIndex* pindexPrev, const CChainParams& chainparams);
 bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainParams);
 
 int GenerateMeowcoins(bool fGenerate, int nThreads, const CChainParams& chainparams);
+
+/** Hash rate and stale work of a built-in miner thread */
+struct CMinerThreadStats
+{
+    int nThread;
+    uint64_t nHashesDone;
+    uint64_t nHashesPerSec;
+    //! Templates abandoned because the chain tip changed while searching them
+    uint64_t nStaleTemplates;
+    //! Blocks found after the chain tip had already moved on
+    uint64_t nStaleBlocks;
+};
+
+/** Returns the statistics of the threads started by the last GenerateMeowcoins() call */
+std::vector<CMinerThreadStats> GetMinerThreadStats();
 #endif // MEOWCOIN_MINER_H
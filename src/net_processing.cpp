@@ -10,6 +10,7 @@
 #include "arith_uint256.h"
 #include "blockencodings.h"
 #include "chainparams.h"
+#include "consensus/tx_verify.h"
 #include "consensus/validation.h"
 #include "hash.h"
 #include "init.h"
@@ -926,6 +927,216 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
 //
 
 
+/**
+ * Relayed transactions whose signatures are checked on worker threads before
+ * they are handed to AcceptToMemoryPool. The workers run every input script
+ * with the standard flags and fill the signature cache, so that the
+ * CheckInputs call in AcceptToMemoryPool, which still runs under cs_main,
+ * finds the signatures already verified. The outcome of a job is not used:
+ * AcceptToMemoryPool stays the only judge of the transaction.
+ *
+ * Jobs are handed back to the message handler in the order they arrived, so
+ * that a transaction is never processed before a parent sent earlier. Only
+ * transactions that pass the cheap checks of AcceptToMemoryPool and spend
+ * known outputs are queued, and each peer has at most
+ * MAX_TX_PREVERIFY_PER_PEER jobs in the queue.
+ */
+class CTxPreVerifyQueue
+{
+public:
+    struct Job {
+        CTransactionRef tx;
+        NodeId nodeid;
+        //! The outputs spent by tx
+        std::vector<CTxOut> vSpent;
+        bool fDone;
+    };
+    typedef std::shared_ptr<Job> JobRef;
+
+private:
+    mutable CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    //! All jobs, in arrival order
+    std::deque<JobRef> vJobs;
+    //! Jobs not yet claimed by a worker
+    std::deque<JobRef> vPending;
+    std::map<uint256, JobRef> mapJobs;
+    //! Number of jobs per peer
+    std::map<NodeId, int> mapNodeJobs;
+    //! Number of running workers. Jobs are only queued if there is one.
+    int nThreads;
+
+public:
+    CTxPreVerifyQueue() : nThreads(0) {}
+
+    bool IsEnabled() const {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return nThreads > 0;
+    }
+
+    //! Queue a job, unless the queue or the share of the peer in it is full.
+    bool Add(const JobRef& job) {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (nThreads == 0 || vJobs.size() >= MAX_TX_PREVERIFY_QUEUE || mapJobs.count(job->tx->GetHash()))
+            return false;
+        auto it = mapNodeJobs.find(job->nodeid);
+        if (it != mapNodeJobs.end() && it->second >= (int)MAX_TX_PREVERIFY_PER_PEER)
+            return false;
+        vJobs.push_back(job);
+        vPending.push_back(job);
+        mapJobs.emplace(job->tx->GetHash(), job);
+        mapNodeJobs[job->nodeid]++;
+        cond.notify_one();
+        return true;
+    }
+
+    bool Contains(const uint256& hash) const {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return mapJobs.count(hash);
+    }
+
+    bool HasJobsFrom(NodeId nodeid) const {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return mapNodeJobs.count(nodeid);
+    }
+
+    CTransactionRef GetTx(const uint256& hash) const {
+        boost::unique_lock<boost::mutex> lock(cs);
+        auto it = mapJobs.find(hash);
+        return it == mapJobs.end() ? nullptr : it->second->tx;
+    }
+
+    //! Take the verified jobs from the front of the queue.
+    void TakeVerified(std::vector<JobRef>& vJobsOut) {
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (!vJobs.empty() && vJobs.front()->fDone) {
+            mapJobs.erase(vJobs.front()->tx->GetHash());
+            auto it = mapNodeJobs.find(vJobs.front()->nodeid);
+            if (--it->second == 0)
+                mapNodeJobs.erase(it);
+            vJobsOut.push_back(std::move(vJobs.front()));
+            vJobs.pop_front();
+        }
+    }
+
+    void Thread() {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nThreads++;
+        }
+        try {
+            while (true) {
+                JobRef job;
+                {
+                    boost::unique_lock<boost::mutex> lock(cs);
+                    while (vPending.empty())
+                        cond.wait(lock);
+                    job = std::move(vPending.front());
+                    vPending.pop_front();
+                }
+                Verify(*job);
+                bool fWake;
+                {
+                    boost::unique_lock<boost::mutex> lock(cs);
+                    job->fDone = true;
+                    fWake = vJobs.front() == job;
+                }
+                if (fWake && g_connman)
+                    g_connman->WakeMessageHandler();
+            }
+        } catch (...) {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nThreads--;
+            // Without workers the remaining jobs would never be done
+            if (nThreads == 0) {
+                for (const JobRef& job : vPending)
+                    job->fDone = true;
+                vPending.clear();
+            }
+            throw;
+        }
+    }
+
+private:
+    static void Verify(Job& job) {
+        const CTransaction& tx = *job.tx;
+        PrecomputedTransactionData txdata(tx);
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            CScriptCheck check(job.vSpent[i], tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, true /* cacheStore */, &txdata);
+            if (!check())
+                return;
+        }
+    }
+};
+
+static CTxPreVerifyQueue txpreverifyqueue;
+
+void ThreadTxPreVerify()
+{
+    RenameThread("meowcoin-txverify");
+    txpreverifyqueue.Thread();
+}
+
+/**
+ * Queue tx for signature pre-verification, with the outputs it spends.
+ * Returns false if it is to be processed right away, which is also the case
+ * when AcceptToMemoryPool would reject it before checking any script: it is
+ * invalid or non-standard, not final, an orphan, spends an output that is
+ * already spent, or does not pay the minimum fee.
+ */
+static bool QueueTxPreVerify(const CTransactionRef& ptx, NodeId nodeid) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CTransaction& tx = *ptx;
+    if (!txpreverifyqueue.IsEnabled() || tx.IsCoinBase())
+        return false;
+
+    CValidationState state;
+    if (!CheckTransaction(tx, state, true /* fCheckDuplicateInputs */, true /* fMempoolCheck */))
+        return false;
+    std::string reason;
+    if (fRequireStandard && !IsStandardTx(tx, reason, IsWitnessEnabled(chainActive.Tip(), GetParams().GetConsensus())))
+        return false;
+    if (!CheckFinalTx(tx, STANDARD_LOCKTIME_VERIFY_FLAGS))
+        return false;
+
+    auto job = std::make_shared<CTxPreVerifyQueue::Job>();
+    job->tx = ptx;
+    job->nodeid = nodeid;
+    job->fDone = false;
+    job->vSpent.resize(tx.vin.size());
+    CAmount nValueIn = 0;
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        const COutPoint& prevout = tx.vin[i].prevout;
+        if (mempool.isSpent(prevout))
+            return false;
+        CTransactionRef parent = mempool.get(prevout.hash);
+        if (!parent)
+            parent = txpreverifyqueue.GetTx(prevout.hash);
+        if (parent) {
+            if (prevout.n >= parent->vout.size())
+                return false;
+            job->vSpent[i] = parent->vout[prevout.n];
+        } else {
+            const Coin& coin = pcoinsTip->AccessCoin(prevout);
+            if (coin.IsSpent())
+                return false;
+            job->vSpent[i] = coin.out;
+        }
+        nValueIn += job->vSpent[i].nValue;
+        if (!MoneyRange(job->vSpent[i].nValue) || !MoneyRange(nValueIn))
+            return false;
+    }
+
+    CAmount nFees = nValueIn - tx.GetValueOut();
+    mempool.ApplyDelta(tx.GetHash(), nFees);
+    int64_t nSize = GetVirtualTransactionSize(tx);
+    if (nFees < mempool.GetMinFee(gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize) ||
+        nFees < ::minRelayTxFee.GetFee(nSize))
+        return false;
+
+    return txpreverifyqueue.Add(job);
+}
+
 bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     switch (inv.type)
@@ -946,6 +1157,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 
             return recentRejects->contains(inv.hash) ||
                    mempool.exists(inv.hash) ||
+                   txpreverifyqueue.Contains(inv.hash) ||
                    mapOrphanTransactions.count(inv.hash) ||
                    pcoinsTip->HaveCoinInCache(COutPoint(inv.hash, 0)) || // Best effort: only try output 0 and 1
                    pcoinsTip->HaveCoinInCache(COutPoint(inv.hash, 1));
@@ -1500,6 +1712,178 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
     return true;
 }
 
+/** Try to accept a transaction received from pfrom to the mempool, and handle the outcome. */
+void static ProcessTransaction(CNode* pfrom, const CTransactionRef& ptx, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    const CTransaction& tx = *ptx;
+    CInv inv(MSG_TX, tx.GetHash());
+
+    std::deque<COutPoint> vWorkQueue;
+    std::vector<uint256> vEraseQueue;
+
+    bool fMissingInputs = false;
+    CValidationState state;
+
+    std::list<CTransactionRef> lRemovedTxn;
+
+    if (!AlreadyHave(inv) &&
+        AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
+        mempool.check(pcoinsTip);
+        RelayTransaction(tx, connman);
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            vWorkQueue.emplace_back(inv.hash, i);
+        }
+
+        pfrom->nLastTXTime = GetTime();
+
+        LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
+            pfrom->GetId(),
+            tx.GetHash().ToString(),
+            mempool.size(), mempool.DynamicMemoryUsage() / 1000);
+
+        // Recursively process any orphan transactions that depended on this one
+        std::set<NodeId> setMisbehaving;
+        while (!vWorkQueue.empty()) {
+            auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
+            vWorkQueue.pop_front();
+            if (itByPrev == mapOrphanTransactionsByPrev.end())
+                continue;
+            for (auto mi = itByPrev->second.begin();
+                 mi != itByPrev->second.end();
+                 ++mi)
+            {
+                const CTransactionRef& porphanTx = (*mi)->second.tx;
+                const CTransaction& orphanTx = *porphanTx;
+                const uint256& orphanHash = orphanTx.GetHash();
+                NodeId fromPeer = (*mi)->second.fromPeer;
+                bool fMissingInputs2 = false;
+                // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
+                // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
+                // anyone relaying LegitTxX banned)
+                CValidationState stateDummy;
+
+
+                if (setMisbehaving.count(fromPeer))
+                    continue;
+                if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, &fMissingInputs2, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
+                    LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
+                    RelayTransaction(orphanTx, connman);
+                    for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
+                        vWorkQueue.emplace_back(orphanHash, i);
+                    }
+                    vEraseQueue.push_back(orphanHash);
+                }
+                else if (!fMissingInputs2)
+                {
+                    int nDos = 0;
+                    if (stateDummy.IsInvalid(nDos) && nDos > 0)
+                    {
+                        // Punish peer that gave us an invalid orphan tx
+                        Misbehaving(fromPeer, nDos);
+                        setMisbehaving.insert(fromPeer);
+                        LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
+                    }
+                    // Has inputs but not accepted to mempool
+                    // Probably non-standard or insufficient fee
+                    LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
+                    vEraseQueue.push_back(orphanHash);
+                    if (!orphanTx.HasWitness() && !stateDummy.CorruptionPossible()) {
+                        // Do not use rejection cache for witness transactions or
+                        // witness-stripped transactions, as they can have been malleated.
+                        // See https://github.com/bitcoin/bitcoin/issues/8279 for details.
+                        assert(recentRejects);
+                        recentRejects->insert(orphanHash);
+                    }
+                }
+                mempool.check(pcoinsTip);
+            }
+        }
+
+        for (uint256 hash : vEraseQueue)
+            EraseOrphanTx(hash);
+    }
+    else if (fMissingInputs)
+    {
+        bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
+        for (const CTxIn& txin : tx.vin) {
+            if (recentRejects->contains(txin.prevout.hash)) {
+                fRejectedParents = true;
+                break;
+            }
+        }
+        if (!fRejectedParents) {
+            uint32_t nFetchFlags = GetFetchFlags(pfrom);
+            for (const CTxIn& txin : tx.vin) {
+                CInv _inv(MSG_TX | nFetchFlags, txin.prevout.hash);
+                pfrom->AddInventoryKnown(_inv);
+                if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
+            }
+            AddOrphanTx(ptx, pfrom->GetId());
+
+            // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+            unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+            unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
+            if (nEvicted > 0) {
+                LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+            }
+        } else {
+            LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
+            // We will continue to reject this tx since it has rejected
+            // parents so avoid re-requesting it from other peers.
+            recentRejects->insert(tx.GetHash());
+        }
+    } else {
+        if (!tx.HasWitness() && !state.CorruptionPossible()) {
+            // Do not use rejection cache for witness transactions or
+            // witness-stripped transactions, as they can have been malleated.
+            // See https://github.com/bitcoin/bitcoin/issues/8279 for details.
+            assert(recentRejects);
+            recentRejects->insert(tx.GetHash());
+            if (RecursiveDynamicUsage(*ptx) < 100000) {
+                AddToCompactExtraTransactions(ptx);
+            }
+        } else if (tx.HasWitness() && RecursiveDynamicUsage(*ptx) < 100000) {
+            AddToCompactExtraTransactions(ptx);
+        }
+
+        if (pfrom->fWhitelisted && gArgs.GetBoolArg("-whitelistforcerelay", DEFAULT_WHITELISTFORCERELAY)) {
+            // Always relay transactions received from whitelisted peers, even
+            // if they were already in the mempool or rejected from it due
+            // to policy, allowing the node to function as a gateway for
+            // nodes hidden behind it.
+            //
+            // Never relay transactions that we would assign a non-zero DoS
+            // score for, as we expect peers to do the same with us in that
+            // case.
+            int nDoS = 0;
+            if (!state.IsInvalid(nDoS) || nDoS == 0) {
+                LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->GetId());
+                RelayTransaction(tx, connman);
+            } else {
+                LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s)\n", tx.GetHash().ToString(), pfrom->GetId(), FormatStateMessage(state));
+            }
+        }
+    }
+
+    for (const CTransactionRef& removedTx : lRemovedTxn)
+        AddToCompactExtraTransactions(removedTx);
+
+    int nDoS = 0;
+    if (state.IsInvalid(nDoS))
+    {
+        LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
+            pfrom->GetId(),
+            FormatStateMessage(state));
+        if (state.GetRejectCode() > 0 && state.GetRejectCode() < REJECT_INTERNAL) // Never send AcceptToMemoryPool's internal codes over P2P
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::REJECT, std::string(NetMsgType::TX), (unsigned char)state.GetRejectCode(),
+                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash));
+        if (nDoS > 0) {
+            Misbehaving(pfrom->GetId(), nDoS);
+        }
+    }
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
@@ -2218,180 +2602,27 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        std::deque<COutPoint> vWorkQueue;
-        std::vector<uint256> vEraseQueue;
         CTransactionRef ptx;
         vRecv >> ptx;
-        const CTransaction& tx = *ptx;
 
-        CInv inv(MSG_TX, tx.GetHash());
+        CInv inv(MSG_TX, ptx->GetHash());
         pfrom->AddInventoryKnown(inv);
 
         LOCK(cs_main);
 
-        bool fMissingInputs = false;
-        CValidationState state;
-
         pfrom->setAskFor.erase(inv.hash);
         mapAlreadyAskedFor.erase(inv.hash);
 
-        std::list<CTransactionRef> lRemovedTxn;
-
-        if (!AlreadyHave(inv) &&
-            AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
-            mempool.check(pcoinsTip);
-            RelayTransaction(tx, connman);
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                vWorkQueue.emplace_back(inv.hash, i);
-            }
-
-            pfrom->nLastTXTime = GetTime();
-
-            LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
-                pfrom->GetId(),
-                tx.GetHash().ToString(),
-                mempool.size(), mempool.DynamicMemoryUsage() / 1000);
-
-            // Recursively process any orphan transactions that depended on this one
-            std::set<NodeId> setMisbehaving;
-            while (!vWorkQueue.empty()) {
-                auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
-                vWorkQueue.pop_front();
-                if (itByPrev == mapOrphanTransactionsByPrev.end())
-                    continue;
-                for (auto mi = itByPrev->second.begin();
-                     mi != itByPrev->second.end();
-                     ++mi)
-                {
-                    const CTransactionRef& porphanTx = (*mi)->second.tx;
-                    const CTransaction& orphanTx = *porphanTx;
-                    const uint256& orphanHash = orphanTx.GetHash();
-                    NodeId fromPeer = (*mi)->second.fromPeer;
-                    bool fMissingInputs2 = false;
-                    // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
-                    // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
-                    // anyone relaying LegitTxX banned)
-                    CValidationState stateDummy;
-
-
-                    if (setMisbehaving.count(fromPeer))
-                        continue;
-                    if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, &fMissingInputs2, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
-                        LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
-                        RelayTransaction(orphanTx, connman);
-                        for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
-                            vWorkQueue.emplace_back(orphanHash, i);
-                        }
-                        vEraseQueue.push_back(orphanHash);
-                    }
-                    else if (!fMissingInputs2)
-                    {
-                        int nDos = 0;
-                        if (stateDummy.IsInvalid(nDos) && nDos > 0)
-                        {
-                            // Punish peer that gave us an invalid orphan tx
-                            Misbehaving(fromPeer, nDos);
-                            setMisbehaving.insert(fromPeer);
-                            LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
-                        }
-                        // Has inputs but not accepted to mempool
-                        // Probably non-standard or insufficient fee
-                        LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
-                        vEraseQueue.push_back(orphanHash);
-                        if (!orphanTx.HasWitness() && !stateDummy.CorruptionPossible()) {
-                            // Do not use rejection cache for witness transactions or
-                            // witness-stripped transactions, as they can have been malleated.
-                            // See https://github.com/bitcoin/bitcoin/issues/8279 for details.
-                            assert(recentRejects);
-                            recentRejects->insert(orphanHash);
-                        }
-                    }
-                    mempool.check(pcoinsTip);
-                }
-            }
-
-            for (uint256 hash : vEraseQueue)
-                EraseOrphanTx(hash);
-        }
-        else if (fMissingInputs)
-        {
-            bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
-            for (const CTxIn& txin : tx.vin) {
-                if (recentRejects->contains(txin.prevout.hash)) {
-                    fRejectedParents = true;
-                    break;
-                }
-            }
-            if (!fRejectedParents) {
-                uint32_t nFetchFlags = GetFetchFlags(pfrom);
-                for (const CTxIn& txin : tx.vin) {
-                    CInv _inv(MSG_TX | nFetchFlags, txin.prevout.hash);
-                    pfrom->AddInventoryKnown(_inv);
-                    if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
-                }
-                AddOrphanTx(ptx, pfrom->GetId());
-
-                // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
-                unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-                unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
-                if (nEvicted > 0) {
-                    LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
-                }
-            } else {
-                LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
-                // We will continue to reject this tx since it has rejected
-                // parents so avoid re-requesting it from other peers.
-                recentRejects->insert(tx.GetHash());
-            }
-        } else {
-            if (!tx.HasWitness() && !state.CorruptionPossible()) {
-                // Do not use rejection cache for witness transactions or
-                // witness-stripped transactions, as they can have been malleated.
-                // See https://github.com/bitcoin/bitcoin/issues/8279 for details.
-                assert(recentRejects);
-                recentRejects->insert(tx.GetHash());
-                if (RecursiveDynamicUsage(*ptx) < 100000) {
-                    AddToCompactExtraTransactions(ptx);
-                }
-            } else if (tx.HasWitness() && RecursiveDynamicUsage(*ptx) < 100000) {
-                AddToCompactExtraTransactions(ptx);
-            }
-
-            if (pfrom->fWhitelisted && gArgs.GetBoolArg("-whitelistforcerelay", DEFAULT_WHITELISTFORCERELAY)) {
-                // Always relay transactions received from whitelisted peers, even
-                // if they were already in the mempool or rejected from it due
-                // to policy, allowing the node to function as a gateway for
-                // nodes hidden behind it.
-                //
-                // Never relay transactions that we would assign a non-zero DoS
-                // score for, as we expect peers to do the same with us in that
-                // case.
-                int nDoS = 0;
-                if (!state.IsInvalid(nDoS) || nDoS == 0) {
-                    LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->GetId());
-                    RelayTransaction(tx, connman);
-                } else {
-                    LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s)\n", tx.GetHash().ToString(), pfrom->GetId(), FormatStateMessage(state));
-                }
-            }
-        }
+        // Already being verified, from another peer
+        if (txpreverifyqueue.Contains(inv.hash))
+            return true;
 
-        for (const CTransactionRef& removedTx : lRemovedTxn)
-            AddToCompactExtraTransactions(removedTx);
+        // New transactions have their signatures checked off cs_main first,
+        // they are processed once the queue hands them back.
+        if (!AlreadyHave(inv) && QueueTxPreVerify(ptx, pfrom->GetId()))
+            return true;
 
-        int nDoS = 0;
-        if (state.IsInvalid(nDoS))
-        {
-            LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
-                pfrom->GetId(),
-                FormatStateMessage(state));
-            if (state.GetRejectCode() > 0 && state.GetRejectCode() < REJECT_INTERNAL) // Never send AcceptToMemoryPool's internal codes over P2P
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::REJECT, strCommand, (unsigned char)state.GetRejectCode(),
-                                   state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash));
-            if (nDoS > 0) {
-                Misbehaving(pfrom->GetId(), nDoS);
-            }
-        }
+        ProcessTransaction(pfrom, ptx, connman);
     }
 
 
@@ -2582,10 +2813,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         if (fBlockReconstructed) {
             // If we got here, we were able to optimistically reconstruct a
-            // block that is in flight from some other peer.
+            // block that is in flight from some other peer. Its header was
+            // accepted above, so reuse the index hash rather than rehashing.
+            const uint256 blockhash = pindex->GetBlockHash();
             {
                 LOCK(cs_main);
-                mapBlockSource.emplace(pblock->GetHash(), std::make_pair(pfrom->GetId(), false));
+                mapBlockSource.emplace(blockhash, std::make_pair(pfrom->GetId(), false));
             }
             bool fNewBlock = false;
             // Setting fForceProcessing to true means that we bypass some of
@@ -2602,7 +2835,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 pfrom->nLastBlockTime = GetTime();
             } else {
                 LOCK(cs_main);
-                mapBlockSource.erase(pblock->GetHash());
+                mapBlockSource.erase(blockhash);
             }
             LOCK(cs_main); // hold cs_main for CBlockIndex::IsValid()
             if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS)) {
@@ -2610,12 +2843,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // process from some other peer.  We do this after calling
                 // ProcessNewBlock so that a malleated cmpctblock announcement
                 // can't be used to interfere with block relay.
-                if (pblock->fChecked) {
-                    MarkBlockAsReceived(pblock->GetHash());
-                } else {
-                    uint256 mix_hash;
-                    MarkBlockAsReceived(pblock->GetHashFull(mix_hash));
-                }
+                MarkBlockAsReceived(blockhash);
             }
         }
 
@@ -2691,12 +2919,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 pfrom->nLastBlockTime = GetTime();
             } else {
                 LOCK(cs_main);
-                if (pblock->fChecked) {
-                    mapBlockSource.erase(pblock->GetHash());
-                } else {
-                    uint256 mix_hash;
-                    mapBlockSource.erase(pblock->GetHashFull(mix_hash));
-                }
+                mapBlockSource.erase(resp.blockhash);
             }
         }
     }
@@ -2740,10 +2963,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         vRecv >> *pblock;
 
-        LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->GetId());
+        const uint256 hash(pblock->GetHash());
+        LogPrint(BCLog::NET, "received block %s peer=%d\n", hash.ToString(), pfrom->GetId());
 
         bool forceProcessing = false;
-        const uint256 hash(pblock->GetHash());
         {
             LOCK(cs_main);
             // Also always process if we requested the block explicitly, as we may
@@ -2759,7 +2982,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             pfrom->nLastBlockTime = GetTime();
         } else {
             LOCK(cs_main);
-            mapBlockSource.erase(pblock->GetHash());
+            mapBlockSource.erase(hash);
         }
     }
 
@@ -3024,6 +3247,27 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //
     bool fMoreWork = false;
 
+    // Process the transactions whose signatures have been checked meanwhile,
+    // on behalf of the peers that sent them
+    std::vector<CTxPreVerifyQueue::JobRef> vVerified;
+    txpreverifyqueue.TakeVerified(vVerified);
+    if (!vVerified.empty()) {
+        LOCK(cs_main);
+        for (const CTxPreVerifyQueue::JobRef& job : vVerified) {
+            CNode* pnode = nullptr;
+            connman->ForNode(job->nodeid, [&pnode](CNode* pnodeIn) {
+                pnodeIn->AddRef();
+                pnode = pnodeIn;
+                return true;
+            });
+            if (!pnode)
+                continue;
+            if (!pnode->fDisconnect)
+                ProcessTransaction(pnode, job->tx, connman);
+            pnode->Release();
+        }
+    }
+
     if (!pfrom->vRecvGetData.empty())
         ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
 
@@ -3042,6 +3286,10 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LOCK(pfrom->cs_vProcessMsg);
         if (pfrom->vProcessMsg.empty())
             return false;
+        // Keep the order of responses: only further transactions are read
+        // while those of this peer are being verified
+        if (pfrom->vProcessMsg.front().hdr.GetCommand() != NetMsgType::TX && txpreverifyqueue.HasJobsFrom(pfrom->GetId()))
+            return false;
         // Just take one message
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
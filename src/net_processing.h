@@ -13,6 +13,10 @@
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Maximum number of relayed transactions waiting for signature pre-verification */
+static const unsigned int MAX_TX_PREVERIFY_QUEUE = 1000;
+/** Maximum number of transactions of one peer waiting for signature pre-verification */
+static const unsigned int MAX_TX_PREVERIFY_PER_PEER = 100;
 /** Expiration time for orphan transactions in seconds */
 static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
 /** Minimum time between orphan transactions expire time checks in seconds */
@@ -81,5 +85,7 @@ struct CNodeStateStats {
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
+/** Run an instance of the relayed transaction signature pre-verification thread */
+void ThreadTxPreVerify();
 
 #endif // MEOWCOIN_NET_PROCESSING_H
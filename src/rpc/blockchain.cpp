@@ -16,6 +16,9 @@
 #include "consensus/validation.h"
 #include "validation.h"
 #include "core_io.h"
+#include "index/base.h"
+#include "index/spent.h"
+#include "index/timestamp.h"
 #include "policy/feerate.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
@@ -54,7 +57,7 @@ static std::mutex cs_blockchange;
 static std::condition_variable cond_blockchange;
 static CUpdatedBlock latestblock;
 
-extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool expanded);
+extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool expanded, bool fSpentInfo);
 
 double GetDifficulty(const CBlockIndex* blockindex)
 {
@@ -164,7 +167,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     return result;
 }
 
-UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
+UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex, bool fSpentSynced)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", block.GetHash().GetHex()));
@@ -182,6 +185,7 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
 
     UniValue deltas(UniValue::VARR);
+    bool fIncomplete = false;
 
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
         const CTransaction &tx = *(block.vtx[i]);
@@ -217,8 +221,10 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
                     delta.push_back(Pair("prevout", (int)input.prevout.n));
 
                     inputs.push_back(delta);
-                } else {
+                } else if (fSpentSynced) {
                     throw JSONRPCError(RPC_INTERNAL_ERROR, "Spent information not available");
+                } else {
+                    fIncomplete = true;
                 }
 
             }
@@ -255,6 +261,8 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 
     }
     result.push_back(Pair("deltas", deltas));
+    if (fIncomplete)
+        result.push_back(Pair("incomplete", true));
     result.push_back(Pair("time", block.GetBlockTime()));
     result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
     result.push_back(Pair("nonce", (uint64_t)block.nNonce));
@@ -1157,6 +1165,12 @@ UniValue getblockdeltas(const JSONRPCRequest& request)
     std::string strHash = request.params[0].get_str();
     uint256 hash(uint256S(strHash));
 
+    // The spent index is written by its own thread; must not hold cs_main here.
+    // While it is catching up the inputs it has no data for yet are left out.
+    bool fSpentSynced = WaitForIndexIfSynced(g_spentindex.get());
+
+    LOCK(cs_main);
+
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
@@ -1169,7 +1183,18 @@ UniValue getblockdeltas(const JSONRPCRequest& request)
     if(!ReadBlockFromDisk(block, pblockindex, GetParams().GetConsensus()))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
-    return blockToDeltasJSON(block, pblockindex);
+    return blockToDeltasJSON(block, pblockindex, fSpentSynced);
+}
+
+void EnsureIndexSynced(CBaseIndex* index)
+{
+    if (!WaitForIndexIfSynced(index))
+        throw JSONRPCError(RPC_IN_WARMUP, strprintf("The %s is still catching up with the chain", index->GetName()));
+}
+
+bool WaitForIndexIfSynced(CBaseIndex* index)
+{
+    return !index || index->BlockUntilSyncedToCurrentChain();
 }
 
 UniValue getblockhashes(const JSONRPCRequest& request)
@@ -1222,11 +1247,13 @@ UniValue getblockhashes(const JSONRPCRequest& request)
 
     std::vector<std::pair<uint256, unsigned int> > blockHashes;
 
-    if (fActiveOnly)
-        LOCK(cs_main);
+    EnsureIndexSynced(g_timestampindex.get());
 
-    if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
+    {
+        LOCK(cs_main); // for noOrphans
+        if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
+        }
     }
 
     UniValue result(UniValue::VARR);
@@ -1530,6 +1557,27 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
     return true;
 }
 
+//! Calculate the rolling hash and totals of the unspent transaction output set,
+//! scanning it with all cores. Unlike hash_serialized_2 they do not depend on
+//! the order of the coins.
+static bool ScanUTXOStats(CCoinsViewDB *view, CUTXOStats &stats)
+{
+    std::vector<CUTXOStats> vThreadStats(MAX_UTXO_SCAN_THREADS);
+    if (!ParallelForEachCoin(*view, [&vThreadStats](int nThread, const COutPoint& outpoint, const Coin& coin) {
+            vThreadStats[nThread].AddCoin(outpoint, coin);
+            return true;
+        }, 0, stats.hashBlock))
+        return false;
+
+    const uint256 hashBlock = stats.hashBlock;
+    stats = CUTXOStats();
+    stats.hashBlock = hashBlock;
+    for (const CUTXOStats& threadStats : vThreadStats) {
+        stats += threadStats;
+    }
+    return true;
+}
+
 UniValue pruneblockchain(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1581,29 +1629,74 @@ UniValue pruneblockchain(const JSONRPCRequest& request)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, unless hash_type is \"muhash\".\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"   (string, optional, default=\"hash_serialized_2\") Which UTXO set hash to return.\n"
+            "                 \"hash_serialized_2\" walks the whole UTXO set.\n"
+            "                 \"muhash\" answers at once from the rolling hash and totals kept by -utxostats,\n"
+            "                 and does not report the number of transactions.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (hash_serialized_2 only)\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash (hash_serialized_2 only)\n"
+            "  \"muhash\": \"hash\",     (string) The rolling MuHash3072 of the UTXO set (muhash only)\n"
             "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\"")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
+    std::string hash_type = "hash_serialized_2";
+    if (!request.params[0].isNull())
+        hash_type = request.params[0].get_str();
+    if (hash_type != "hash_serialized_2" && hash_type != "muhash")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "hash_type must be one of \"hash_serialized_2\" or \"muhash\"");
+
     UniValue ret(UniValue::VOBJ);
 
+    if (hash_type == "muhash") {
+        if (!fUTXOStats)
+            throw JSONRPCError(RPC_MISC_ERROR, "UTXO set stats are disabled; restart with -utxostats");
+
+        CUTXOStats utxostats;
+        if (!GetTipUTXOStats(utxostats)) {
+            // The running stats were lost (e.g. after an unclean shutdown); scan
+            // the set once, and keep them up to date from there if the tip has not
+            // moved in the meantime.
+            FlushStateToDisk();
+            if (!ScanUTXOStats(pcoinsdbview, utxostats))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+            SeedTipUTXOStats(utxostats);
+        }
+
+        int nHeight = 0;
+        {
+            LOCK(cs_main);
+            BlockMap::const_iterator it = mapBlockIndex.find(utxostats.hashBlock);
+            if (it != mapBlockIndex.end())
+                nHeight = it->second->nHeight;
+        }
+        ret.push_back(Pair("height", (int64_t)nHeight));
+        ret.push_back(Pair("bestblock", utxostats.hashBlock.GetHex()));
+        ret.push_back(Pair("txouts", utxostats.nTransactionOutputs));
+        ret.push_back(Pair("bogosize", utxostats.nBogoSize));
+        ret.push_back(Pair("muhash", utxostats.GetHash().GetHex()));
+        ret.push_back(Pair("disk_size", (uint64_t)pcoinsdbview->EstimateSize()));
+        ret.push_back(Pair("total_amount", ValueFromAmount(utxostats.nTotalAmount)));
+        return ret;
+    }
+
     CCoinsStats stats;
     FlushStateToDisk();
     if (GetUTXOStats(pcoinsdbview, stats)) {
@@ -1621,6 +1714,107 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue scantxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "scantxoutset [\"address\",...]\n"
+            "\nScans the unspent transaction output set for outputs paying to the given addresses,\n"
+            "using all cores. Does not need any index.\n"
+            "\nArguments:\n"
+            "1. \"addresses\"    (array, required) The addresses to look for\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\": n,               (numeric) The block height of the scanned UTXO set\n"
+            "  \"bestblock\": \"hash\",       (string) The block hash of the scanned UTXO set\n"
+            "  \"txouts\": n,               (numeric) The number of outputs scanned\n"
+            "  \"unspents\": [\n"
+            "    {\n"
+            "      \"txid\": \"hash\",          (string) The transaction id\n"
+            "      \"vout\": n,               (numeric) The output number\n"
+            "      \"address\": \"address\",    (string) The address\n"
+            "      \"scriptPubKey\": \"hex\",   (string) The script\n"
+            "      \"amount\": x.xxx,         (numeric) The amount in " + CURRENCY_UNIT + "\n"
+            "      \"height\": n              (numeric) The height of the block the output was created in\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"total_amount\": x.xxx      (numeric) The total amount of the unspents found\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("scantxoutset", "'[\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]'")
+            + HelpExampleRpc("scantxoutset", "[\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]")
+        );
+
+    std::map<CScript, std::string> mapScripts;
+    const UniValue& addresses = request.params[0].get_array();
+    for (unsigned int i = 0; i < addresses.size(); i++) {
+        const std::string& strAddress = addresses[i].get_str();
+        CTxDestination dest = DecodeDestination(strAddress);
+        if (!IsValidDestination(dest))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string("Invalid address: ") + strAddress);
+        mapScripts[GetScriptForDestination(dest)] = strAddress;
+    }
+
+    struct ScanResult {
+        int64_t nScanned = 0;
+        std::vector<std::pair<COutPoint, Coin> > vFound;
+    };
+    std::vector<ScanResult> vThreadResults(MAX_UTXO_SCAN_THREADS);
+
+    FlushStateToDisk();
+    uint256 hashBlock;
+    if (!ParallelForEachCoin(*pcoinsdbview, [&](int nThread, const COutPoint& outpoint, const Coin& coin) {
+            ScanResult& result = vThreadResults[nThread];
+            result.nScanned++;
+            if (mapScripts.count(coin.out.scriptPubKey))
+                result.vFound.emplace_back(outpoint, coin);
+            return true;
+        }, 0, hashBlock))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+
+    int64_t nScanned = 0;
+    std::vector<std::pair<COutPoint, Coin> > vFound;
+    for (ScanResult& result : vThreadResults) {
+        nScanned += result.nScanned;
+        vFound.insert(vFound.end(), result.vFound.begin(), result.vFound.end());
+    }
+    std::sort(vFound.begin(), vFound.end(), [](const std::pair<COutPoint, Coin>& a, const std::pair<COutPoint, Coin>& b) {
+        return a.first < b.first;
+    });
+
+    int nHeight = 0;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hashBlock);
+        if (it != mapBlockIndex.end())
+            nHeight = it->second->nHeight;
+    }
+
+    UniValue unspents(UniValue::VARR);
+    CAmount nTotal = 0;
+    for (const std::pair<COutPoint, Coin>& found : vFound) {
+        const CTxOut& txout = found.second.out;
+        UniValue unspent(UniValue::VOBJ);
+        unspent.push_back(Pair("txid", found.first.hash.GetHex()));
+        unspent.push_back(Pair("vout", (int64_t)found.first.n));
+        unspent.push_back(Pair("address", mapScripts[txout.scriptPubKey]));
+        unspent.push_back(Pair("scriptPubKey", HexStr(txout.scriptPubKey.begin(), txout.scriptPubKey.end())));
+        unspent.push_back(Pair("amount", ValueFromAmount(txout.nValue)));
+        unspent.push_back(Pair("height", (int64_t)found.second.nHeight));
+        unspents.push_back(unspent);
+        nTotal += txout.nValue;
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("height", (int64_t)nHeight));
+    ret.push_back(Pair("bestblock", hashBlock.GetHex()));
+    ret.push_back(Pair("txouts", nScanned));
+    ret.push_back(Pair("unspents", unspents));
+    ret.push_back(Pair("total_amount", ValueFromAmount(nTotal)));
+    return ret;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -2070,6 +2264,64 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return MempoolInfoToJSON(mempool);
 }
 
+UniValue getdbinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getdbinfo ( \"name\" )\n"
+            "\nReturns the LevelDB settings and statistics of the open databases.\n"
+            "\nArguments:\n"
+            "1. \"name\"      (string, optional) Only return this database, e.g. chainstate or blockindex\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\" : {                       (json object) Database name, as in the -<name>db* arguments\n"
+            "    \"path\" : \"xxx\",                (string) Location of the database\n"
+            "    \"cache_size\" : n,              (numeric) Memory for the block cache and write buffers, in bytes\n"
+            "    \"compression\" : \"xxx\",         (string) Block compression in use, none or snappy\n"
+            "    \"bloom_bits\" : n,              (numeric) Bits per key of the bloom filters, 0 for none\n"
+            "    \"block_size\" : n,              (numeric) Block size in bytes\n"
+            "    \"write_buffer_size\" : n,       (numeric) Write buffer size in bytes\n"
+            "    \"max_file_size\" : n,           (numeric) Table file size in bytes\n"
+            "    \"approximate_memory_usage\" : n, (numeric) Memory LevelDB uses, as of leveldb.approximate-memory-usage\n"
+            "    \"stats\" : \"xxx\"                (string) Files and compactions per level, as of leveldb.stats\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbinfo", "")
+            + HelpExampleCli("getdbinfo", "\"chainstate\"")
+            + HelpExampleRpc("getdbinfo", "\"chainstate\"")
+        );
+
+    std::string strFilter;
+    if (!request.params[0].isNull())
+        strFilter = request.params[0].get_str();
+
+    UniValue ret(UniValue::VOBJ);
+    ForEachOpenDB([&](const CDBWrapper& db) {
+        const CDBOptions& dbOptions = db.GetDBOptions();
+        if (!strFilter.empty() && dbOptions.strName != strFilter)
+            return;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("path", db.GetPath().string());
+        obj.pushKV("cache_size", (uint64_t)dbOptions.nCacheSize);
+        obj.pushKV("compression", dbOptions.fCompression ? "snappy" : "none");
+        obj.pushKV("bloom_bits", dbOptions.nBloomBits);
+        obj.pushKV("block_size", (uint64_t)dbOptions.nBlockSize);
+        obj.pushKV("write_buffer_size", (uint64_t)(dbOptions.nWriteBufferSize ? dbOptions.nWriteBufferSize : dbOptions.nCacheSize / 4));
+        obj.pushKV("max_file_size", (uint64_t)dbOptions.nMaxFileSize);
+        std::string strValue;
+        if (db.GetProperty("leveldb.approximate-memory-usage", strValue))
+            obj.pushKV("approximate_memory_usage", (uint64_t)atoi64(strValue));
+        if (db.GetProperty("leveldb.stats", strValue))
+            obj.pushKV("stats", strValue);
+        ret.pushKV(dbOptions.strName, obj);
+    });
+
+    if (!strFilter.empty() && ret.empty())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Database not found: " + strFilter);
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -2306,6 +2558,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "clearmempool",           &clearmempool,           {} },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
+    { "blockchain",         "getdbinfo",              &getdbinfo,              {"name"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
@@ -2323,7 +2576,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {"hash_type"} },
+    { "blockchain",         "scantxoutset",           &scantxoutset,           {"addresses"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
@@ -9,6 +9,7 @@
 #include <string>
 #include "primitives/algos.h"
 
+class CBaseIndex;
 class CBlock;
 class CBlockIndex;
 class CTxMemPool;
@@ -47,6 +48,12 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
+/** Wait for index, if enabled, to catch up with the tip, or throw if it is still being built */
+void EnsureIndexSynced(CBaseIndex* index);
+
+/** Wait for index, if enabled, to catch up with the tip. Returns false, without waiting, if it is still being built */
+bool WaitForIndexIfSynced(CBaseIndex* index);
+
 /** Block statistics to JSON */
 UniValue getblockstats(const JSONRPCRequest& request);
 
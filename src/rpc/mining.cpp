@@ -12,6 +12,7 @@
 #include "consensus/params.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "hash.h"
 #include "init.h"
 #include "validation.h"
 #include "miner.h"
@@ -28,7 +29,9 @@
 #include "warnings.h"
 #include "primitives/algos.h"
 
+#include <deque>
 #include <memory>
+#include <set>
 #include <stdint.h>
 #include <utility>
 
@@ -38,7 +41,6 @@
 #include <crypto/ethash/include/ethash/progpow.hpp>
 #include <crypto/ethash/include/ethash/meowpow.hpp>
 
-extern uint64_t nHashesPerSec;
 
 std::map<std::string, CBlock> mapMEWCKAWBlockTemplates;
 std::map<std::string, CBlock> mapMEWCMEOWBlockTemplates;
@@ -330,6 +332,15 @@ UniValue getmininginfo(const JSONRPCRequest& request)
             "  \"difficulty\": xxx.xxxxx    (numeric) The current difficulty\n"
             "  \"networkhashps\": nnn,      (numeric) The network hashes per second\n"
             "  \"hashespersec\": nnn,       (numeric) The hashes per second of built-in miner\n"
+            "  \"minerthreads\": [          (array) The threads of the built-in miner\n"
+            "    {\n"
+            "      \"thread\": n,             (numeric) The thread number\n"
+            "      \"hashespersec\": nnn,     (numeric) The hashes per second of this thread\n"
+            "      \"hashes\": nnn,           (numeric) The hashes done by this thread\n"
+            "      \"staletemplates\": n,     (numeric) Block templates abandoned because the tip changed\n"
+            "      \"staleblocks\": n         (numeric) Blocks found after the tip had moved on\n"
+            "    }, ...\n"
+            "  ],\n"
             "  \"pooledtx\": n              (numeric) The size of the mempool\n"
             "  \"chain\": \"xxxx\",           (string) current network name as defined in BIP70 (main, test, regtest)\n"
             "  \"warnings\": \"...\"          (string) any network and blockchain warnings\n"
@@ -348,7 +359,20 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     obj.push_back(Pair("currentblocktx",   (uint64_t)nLastBlockTx));
     obj.push_back(Pair("difficulty",       (double)GetDifficulty()));
     obj.push_back(Pair("networkhashps",    getnetworkhashps(request)));
-    obj.push_back(Pair("hashespersec",     (uint64_t)nHashesPerSec));
+    uint64_t nHashesPerSec = 0;
+    UniValue minerThreads(UniValue::VARR);
+    for (const CMinerThreadStats& stats : GetMinerThreadStats()) {
+        UniValue thread(UniValue::VOBJ);
+        thread.push_back(Pair("thread",         stats.nThread));
+        thread.push_back(Pair("hashespersec",   stats.nHashesPerSec));
+        thread.push_back(Pair("hashes",         stats.nHashesDone));
+        thread.push_back(Pair("staletemplates", stats.nStaleTemplates));
+        thread.push_back(Pair("staleblocks",    stats.nStaleBlocks));
+        minerThreads.push_back(thread);
+        nHashesPerSec += stats.nHashesPerSec;
+    }
+    obj.push_back(Pair("hashespersec",     nHashesPerSec));
+    obj.push_back(Pair("minerthreads",     minerThreads));
     obj.push_back(Pair("pooledtx",         (uint64_t)mempool.size()));
     obj.push_back(Pair("chain", GetParams().NetworkIDString()));
     if (IsDeprecatedRPCEnabled("getmininginfo")) {
@@ -414,6 +438,85 @@ static UniValue BIP22ValidationResult(const CValidationState& state)
     return "valid?";
 }
 
+/** Number of recent templates getblocktemplate can send delta updates against */
+static const unsigned int MAX_TEMPLATE_HISTORY = 16;
+
+/** Transactions of a template returned by getblocktemplate */
+struct CTemplateTransactions
+{
+    uint256 hashTemplate;
+    uint256 hashPrevBlock;
+    //! The transactions of the template, in block order
+    std::vector<uint256> vTxids;
+    std::set<uint256> setTxids;
+};
+
+/** Recent templates, oldest first, guarded by cs_main */
+static std::deque<CTemplateTransactions> vTemplateHistory;
+
+/** A template is identified by its previous block and the transactions in it */
+static uint256 GetTemplateId(const CBlock& block)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << block.hashPrevBlock;
+    for (size_t i = 1; i < block.vtx.size(); i++)
+        ss << block.vtx[i]->GetHash();
+    return ss.GetHash();
+}
+
+static void AddTemplateToHistory(const uint256& hashTemplate, const CBlock& block)
+{
+    for (const CTemplateTransactions& entry : vTemplateHistory) {
+        if (entry.hashTemplate == hashTemplate)
+            return;
+    }
+    CTemplateTransactions entry;
+    entry.hashTemplate = hashTemplate;
+    entry.hashPrevBlock = block.hashPrevBlock;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        entry.vTxids.push_back(block.vtx[i]->GetHash());
+        entry.setTxids.insert(block.vtx[i]->GetHash());
+    }
+    vTemplateHistory.push_back(std::move(entry));
+    if (vTemplateHistory.size() > MAX_TEMPLATE_HISTORY)
+        vTemplateHistory.pop_front();
+}
+
+static const CTemplateTransactions* FindTemplateInHistory(const uint256& hashTemplate, const uint256& hashPrevBlock)
+{
+    for (const CTemplateTransactions& entry : vTemplateHistory) {
+        if (entry.hashTemplate == hashTemplate)
+            return entry.hashPrevBlock == hashPrevBlock ? &entry : nullptr;
+    }
+    return nullptr;
+}
+
+/**
+ * Whether the transactions of block are those of base, in the same order and
+ * without the removed ones, followed by new ones. Only then can a client
+ * rebuild the block from a delta update.
+ */
+static bool IsDeltaOfTemplate(const CBlock& block, const CTemplateTransactions& base)
+{
+    size_t nBase = 0;
+    bool fNew = false;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        const uint256& hash = block.vtx[i]->GetHash();
+        if (!base.setTxids.count(hash)) {
+            fNew = true;
+            continue;
+        }
+        if (fNew)
+            return false;
+        while (nBase < base.vTxids.size() && base.vTxids[nBase] != hash)
+            nBase++;
+        if (nBase == base.vTxids.size())
+            return false;
+        nBase++;
+    }
+    return true;
+}
+
 std::string gbt_vb_name(const Consensus::DeploymentPos pos) {
     const struct VBDeploymentInfo& vbinfo = VersionBitsDeploymentInfo[pos];
     std::string s = vbinfo.name;
@@ -447,7 +550,9 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             "       \"rules\":[            (array, optional) A list of strings\n"
             "           \"support\"          (string) client side supported softfork deployment\n"
             "           ,...\n"
-            "       ]\n"
+            "       ],\n"
+            "       \"templateid\":\"xxxx\"  (string, optional) The templateid of a template the client has. If it is recent and has the\n"
+            "                                same previous block, only the changes to its transactions are returned (see below)\n"
             "     }\n"
             "\n"
 
@@ -497,7 +602,16 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             "  \"curtime\" : ttt,                  (numeric) current timestamp in seconds since epoch (Jan 1 1970 GMT)\n"
             "  \"bits\" : \"xxxxxxxx\",              (string) compressed target of next block\n"
             "  \"height\" : n                      (numeric) The height of the next block\n"
+            "  \"templateid\" : \"xxxx\",            (string) Identifies the previous block and transactions of this template\n"
+            "  \"basetemplateid\" : \"xxxx\",        (string) Only in delta updates: the templateid of the request\n"
+            "  \"removed\" : [ \"txid\", ... ],      (array of strings) Only in delta updates: transactions of the base template that are\n"
+            "                                      not in this one\n"
             "}\n"
+            "\nIn a delta update, \"transactions\" only lists the transactions that are not in the base template, and their\n"
+            "\"depends\" are txids instead of indexes. The transactions of the block are those of the base template, in the\n"
+            "same order and without the removed ones, followed by the listed ones. When the transactions cannot be described\n"
+            "this way, e.g. because the template was assembled from scratch in a different order, a full template is\n"
+            "returned instead.\n"
 
             "\nExamples:\n"
             + HelpExampleCli("getblocktemplate", "")
@@ -510,6 +624,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     UniValue lpval = NullUniValue;
     std::set<std::string> setClientRules;
     int64_t nMaxVersionPreVB = -1;
+    uint256 hashBaseTemplate;
     if (!request.params[0].isNull())
     {
         const UniValue& oparam = request.params[0].get_obj();
@@ -554,6 +669,10 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             return BIP22ValidationResult(state);
         }
 
+        const UniValue& templateidval = find_value(oparam, "templateid");
+        if (!templateidval.isNull())
+            hashBaseTemplate = ParseHashV(templateidval, "templateid");
+
         const UniValue& aClientRules = find_value(oparam, "rules");
         if (aClientRules.isArray()) {
             for (unsigned int i = 0; i < aClientRules.size(); ++i) {
@@ -642,8 +761,10 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     // Cache whether the last invocation was with segwit support, to avoid returning
     // a segwit-block to a non-segwit caller.
     static bool fLastTemplateSupportsSegwit = true;
+    static uint256 hashTemplate;
+    // An incrementally updated template is cheap, so it follows every mempool change
     if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5) ||
+        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && (g_templateassembler || GetTime() - nStart > 5)) ||
         fLastTemplateSupportsSegwit != fSupportsSegwit)
     {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
@@ -674,10 +795,16 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         }
 
         // getblocktemplate should always create MEOWPOW blocks (not AuxPoW)
-        pblocktemplate = BlockAssembler(GetParams()).CreateNewBlock(script, fSupportsSegwit, false);
+        if (g_templateassembler)
+            pblocktemplate = g_templateassembler->CreateNewBlock(script, fSupportsSegwit, false);
+        else
+            pblocktemplate = BlockAssembler(GetParams()).CreateNewBlock(script, fSupportsSegwit, false);
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
+        hashTemplate = GetTemplateId(pblocktemplate->block);
+        AddTemplateToHistory(hashTemplate, pblocktemplate->block);
+
         // Need to update only after we know CreateNewBlock succeeded
         pindexPrev = pindexPrevNew;
     }
@@ -693,6 +820,15 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
+    // Send only the changes if the client has a recent template on the same block
+    const CTemplateTransactions* pbase = nullptr;
+    if (!hashBaseTemplate.IsNull()) {
+        pbase = FindTemplateInHistory(hashBaseTemplate, pblock->hashPrevBlock);
+        // A template assembled from scratch may order the transactions differently
+        if (pbase && !IsDeltaOfTemplate(*pblock, *pbase))
+            pbase = nullptr;
+    }
+
     UniValue transactions(UniValue::VARR);
     std::map<uint256, int64_t> setTxIndex;
     int i = 0;
@@ -703,6 +839,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
 
         if (tx.IsCoinBase())
             continue;
+        if (pbase && pbase->setTxids.count(txHash))
+            continue;
 
         UniValue entry(UniValue::VOBJ);
 
@@ -713,8 +851,12 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         UniValue deps(UniValue::VARR);
         for (const CTxIn &in : tx.vin)
         {
-            if (setTxIndex.count(in.prevout.hash))
-                deps.push_back(setTxIndex[in.prevout.hash]);
+            if (setTxIndex.count(in.prevout.hash)) {
+                if (pbase)
+                    deps.push_back(in.prevout.hash.GetHex());
+                else
+                    deps.push_back(setTxIndex[in.prevout.hash]);
+            }
         }
         entry.push_back(Pair("depends", deps));
 
@@ -830,6 +972,16 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     result.push_back(Pair("curtime", pblock->GetBlockTime()));
     result.push_back(Pair("bits", strprintf("%08x", pblock->nBits)));
     result.push_back(Pair("height", (int64_t)(pindexPrev->nHeight+1)));
+    result.push_back(Pair("templateid", hashTemplate.GetHex()));
+    if (pbase) {
+        UniValue removed(UniValue::VARR);
+        for (const uint256& txid : pbase->setTxids) {
+            if (!setTxIndex.count(txid))
+                removed.push_back(txid.GetHex());
+        }
+        result.push_back(Pair("basetemplateid", pbase->hashTemplate.GetHex()));
+        result.push_back(Pair("removed", removed));
+    }
 
     if (!pblocktemplate->vchCoinbaseCommitment.empty() && fSupportsSegwit) {
         result.push_back(Pair("default_witness_commitment", HexStr(pblocktemplate->vchCoinbaseCommitment.begin(), pblocktemplate->vchCoinbaseCommitment.end())));
@@ -937,15 +1089,12 @@ static UniValue getkawpowhash(const JSONRPCRequest& request) {
         fCheckTarget = true;
     }
 
-    static ethash::epoch_context_ptr context{nullptr, nullptr};
-
-    // Get the context from the block height
+    // Get the shared context from the block height
     const auto epoch_number = ethash::get_epoch_number(nHeight);
-    if (!context || context->epoch_number != epoch_number)
-        context = ethash::create_epoch_context(epoch_number);
+    const auto& context = ethash::get_global_epoch_context(epoch_number);
 
     // ProgPow hash
-    const auto result = progpow::hash(*context, nHeight, header_hash, nNonce);
+    const auto result = progpow::hash(context, nHeight, header_hash, nNonce);
 
     uint256 mined_mix_hash = uint256S(to_hex(result.mix_hash));
     uint256 mined_final_hash = uint256S(to_hex(result.final_hash));
@@ -1017,15 +1166,12 @@ static UniValue getmeowpowhash(const JSONRPCRequest& request) {
         fCheckTarget = true;
     }
 
-    static ethash::epoch_context_ptr context{nullptr, nullptr};
-
-    // Get the context from the block height
+    // Get the shared context from the block height
     const auto epoch_number = ethash::get_epoch_number(nHeight);
-    if (!context || context->epoch_number != epoch_number)
-        context = ethash::create_epoch_context(epoch_number);
+    const auto& context = ethash::get_global_epoch_context(epoch_number);
 
     // MeowPow hash
-    const auto result = meowpow::hash(*context, nHeight, header_hash, nNonce);
+    const auto result = meowpow::hash(context, nHeight, header_hash, nNonce);
 
     uint256 mined_mix_hash = uint256S(to_hex(result.mix_hash));
     uint256 mined_final_hash = uint256S(to_hex(result.final_hash));
@@ -1456,6 +1602,7 @@ UniValue setgenerate(const JSONRPCRequest& request)
             "\nSet 'generate' true or false to turn generation on or off.\n"
             "Generation is limited to 'genproclimit' processors, -1 is unlimited.\n"
             "See the getgenerate call for the current setting.\n"
+            "On regtest each thread stops once it has found a block.\n"
             "\nArguments:\n"
             "1. generate         (boolean, required) Set to true to turn on generation, false to turn off.\n"
             "2. genproclimit     (numeric, optional) Set the processor limit for when generation is on. Can be -1 for unlimited.\n"
@@ -1470,10 +1617,6 @@ UniValue setgenerate(const JSONRPCRequest& request)
             + HelpExampleRpc("setgenerate", "true, 1")
         );
 
-    if (GetParams().MineBlocksOnDemand())
-        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Use the generate method instead of setgenerate on this network");
-
-
     bool fGenerate = true;
     if (request.params.size() > 0)
         fGenerate = request.params[0].get_bool();
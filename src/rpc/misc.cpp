@@ -11,10 +11,15 @@
 #include "init.h"
 #include "validation.h"
 #include "httpserver.h"
+#include "index/address.h"
+#include "index/addresssummary.h"
+#include "index/spent.h"
+#include "index/timestamp.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpc/blockchain.h"
 #include "rpc/server.h"
+#include "streams.h"
 #include "timedata.h"
 #include "txmempool.h"
 #include "util.h"
@@ -710,6 +715,104 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+static CAddressIndex& GetAddressIndexOrThrow()
+{
+    if (!fAddressIndex || !g_addressindex)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    return *g_addressindex;
+}
+
+/** Page size of an address index query from "limit", or 0 to return everything at once */
+static int GetAddressPageLimit(const UniValue& params)
+{
+    if (!params[0].isObject())
+        return 0;
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (limitValue.isNull())
+        return 0;
+    int limit = limitValue.get_int();
+    if (limit <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+    return limit;
+}
+
+/** The "cursor" of a page: the position of the address and the last key returned for it */
+template <typename Key>
+static std::string EncodeAddressCursor(uint32_t nAddress, const Key& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << nAddress << key;
+    return HexStr(ss.begin(), ss.end());
+}
+
+/** Read the "cursor" handed out with the previous page, if given, checking it belongs to addresses */
+template <typename Key>
+static bool DecodeAddressCursor(const UniValue& params, const std::vector<std::pair<uint160, int> >& addresses,
+                                uint32_t& nAddress, Key& key)
+{
+    if (!params[0].isObject())
+        return false;
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (cursorValue.isNull())
+        return false;
+    if (!cursorValue.isStr() || !IsHex(cursorValue.get_str()))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    CDataStream ss(ParseHex(cursorValue.get_str()), SER_DISK, CLIENT_VERSION);
+    try {
+        ss >> nAddress >> key;
+    } catch (const std::exception&) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    if (!ss.empty() || nAddress >= addresses.size() ||
+            addresses[nAddress].first != key.hashBytes || addresses[nAddress].second != (int)key.type)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not match the addresses");
+    return true;
+}
+
+static UniValue AddressDeltaToJSON(const CAddressIndexKey& key, CAmount nValue)
+{
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.push_back(Pair("assetName", key.asset));
+    delta.push_back(Pair("satoshis", nValue));
+    delta.push_back(Pair("txid", key.txhash.GetHex()));
+    delta.push_back(Pair("index", (int)key.index));
+    delta.push_back(Pair("blockindex", (int)key.txindex));
+    delta.push_back(Pair("height", key.blockHeight));
+    delta.push_back(Pair("address", address));
+    return delta;
+}
+
+static UniValue AddressUtxoToJSON(const CAddressUnspentKey& key, const CAddressUnspentValue& value, const std::string& assetName)
+{
+    UniValue output(UniValue::VOBJ);
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    std::string assetNameOut = "MEWC";
+    if (assetName != "MEWC") {
+        CAmount _amount;
+        if (!GetAssetInfoFromScript(value.script, assetNameOut, _amount)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't decode asset script");
+        }
+    }
+
+    output.push_back(Pair("address", address));
+    output.push_back(Pair("assetName", assetNameOut));
+    output.push_back(Pair("txid", key.txhash.GetHex()));
+    output.push_back(Pair("outputIndex", (int)key.index));
+    output.push_back(Pair("script", HexStr(value.script.begin(), value.script.end())));
+    output.push_back(Pair("satoshis", value.satoshis));
+    output.push_back(Pair("height", value.blockHeight));
+    return output;
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 2)
@@ -816,6 +919,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    ],\n"
             "  \"chainInfo\",  (boolean, optional, default false) Include chain info with results\n"
             "  \"assetName\"   (string, optional) Get UTXOs for a particular asset instead of MEWC ('*' for all assets).\n"
+            "  \"limit\"       (number, optional) Return at most this many UTXOs, in index order rather than by height, with a cursor for the next page\n"
+            "  \"cursor\"      (string, optional) The cursor returned with the previous page\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -829,6 +934,11 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit)\n"
+            "{\n"
+            "  \"utxos\": [...]  (array) The UTXOs as above\n"
+            "  \"cursor\"        (string) Pass this to get the next page, null after the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -857,52 +967,69 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (assetName == "*") {
-            if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressUnspent((*it).first, (*it).second, assetName, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-    }
-
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    EnsureIndexSynced(g_addressindex.get());
 
     UniValue utxos(UniValue::VARR);
-
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
-        UniValue output(UniValue::VOBJ);
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    UniValue cursor(UniValue::VNULL);
+    int limit = GetAddressPageLimit(request.params);
+
+    if (limit > 0) {
+        // Stream one page straight from the index, so memory does not grow with the address history
+        CAddressIndex& addressindex = GetAddressIndexOrThrow();
+        uint32_t nAddress = 0;
+        CAddressUnspentKey keyAfter;
+        bool fAfter = DecodeAddressCursor(request.params, addresses, nAddress, keyAfter);
+        uint32_t nLastAddress = 0;
+        CAddressUnspentKey keyLast;
+        for (; nAddress < addresses.size() && cursor.isNull(); nAddress++) {
+            // '*' lists every asset but MEWC
+            bool fAllAssets = assetName == "*";
+            if (!addressindex.ForEachAddressUnspent(addresses[nAddress].first, addresses[nAddress].second, fAllAssets ? "" : assetName,
+                fAfter ? &keyAfter : nullptr,
+                [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+                    if (fAllAssets && key.asset == MEWC)
+                        return true;
+                    if ((int)utxos.size() == limit) {
+                        cursor = EncodeAddressCursor(nLastAddress, keyLast);
+                        return false;
+                    }
+                    utxos.push_back(AddressUtxoToJSON(key, value, assetName));
+                    nLastAddress = nAddress;
+                    keyLast = key;
+                    return true;
+                }))
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            fAfter = false;
         }
+    } else {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-        std::string assetNameOut = "MEWC";
-        if (assetName != "MEWC") {
-            CAmount _amount;
-            if (!GetAssetInfoFromScript(it->second.script, assetNameOut, _amount)) {
-                throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't decode asset script");
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (assetName == "*") {
+                if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressUnspent((*it).first, (*it).second, assetName, unspentOutputs)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
 
-        output.push_back(Pair("address", address));
-        output.push_back(Pair("assetName", assetNameOut));
-        output.push_back(Pair("txid", it->first.txhash.GetHex()));
-        output.push_back(Pair("outputIndex", (int)it->first.index));
-        output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
-        output.push_back(Pair("satoshis", it->second.satoshis));
-        output.push_back(Pair("height", it->second.blockHeight));
-        utxos.push_back(output);
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
+            utxos.push_back(AddressUtxoToJSON(it->first, it->second, assetName));
+        }
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || limit > 0) {
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("utxos", utxos));
+        if (limit > 0)
+            result.push_back(Pair("cursor", cursor));
+        if (!includeChainInfo)
+            return result;
 
         LOCK(cs_main);
         result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
@@ -930,6 +1057,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
             "  \"assetName\"   (string, optional) Get deltas for a particular asset instead of MEWC.\n"
+            "  \"limit\"       (number, optional) Return at most this many deltas, in an object with a cursor for the next page\n"
+            "  \"cursor\"      (string, optional) The cursor returned with the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -987,37 +1116,53 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    EnsureIndexSynced(g_addressindex.get());
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex)) {
+    UniValue deltas(UniValue::VARR);
+    UniValue cursor(UniValue::VNULL);
+    int limit = GetAddressPageLimit(request.params);
+
+    if (limit > 0) {
+        CAddressIndex& addressindex = GetAddressIndexOrThrow();
+        uint32_t nAddress = 0;
+        CAddressIndexKey keyAfter;
+        bool fAfter = DecodeAddressCursor(request.params, addresses, nAddress, keyAfter);
+        uint32_t nLastAddress = 0;
+        CAddressIndexKey keyLast;
+        for (; nAddress < addresses.size() && cursor.isNull(); nAddress++) {
+            if (!addressindex.ForEachAddressIndex(addresses[nAddress].first, addresses[nAddress].second, assetName, start, end,
+                fAfter ? &keyAfter : nullptr,
+                [&](const CAddressIndexKey& key, CAmount nValue) {
+                    if ((int)deltas.size() == limit) {
+                        cursor = EncodeAddressCursor(nLastAddress, keyLast);
+                        return false;
+                    }
+                    deltas.push_back(AddressDeltaToJSON(key, nValue));
+                    nLastAddress = nAddress;
+                    keyLast = key;
+                    return true;
+                }))
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+            fAfter = false;
         }
-    }
-
-    UniValue deltas(UniValue::VARR);
+    } else {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            }
         }
 
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("assetName", it->first.asset));
-        delta.push_back(Pair("satoshis", it->second));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("blockindex", (int)it->first.txindex));
-        delta.push_back(Pair("height", it->first.blockHeight));
-        delta.push_back(Pair("address", address));
-        deltas.push_back(delta);
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+            deltas.push_back(AddressDeltaToJSON(it->first, it->second));
+        }
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1044,7 +1189,13 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         result.push_back(Pair("deltas", deltas));
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
+        if (limit > 0)
+            result.push_back(Pair("cursor", cursor));
 
+        return result;
+    } else if (limit > 0) {
+        result.push_back(Pair("deltas", deltas));
+        result.push_back(Pair("cursor", cursor));
         return result;
     } else {
         return deltas;
@@ -1071,6 +1222,9 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "{\n"
             "  \"balance\"  (string) The current balance in satoshis\n"
             "  \"received\"  (string) The total number of satoshis received (including change)\n"
+            "  \"txcount\"  (number) The number of transactions to or from the address (only with -addresssummaryindex, for a single address)\n"
+            "  \"firstheight\"  (number) The height the addresses were first used at (only with -addresssummaryindex)\n"
+            "  \"lastheight\"  (number) The height the addresses were last used at (only with -addresssummaryindex)\n"
             "}\n"
             "OR\n"
             "[\n"
@@ -1078,6 +1232,7 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "    \"assetName\"  (string) The asset associated with the balance (MEWC for Meowcoin)\n"
             "    \"balance\"  (string) The current balance in satoshis\n"
             "    \"received\"  (string) The total number of satoshis received (including change)\n"
+            "    \"txcount\", \"firstheight\", \"lastheight\"  As above, for the asset\n"
             "  },...\n"
             "\n]"
             "\nExamples:\n"
@@ -1098,31 +1253,87 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         includeAssets = request.params[1].get_bool();
     }
 
-    if (includeAssets) {
-        if (!AreAssetsDeployed())
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
+    if (includeAssets && !AreAssetsDeployed())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
 
-        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    if (g_addresssummaryindex) {
+        // One lookup per address and asset, however long the history
+        EnsureIndexSynced(g_addresssummaryindex.get());
 
+        std::map<std::string, CAddressSummary> totals;
         for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            std::vector<std::pair<CAddressSummaryKey, CAddressSummary> > summaries;
+            if (includeAssets) {
+                if (!g_addresssummaryindex->ReadAddressSummaries((*it).first, (*it).second, summaries))
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            } else {
+                CAddressSummaryKey key((*it).second, (*it).first, MEWC);
+                CAddressSummary summary;
+                if (!g_addresssummaryindex->ReadAddressSummary(key, summary))
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                summaries.emplace_back(key, summary);
             }
+            for (const auto& summary : summaries) {
+                if (summary.second.IsNull())
+                    continue;
+                CAddressSummary& total = totals[summary.first.asset];
+                total.firstHeight = total.IsNull() ? summary.second.firstHeight : std::min(total.firstHeight, summary.second.firstHeight);
+                total.lastHeight = std::max(total.lastHeight, summary.second.lastHeight);
+                total.balance += summary.second.balance;
+                total.received += summary.second.received;
+                total.txCount += summary.second.txCount;
+            }
+        }
+
+        // A transaction touching several of the addresses is counted once for each of them,
+        // so the sum of their counts is not a number of transactions
+        const bool fTxCount = addresses.size() == 1;
+        auto summaryToJSON = [fTxCount](const CAddressSummary& total, UniValue& entry) {
+            entry.push_back(Pair("balance", total.balance));
+            entry.push_back(Pair("received", total.received));
+            if (fTxCount)
+                entry.push_back(Pair("txcount", total.txCount));
+            entry.push_back(Pair("firstheight", total.firstHeight));
+            entry.push_back(Pair("lastheight", total.lastHeight));
+        };
+
+        if (!includeAssets) {
+            UniValue result(UniValue::VOBJ);
+            summaryToJSON(totals[MEWC], result);
+            return result;
         }
 
+        UniValue result(UniValue::VARR);
+        for (const auto& total : totals) {
+            UniValue balance(UniValue::VOBJ);
+            balance.push_back(Pair("assetName", total.first));
+            summaryToJSON(total.second, balance);
+            result.push_back(balance);
+        }
+        return result;
+    }
+
+    EnsureIndexSynced(g_addressindex.get());
+
+    if (includeAssets) {
+
+        CAddressIndex& addressindex = GetAddressIndexOrThrow();
+
         //assetName -> (received, balance)
         std::map<std::string, std::pair<CAmount, CAmount>> balances;
 
-        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin();
-             it != addressIndex.end(); it++) {
-            std::string assetName = it->first.asset;
-            if (balances.count(assetName) == 0) {
-                balances[assetName] = std::make_pair(0, 0);
-            }
-            if (it->second > 0) {
-                balances[assetName].first += it->second;
-            }
-            balances[assetName].second += it->second;
+        // Sum while reading the index rather than loading the history of the addresses first
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!addressindex.ForEachAddressIndex((*it).first, (*it).second, "", 0, 0, nullptr,
+                [&](const CAddressIndexKey& key, CAmount nValue) {
+                    std::pair<CAmount, CAmount>& balance = balances[key.asset];
+                    if (nValue > 0) {
+                        balance.first += nValue;
+                    }
+                    balance.second += nValue;
+                    return true;
+                }))
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
 
         UniValue result(UniValue::VARR);
@@ -1139,23 +1350,21 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         return result;
 
     } else {
-        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, MEWC, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
+        CAddressIndex& addressindex = GetAddressIndexOrThrow();
 
         CAmount balance = 0;
         CAmount received = 0;
 
-        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin();
-             it != addressIndex.end(); it++) {
-            if (it->second > 0) {
-                received += it->second;
-            }
-            balance += it->second;
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!addressindex.ForEachAddressIndex((*it).first, (*it).second, MEWC, 0, 0, nullptr,
+                [&](const CAddressIndexKey& key, CAmount nValue) {
+                    if (nValue > 0) {
+                        received += nValue;
+                    }
+                    balance += nValue;
+                    return true;
+                }))
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
 
         UniValue result(UniValue::VOBJ);
@@ -1182,6 +1391,9 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number, optional) The start block height\n"
             "  \"end\" (number, optional) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many txids, in index order, with a cursor for the next page.\n"
+            "            A txid may show up again on a later page for another address or asset\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "},\n"
             "\"includeAssets\" (boolean, optional, default false)  If true this will return an expanded result which includes asset transactions\n"
             "\nResult:\n"
@@ -1189,6 +1401,11 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"txids\": [...]  (array) The transaction ids as above\n"
+            "  \"cursor\"        (string) Pass this to get the next page, null after the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -1202,6 +1419,8 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    EnsureIndexSynced(g_addressindex.get());
+
     int start = 0;
     int end = 0;
     if (request.params[0].isObject()) {
@@ -1222,6 +1441,47 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         if (!AreAssetsDeployed())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
 
+    int limit = GetAddressPageLimit(request.params);
+    if (limit > 0) {
+        CAddressIndex& addressindex = GetAddressIndexOrThrow();
+        uint32_t nAddress = 0;
+        CAddressIndexKey keyAfter;
+        bool fAfter = DecodeAddressCursor(request.params, addresses, nAddress, keyAfter);
+        uint32_t nLastAddress = 0;
+        CAddressIndexKey keyLast;
+        bool fLast = false;
+        UniValue txidsPage(UniValue::VARR);
+        UniValue cursor(UniValue::VNULL);
+        for (; nAddress < addresses.size() && cursor.isNull(); nAddress++) {
+            fLast = false;
+            if (!addressindex.ForEachAddressIndex(addresses[nAddress].first, addresses[nAddress].second, includeAssets ? "" : MEWC,
+                start, end, fAfter ? &keyAfter : nullptr,
+                [&](const CAddressIndexKey& key, CAmount nValue) {
+                    // The entries of a transaction are next to each other, and a page never ends inside them
+                    if (fLast && key.txhash == keyLast.txhash && key.asset == keyLast.asset) {
+                        keyLast = key;
+                        return true;
+                    }
+                    if ((int)txidsPage.size() == limit) {
+                        cursor = EncodeAddressCursor(nLastAddress, keyLast);
+                        return false;
+                    }
+                    txidsPage.push_back(key.txhash.GetHex());
+                    nLastAddress = nAddress;
+                    keyLast = key;
+                    fLast = true;
+                    return true;
+                }))
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            fAfter = false;
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("txids", txidsPage));
+        result.push_back(Pair("cursor", cursor));
+        return result;
+    }
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -1308,6 +1568,13 @@ UniValue getindexinfo(const JSONRPCRequest& request)
         index.push_back(Pair("best_block_height", enabled ? (int)chainActive.Height() : 0));
         return index;
     };
+    // Summary of an index with a database and thread of its own
+    auto createBaseIndexSummary = [&](const CBaseIndex* index) -> UniValue {
+        UniValue summary(UniValue::VOBJ);
+        summary.push_back(Pair("synced", index != nullptr && index->IsSynced()));
+        summary.push_back(Pair("best_block_height", index ? index->GetBestHeight() : 0));
+        return summary;
+    };
 
     // Check if we should include txindex
     if (index_name.empty() || index_name == "txindex") {
@@ -1316,7 +1583,7 @@ UniValue getindexinfo(const JSONRPCRequest& request)
 
     // Check if we should include addressindex
     if (index_name.empty() || index_name == "addressindex") {
-        result.push_back(Pair("addressindex", createIndexSummary("addressindex", fAddressIndex)));
+        result.push_back(Pair("addressindex", createBaseIndexSummary(g_addressindex.get())));
     }
 
     // Check if we should include assetindex
@@ -1324,14 +1591,19 @@ UniValue getindexinfo(const JSONRPCRequest& request)
         result.push_back(Pair("assetindex", createIndexSummary("assetindex", fAssetIndex)));
     }
 
+    // Check if we should include addresssummaryindex
+    if (index_name.empty() || index_name == "addresssummaryindex") {
+        result.push_back(Pair("addresssummaryindex", createBaseIndexSummary(g_addresssummaryindex.get())));
+    }
+
     // Check if we should include timestampindex
     if (index_name.empty() || index_name == "timestampindex") {
-        result.push_back(Pair("timestampindex", createIndexSummary("timestampindex", fTimestampIndex)));
+        result.push_back(Pair("timestampindex", createBaseIndexSummary(g_timestampindex.get())));
     }
 
     // Check if we should include spentindex
     if (index_name.empty() || index_name == "spentindex") {
-        result.push_back(Pair("spentindex", createIndexSummary("spentindex", fSpentIndex)));
+        result.push_back(Pair("spentindex", createBaseIndexSummary(g_spentindex.get())));
     }
 
     return result;
@@ -1370,6 +1642,8 @@ UniValue getspentinfo(const JSONRPCRequest& request)
     uint256 txid = ParseHashV(txidValue, "txid");
     int outputIndex = indexValue.get_int();
 
+    EnsureIndexSynced(g_spentindex.get());
+
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
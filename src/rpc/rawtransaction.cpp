@@ -9,6 +9,7 @@
 #include "coins.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "index/spent.h"
 #include "init.h"
 #include "keystore.h"
 #include "validation.h"
@@ -17,6 +18,7 @@
 #include "policy/policy.h"
 #include "policy/rbf.h"
 #include "primitives/transaction.h"
+#include "rpc/blockchain.h"
 #include "rpc/safemode.h"
 #include "rpc/server.h"
 #include "script/script.h"
@@ -36,7 +38,7 @@
 #include <univalue.h>
 #include <tinyformat.h>
 
-void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool expanded = false)
+void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool expanded = false, bool fSpentInfo = true)
 {
     // Call into TxToUniv() in meowcoin-common to decode the transaction hex.
     //
@@ -57,7 +59,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry,
                 // Add address and value info if spentindex enabled
                 CSpentIndexValue spentInfo;
                 CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
-                if (GetSpentIndex(spentKey, spentInfo)) {
+                if (fSpentInfo && GetSpentIndex(spentKey, spentInfo)) {
                     in.pushKV("value", ValueFromAmount(spentInfo.satoshis));
                     in.pushKV("valueSat", spentInfo.satoshis);
                     if (spentInfo.addressType == 1) {
@@ -80,7 +82,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry,
             // Add spent information if spentindex is enabled
             CSpentIndexValue spentInfo;
             CSpentIndexKey spentKey(txid, i);
-            if (GetSpentIndex(spentKey, spentInfo)) {
+            if (fSpentInfo && GetSpentIndex(spentKey, spentInfo)) {
                 out.pushKV("spentTxId", spentInfo.txid.GetHex());
                 out.pushKV("spentIndex", (int)spentInfo.inputIndex);
                 out.pushKV("spentHeight", spentInfo.blockHeight);
@@ -183,8 +185,6 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             + HelpExampleRpc("getrawtransaction", "\"mytxid\", true")
         );
 
-    LOCK(cs_main);
-
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
     // Accept either a bool (true) or a num (>=1) to indicate verbose output.
@@ -205,6 +205,13 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
         }
     }
 
+    // The verbose output includes spent index data, which is written by its
+    // own thread; must not hold cs_main here. While the index is catching up
+    // the spent fields are left out rather than taken from a partial index.
+    bool fSpentInfo = fVerbose && WaitForIndexIfSynced(g_spentindex.get());
+
+    LOCK(cs_main);
+
     CTransactionRef tx;
 
     uint256 hashBlock;
@@ -217,7 +224,7 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
         return EncodeHexTx(*tx, RPCSerializationFlags());
 
     UniValue result(UniValue::VOBJ);
-    TxToJSON(*tx, hashBlock, result, true);
+    TxToJSON(*tx, hashBlock, result, true, fSpentInfo);
 
     return result;
 }
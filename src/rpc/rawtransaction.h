@@ -17,6 +17,6 @@ UniValue SignTransaction(CMutableTransaction& mtx, const UniValue& prevTxs, CBas
 /** Create a transaction from univalue parameters */
 CMutableTransaction ConstructTransaction(const UniValue& inputs_in, const UniValue& outputs_in, const UniValue& locktime, const UniValue& rbf);
 
-void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool expanded = false);
+void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry, bool expanded = false, bool fSpentInfo = true);
 
 #endif // BITCOIN_RPC_RAWTRANSACTION_H
\ No newline at end of file
@@ -0,0 +1,184 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coins.h"
+#include "index/addresssummary.h"
+#include "primitives/block.h"
+#include "script/standard.h"
+#include "undo.h"
+#include "validation.h"
+#include "test/test_meowcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Drives the block callbacks of the index directly, without a chain */
+class TestAddressSummaryIndex : public CAddressSummaryIndex
+{
+public:
+    TestAddressSummaryIndex() : CAddressSummaryIndex(1 << 20, true, true) {}
+
+    bool Connect(const CBlock& block, const CBlockUndo& blockundo, int nHeight)
+    {
+        CDBBatch batch(*db);
+        if (!WriteBlock(batch, block, blockundo, {block.GetHash(), nHeight, false}))
+            return false;
+        return db->WriteBatch(batch);
+    }
+
+    bool Disconnect(const CBlock& block, const CBlockUndo& blockundo, int nHeight)
+    {
+        CDBBatch batch(*db);
+        if (!EraseBlock(batch, block, blockundo, {block.GetHash(), nHeight, false}))
+            return false;
+        return db->WriteBatch(batch);
+    }
+};
+
+CScript ScriptFor(const uint160& hash)
+{
+    return GetScriptForDestination(CKeyID(hash));
+}
+
+/** A block paying nAmount to hashTo, spending prevout if it is not null */
+void MakeBlock(CBlock& block, CBlockUndo& blockundo, int nHeight, const uint160& hashTo, CAmount nAmount, const Coin* prevout = nullptr)
+{
+    block = CBlock();
+    blockundo = CBlockUndo();
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    coinbase.vout.emplace_back(nAmount, ScriptFor(hashTo));
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    if (prevout) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        tx.vout.emplace_back(prevout->out.nValue, ScriptFor(hashTo));
+        block.vtx.push_back(MakeTransactionRef(tx));
+        blockundo.vtxundo.resize(1);
+        blockundo.vtxundo[0].vprevout.push_back(*prevout);
+    }
+    block.nNonce = nHeight;
+}
+
+uint160 RandomHash()
+{
+    const uint256 rand = InsecureRand256();
+    return uint160(std::vector<unsigned char>(rand.begin(), rand.begin() + 20));
+}
+
+CAddressSummary ReadSummary(TestAddressSummaryIndex& index, const uint160& hash)
+{
+    CAddressSummary summary;
+    BOOST_CHECK(index.ReadAddressSummary(CAddressSummaryKey(1, hash, MEWC), summary));
+    return summary;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(addresssummaryindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(addresssummaryindex_write_erase)
+{
+    TestAddressSummaryIndex index;
+    const uint160 hashA = RandomHash();
+    const uint160 hashB = RandomHash();
+    CBlock block1, block2;
+    CBlockUndo undo1, undo2;
+
+    MakeBlock(block1, undo1, 1, hashA, 50 * COIN);
+    BOOST_CHECK(index.Connect(block1, undo1, 1));
+    CAddressSummary summaryA = ReadSummary(index, hashA);
+    BOOST_CHECK_EQUAL(summaryA.balance, 50 * COIN);
+    BOOST_CHECK_EQUAL(summaryA.txCount, 1);
+    BOOST_CHECK_EQUAL(summaryA.firstHeight, 1);
+
+    // Block 2 moves the coin from A to B
+    Coin coin(block1.vtx[0]->vout[0], 1, true);
+    MakeBlock(block2, undo2, 2, hashB, 25 * COIN, &coin);
+    BOOST_CHECK(index.Connect(block2, undo2, 2));
+    summaryA = ReadSummary(index, hashA);
+    BOOST_CHECK_EQUAL(summaryA.balance, 0);
+    BOOST_CHECK_EQUAL(summaryA.received, 50 * COIN);
+    BOOST_CHECK_EQUAL(summaryA.txCount, 2);
+    BOOST_CHECK_EQUAL(summaryA.lastHeight, 2);
+    CAddressSummary summaryB = ReadSummary(index, hashB);
+    BOOST_CHECK_EQUAL(summaryB.balance, 75 * COIN);
+    BOOST_CHECK_EQUAL(summaryB.txCount, 2);
+
+    // Disconnecting it puts back what block 1 left, and forgets B entirely
+    BOOST_CHECK(index.Disconnect(block2, undo2, 2));
+    summaryA = ReadSummary(index, hashA);
+    BOOST_CHECK_EQUAL(summaryA.balance, 50 * COIN);
+    BOOST_CHECK_EQUAL(summaryA.txCount, 1);
+    BOOST_CHECK_EQUAL(summaryA.lastHeight, 1);
+    BOOST_CHECK(ReadSummary(index, hashB).IsNull());
+
+    // Its undo data is gone with it
+    BOOST_CHECK(!index.Disconnect(block2, undo2, 2));
+
+    // A different block at the same height does not pick up the undo data of block 1
+    BOOST_CHECK(!index.Disconnect(block2, undo2, 1));
+
+    BOOST_CHECK(index.Disconnect(block1, undo1, 1));
+    BOOST_CHECK(ReadSummary(index, hashA).IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(addresssummaryindex_shared_tx)
+{
+    TestAddressSummaryIndex index;
+    const uint160 hashA = RandomHash();
+    const uint160 hashB = RandomHash();
+    CBlock block1, block2;
+    CBlockUndo undo1, undo2;
+
+    // The coinbase of block 1 pays both addresses
+    MakeBlock(block1, undo1, 1, hashA, 50 * COIN);
+    CMutableTransaction coinbase(*block1.vtx[0]);
+    coinbase.vout.emplace_back(10 * COIN, ScriptFor(hashB));
+    block1.vtx[0] = MakeTransactionRef(coinbase);
+    BOOST_CHECK(index.Connect(block1, undo1, 1));
+    BOOST_CHECK_EQUAL(ReadSummary(index, hashA).txCount, 1);
+    BOOST_CHECK_EQUAL(ReadSummary(index, hashB).txCount, 1);
+
+    // Block 2 moves the coin of A to B. A sees two transactions and B three, but
+    // only three transactions touch either of them, so the counts do not add up
+    Coin coin(block1.vtx[0]->vout[0], 1, true);
+    MakeBlock(block2, undo2, 2, hashB, 25 * COIN, &coin);
+    BOOST_CHECK(index.Connect(block2, undo2, 2));
+    CAddressSummary summaryA = ReadSummary(index, hashA);
+    CAddressSummary summaryB = ReadSummary(index, hashB);
+    BOOST_CHECK_EQUAL(summaryA.txCount, 2);
+    BOOST_CHECK_EQUAL(summaryB.txCount, 3);
+    BOOST_CHECK_EQUAL(summaryA.balance + summaryB.balance, 85 * COIN);
+    BOOST_CHECK(summaryA.txCount + summaryB.txCount > 3);
+}
+
+BOOST_AUTO_TEST_CASE(addresssummaryindex_deep_undo)
+{
+    TestAddressSummaryIndex index;
+    const uint160 hash = RandomHash();
+    const int nTip = MIN_BLOCKS_TO_KEEP + 10;
+    std::vector<CBlock> blocks(nTip + 1);
+    std::vector<CBlockUndo> undos(nTip + 1);
+    for (int nHeight = 1; nHeight <= nTip; nHeight++) {
+        MakeBlock(blocks[nHeight], undos[nHeight], nHeight, hash, COIN);
+        BOOST_CHECK(index.Connect(blocks[nHeight], undos[nHeight], nHeight));
+    }
+    BOOST_CHECK_EQUAL(ReadSummary(index, hash).balance, nTip * COIN);
+
+    // A reorg deeper than MIN_BLOCKS_TO_KEEP can still be undone, down to the first block
+    for (int nHeight = nTip; nHeight > 1; nHeight--)
+        BOOST_CHECK(index.Disconnect(blocks[nHeight], undos[nHeight], nHeight));
+    CAddressSummary summary = ReadSummary(index, hash);
+    BOOST_CHECK_EQUAL(summary.balance, COIN);
+    BOOST_CHECK_EQUAL(summary.txCount, 1);
+    BOOST_CHECK_EQUAL(summary.lastHeight, 1);
+    BOOST_CHECK(index.Disconnect(blocks[1], undos[1], 1));
+    BOOST_CHECK(ReadSummary(index, hash).IsNull());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
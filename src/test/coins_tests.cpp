@@ -9,9 +9,11 @@
 #include "undo.h"
 #include "utilstrencodings.h"
 #include "test/test_meowcoin.h"
+#include "txdb.h"
 #include "validation.h"
 #include "consensus/validation.h"
 
+#include <atomic>
 #include <vector>
 #include <map>
 
@@ -855,6 +857,39 @@ BOOST_FIXTURE_TEST_SUITE(coins_tests, BasicTestingSetup)
         CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY | FRESH, DIRTY | FRESH, true);
     }
 
+    void CheckAddBaseCoin(CAmount cache_value, CAmount expected_value, char cache_flags, char expected_flags)
+    {
+        SingleEntryCacheTest test(VALUE1, cache_value, cache_flags);
+        Coin coin;
+        SetCoinsValue(VALUE1, coin);
+        test.cache.AddBaseCoin(OUTPOINT, std::move(coin));
+        test.cache.SelfTest();
+
+        CAmount result_value;
+        char result_flags;
+        GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+        BOOST_CHECK_EQUAL(result_value, expected_value);
+        BOOST_CHECK_EQUAL(result_flags, expected_flags);
+    }
+
+    BOOST_AUTO_TEST_CASE(ccoins_add_base_test)
+    {
+        BOOST_TEST_MESSAGE("Running cCoins Add Base Test");
+
+        /* Check AddBaseCoin behavior, caching the coin of the base view as a
+         * prefetch would, and checking that an existing entry is left alone.
+         *
+         *               Cache   Result  Cache        Result
+         *               Value   Value   Flags        Flags
+         */
+        CheckAddBaseCoin(ABSENT, VALUE1, NO_ENTRY, 0);
+        CheckAddBaseCoin(PRUNED, PRUNED, 0, 0);
+        CheckAddBaseCoin(PRUNED, PRUNED, DIRTY, DIRTY);
+        CheckAddBaseCoin(VALUE2, VALUE2, 0, 0);
+        CheckAddBaseCoin(VALUE2, VALUE2, DIRTY, DIRTY);
+        CheckAddBaseCoin(VALUE2, VALUE2, DIRTY | FRESH, DIRTY | FRESH);
+    }
+
     void CheckWriteCoins(CAmount parent_value, CAmount child_value, CAmount expected_value, char parent_flags, char child_flags, char expected_flags)
     {
         SingleEntryCacheTest test(ABSENT, parent_value, parent_flags);
@@ -944,4 +979,118 @@ BOOST_FIXTURE_TEST_SUITE(coins_tests, BasicTestingSetup)
                         CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
     }
 
+
+    BOOST_FIXTURE_TEST_CASE(parallel_foreachcoin_test, TestingSetup)
+    {
+        BOOST_TEST_MESSAGE("Running ParallelForEachCoin Test");
+
+        CCoinsViewDB db(1 << 20, true);
+        std::map<COutPoint, Coin> expected;
+        CUTXOStats expectedStats;
+        {
+            CCoinsViewCache cache(&db);
+            for (int i = 0; i < 3000; i++) {
+                COutPoint outpoint(InsecureRand256(), InsecureRandRange(4));
+                Coin coin(CTxOut(InsecureRandRange(1000000), CScript() << InsecureRand32()), 1 + InsecureRandRange(1000), InsecureRandBool());
+                if (expected.count(outpoint))
+                    continue;
+                expected[outpoint] = coin;
+                expectedStats.AddCoin(outpoint, coin);
+                cache.AddCoin(outpoint, std::move(coin), false);
+            }
+            cache.SetBestBlock(InsecureRand256());
+            BOOST_CHECK(cache.Flush());
+        }
+
+        // Every coin is visited exactly once, whatever the number of threads
+        for (int nThreads : {1, 3, 8}) {
+            std::vector<std::map<COutPoint, Coin> > visited(nThreads);
+            std::vector<CUTXOStats> stats(nThreads);
+            uint256 hashBlock;
+            BOOST_CHECK(ParallelForEachCoin(db, [&](int nThread, const COutPoint& outpoint, const Coin& coin) {
+                    if (nThread < 0 || nThread >= nThreads)
+                        return false;
+                    visited[nThread][outpoint] = coin;
+                    stats[nThread].AddCoin(outpoint, coin);
+                    return true;
+                }, nThreads, hashBlock));
+            BOOST_CHECK(hashBlock == db.GetBestBlock());
+
+            std::map<COutPoint, Coin> all;
+            CUTXOStats total;
+            for (int i = 0; i < nThreads; i++) {
+                all.insert(visited[i].begin(), visited[i].end());
+                total += stats[i];
+            }
+            BOOST_CHECK_EQUAL(all.size(), expected.size());
+            for (const auto& entry : expected) {
+                BOOST_CHECK(all.count(entry.first) && all[entry.first].out == entry.second.out);
+            }
+            BOOST_CHECK_EQUAL(total.nTransactionOutputs, expectedStats.nTransactionOutputs);
+            BOOST_CHECK_EQUAL(total.nTotalAmount, expectedStats.nTotalAmount);
+            BOOST_CHECK(total.GetHash() == expectedStats.GetHash());
+        }
+
+        // The visitor can stop the scan
+        std::atomic<int> nVisited(0);
+        uint256 hashBlock;
+        BOOST_CHECK(!ParallelForEachCoin(db, [&](int nThread, const COutPoint& outpoint, const Coin& coin) {
+                return ++nVisited < 10;
+            }, 4, hashBlock));
+        BOOST_CHECK(nVisited < (int)expected.size());
+    }
+
+    BOOST_FIXTURE_TEST_CASE(coins_write_behind_test, TestingSetup)
+    {
+        BOOST_TEST_MESSAGE("Running CCoinsViewDB Write-Behind Test");
+
+        CCoinsViewDB db(1 << 20, true);
+        std::map<COutPoint, Coin> expected;
+        uint256 hashBlock;
+        for (int round = 0; round < 4; round++) {
+            CCoinsViewCache cache(&db);
+            // Spend some of the coins of the previous round, and add new ones.
+            for (auto it = expected.begin(); it != expected.end();) {
+                if (InsecureRandBool()) {
+                    BOOST_CHECK(cache.SpendCoin(it->first));
+                    it = expected.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            for (int i = 0; i < 1000; i++) {
+                COutPoint outpoint(InsecureRand256(), InsecureRandRange(4));
+                Coin coin(CTxOut(InsecureRandRange(1000000), CScript() << InsecureRand32()), 1 + InsecureRandRange(1000), false);
+                expected[outpoint] = coin;
+                cache.AddCoin(outpoint, std::move(coin), false);
+            }
+            hashBlock = InsecureRand256();
+            cache.SetBestBlock(hashBlock);
+
+            db.SetWriteBehind(true);
+            BOOST_CHECK(cache.Flush());
+            db.SetWriteBehind(false);
+            BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+
+            // Whether or not the write has landed, the view shows its result.
+            BOOST_CHECK(db.GetBestBlock() == hashBlock);
+            for (const auto& entry : expected) {
+                Coin coin;
+                BOOST_CHECK(db.GetCoin(entry.first, coin) && coin.out == entry.second.out);
+            }
+        }
+
+        BOOST_CHECK(db.WaitForWrite());
+        BOOST_CHECK(db.GetBestBlock() == hashBlock);
+        BOOST_CHECK(db.GetHeadBlocks().empty());
+        size_t nCoins = 0;
+        std::unique_ptr<CCoinsViewCursor> pcursor(db.Cursor());
+        for (; pcursor->Valid(); pcursor->Next()) {
+            COutPoint outpoint;
+            BOOST_CHECK(pcursor->GetKey(outpoint) && expected.count(outpoint));
+            nCoins++;
+        }
+        BOOST_CHECK_EQUAL(nCoins, expected.size());
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
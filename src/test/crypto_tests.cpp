@@ -11,6 +11,9 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/muhash.h"
+#include "crypto/scrypt.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_meowcoin.h"
@@ -334,6 +337,51 @@ BOOST_FIXTURE_TEST_SUITE(crypto_tests, BasicTestingSetup)
         TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
     }
 
+    BOOST_AUTO_TEST_CASE(sha256d64_test)
+    {
+        BOOST_TEST_MESSAGE("Running SHA256D64 Test");
+
+        for (int i = 0; i <= 32; ++i) {
+            unsigned char in[64 * 32];
+            unsigned char out1[32 * 32], out2[32 * 32];
+            for (int j = 0; j < 64 * i; ++j) {
+                in[j] = InsecureRandBits(8);
+            }
+            for (int j = 0; j < i; ++j) {
+                CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+            }
+            SHA256D64(out2, in, i);
+            BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+            // The output may be computed in place.
+            SHA256D64(in, in, i);
+            BOOST_CHECK(memcmp(out1, in, 32 * i) == 0);
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(scrypt_batch_test)
+    {
+        BOOST_TEST_MESSAGE("Running scrypt batch Test");
+
+        // A Litecoin block header and its proof of work hash.
+        std::vector<unsigned char> header = ParseHex("020000004c1271c211717198227392b029a64a7971931d351b387bb80db027f270411e398a07046f7d4a08dd815412a8712f874a7ebf0507e3878bd24e20a3b73fd750a667d2f451eac7471b00de6659");
+        uint256 hash;
+        scrypt_1024_1_1_256((const char*)header.data(), BEGIN(hash));
+        BOOST_CHECK_EQUAL(hash.GetHex(), "00000000002bef4107f882f6115e0b01f348d21195dacd3582aa2dabd7985806");
+
+        // Every count exercises a different mix of the 4-way, 2-way and single kernels.
+        for (int count = 0; count <= 2 * SCRYPT_BATCH_MAX_WAYS + 1; ++count) {
+            std::vector<char> in(80 * count), out(32 * count), expected(32 * count);
+            for (char& c : in) {
+                c = InsecureRandBits(8);
+            }
+            for (int i = 0; i < count; ++i) {
+                scrypt_1024_1_1_256(&in[80 * i], &expected[32 * i]);
+            }
+            scrypt_1024_1_1_256_batch(in.data(), out.data(), count);
+            BOOST_CHECK(out == expected);
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(sha512_testvectors_test)
     {
         BOOST_TEST_MESSAGE("Running sha512 TestVectors Test");
@@ -565,6 +613,63 @@ BOOST_FIXTURE_TEST_SUITE(crypto_tests, BasicTestingSetup)
                      "fab78c9");
     }
 
+    static MuHash3072 FromInt(unsigned char i)
+    {
+        unsigned char tmp[32] = {i, 0};
+        return MuHash3072().Insert(tmp, sizeof(tmp));
+    }
+
+    static uint256 MuHashFinalize(MuHash3072 acc)
+    {
+        uint256 out;
+        acc.Finalize(out.begin());
+        return out;
+    }
+
+    BOOST_AUTO_TEST_CASE(muhash_tests)
+    {
+        BOOST_TEST_MESSAGE("Running MuHash3072 Test");
+
+        // Test vector shared with other MuHash3072 implementations
+        MuHash3072 acc = FromInt(0);
+        acc *= FromInt(1);
+        acc /= FromInt(2);
+        BOOST_CHECK_EQUAL(MuHashFinalize(acc).GetHex(), "10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863");
+
+        // The hash only depends on the multiset, not on the order of operations
+        MuHash3072 a, b;
+        std::vector<unsigned char> elements[4];
+        for (int i = 0; i < 4; ++i) {
+            elements[i].assign(33 + i, (unsigned char)(i * 37 + 1));
+        }
+        a.Insert(elements[0].data(), elements[0].size()).Insert(elements[1].data(), elements[1].size());
+        a.Insert(elements[2].data(), elements[2].size()).Remove(elements[3].data(), elements[3].size());
+        b.Remove(elements[3].data(), elements[3].size()).Insert(elements[2].data(), elements[2].size());
+        b.Insert(elements[1].data(), elements[1].size()).Insert(elements[0].data(), elements[0].size());
+        BOOST_CHECK(MuHashFinalize(a) == MuHashFinalize(b));
+
+        // Removing what was inserted gives the empty set
+        MuHash3072 empty;
+        b.Remove(elements[0].data(), elements[0].size()).Remove(elements[1].data(), elements[1].size());
+        b.Remove(elements[2].data(), elements[2].size()).Insert(elements[3].data(), elements[3].size());
+        BOOST_CHECK(MuHashFinalize(b) == MuHashFinalize(empty));
+
+        // Combining sets, and removing a whole set at once
+        MuHash3072 c = FromInt(5);
+        c *= FromInt(7);
+        BOOST_CHECK(MuHashFinalize(c) == MuHashFinalize(FromInt(7) *= FromInt(5)));
+        c /= FromInt(7);
+        BOOST_CHECK(MuHashFinalize(c) == MuHashFinalize(FromInt(5)));
+        BOOST_CHECK(MuHashFinalize(c) != MuHashFinalize(FromInt(7)));
+
+        // The saved state restores to the same hash
+        unsigned char state[MuHash3072::SERIALIZED_SIZE];
+        a.ToBytes(state);
+        MuHash3072 restored;
+        restored.FromBytes(state);
+        BOOST_CHECK(MuHashFinalize(restored) == MuHashFinalize(a));
+    }
+
     BOOST_AUTO_TEST_CASE(countbits_test)
     {
         BOOST_TEST_MESSAGE("Running CoutBits Test");
@@ -361,4 +361,72 @@ BOOST_FIXTURE_TEST_SUITE(dbwrapper_tests, BasicTestingSetup)
     }
 
 
+    BOOST_AUTO_TEST_CASE(dbwrapper_options_test)
+    {
+        std::string strError;
+        BOOST_CHECK(CheckDBOptionsArgs("testopts", strError));
+        CDBOptions dbOptions = DBOptionsFromArgs("testopts", 8 << 20, 3 << 20);
+        BOOST_CHECK(!dbOptions.fCompression);
+        BOOST_CHECK_EQUAL(dbOptions.nBloomBits, DEFAULT_DB_BLOOM_BITS);
+        BOOST_CHECK_EQUAL(dbOptions.nBlockSize, (size_t)(DEFAULT_DB_BLOCK_SIZE << 10));
+        BOOST_CHECK_EQUAL(dbOptions.nMaxFileSize, (size_t)(3 << 20));
+
+        gArgs.ForceSetArg("-testoptsdbcompression", "snappy");
+        gArgs.ForceSetArg("-testoptsdbbloombits", "0");
+        gArgs.ForceSetArg("-testoptsdbblocksize", "16");
+        gArgs.ForceSetArg("-testoptsdbwritebuffer", "1");
+        gArgs.ForceSetArg("-testoptsdbmaxfilesize", "4");
+        BOOST_CHECK(CheckDBOptionsArgs("testopts", strError));
+        dbOptions = DBOptionsFromArgs("testopts", 8 << 20, 3 << 20);
+        BOOST_CHECK_EQUAL(dbOptions.fCompression, DBCompressionAvailable());
+        BOOST_CHECK_EQUAL(dbOptions.nBloomBits, 0);
+        BOOST_CHECK_EQUAL(dbOptions.nBlockSize, (size_t)(16 << 10));
+        BOOST_CHECK_EQUAL(dbOptions.nWriteBufferSize, (size_t)(1 << 20));
+        BOOST_CHECK_EQUAL(dbOptions.nMaxFileSize, (size_t)(4 << 20));
+
+        // A database with these settings reads back what it wrote, and is
+        // listed with its settings and statistics while open.
+        {
+            fs::path ph = fs::temp_directory_path() / fs::unique_path();
+            CDBWrapper dbw(ph, dbOptions, true, false, true);
+            for (uint32_t i = 0; i < 1000; i++)
+                BOOST_CHECK(dbw.Write(i, std::string(100, 'a' + i % 26)));
+            for (uint32_t i = 0; i < 1000; i++) {
+                std::string str;
+                BOOST_CHECK(dbw.Read(i, str));
+                BOOST_CHECK(str == std::string(100, 'a' + i % 26));
+            }
+
+            int nFound = 0;
+            ForEachOpenDB([&](const CDBWrapper& db) {
+                if (db.GetDBOptions().strName != "testopts")
+                    return;
+                nFound++;
+                BOOST_CHECK(&db == &dbw);
+                std::string strValue;
+                BOOST_CHECK(db.GetProperty("leveldb.stats", strValue));
+                BOOST_CHECK(db.GetProperty("leveldb.approximate-memory-usage", strValue));
+                BOOST_CHECK(atoi64(strValue) > 0);
+            });
+            BOOST_CHECK_EQUAL(nFound, 1);
+        }
+        int nFound = 0;
+        ForEachOpenDB([&](const CDBWrapper& db) { nFound += db.GetDBOptions().strName == "testopts"; });
+        BOOST_CHECK_EQUAL(nFound, 0);
+
+        gArgs.ForceSetArg("-testoptsdbcompression", "zlib");
+        BOOST_CHECK(!CheckDBOptionsArgs("testopts", strError));
+        gArgs.ForceSetArg("-testoptsdbcompression", "none");
+        gArgs.ForceSetArg("-testoptsdbbloombits", "-1");
+        BOOST_CHECK(!CheckDBOptionsArgs("testopts", strError));
+        gArgs.ForceSetArg("-testoptsdbbloombits", "10");
+        gArgs.ForceSetArg("-testoptsdbwritebuffer", "0");
+        BOOST_CHECK(!CheckDBOptionsArgs("testopts", strError));
+        gArgs.ForceSetArg("-testoptsdbwritebuffer", "2048");
+        BOOST_CHECK(!CheckDBOptionsArgs("testopts", strError));
+        gArgs.ForceSetArg("-testoptsdbwritebuffer", "1");
+        BOOST_CHECK(CheckDBOptionsArgs("testopts", strError));
+    }
+
+
 BOOST_AUTO_TEST_SUITE_END()
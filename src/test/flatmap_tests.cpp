@@ -0,0 +1,117 @@
+// Copyright (c) 2017-2019 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flatmap.h"
+
+#include "test/test_meowcoin.h"
+
+#include <string>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flatmap_tests, BasicTestingSetup)
+
+namespace {
+
+/** Keep collisions frequent, so probing across tombstones is exercised. */
+struct SmallHasher
+{
+    size_t operator()(uint32_t key) const { return key % 37; }
+};
+
+typedef flatmap<uint32_t, std::string, SmallHasher> TestMap;
+typedef std::unordered_map<uint32_t, std::string> RealMap;
+
+void CheckEqual(const TestMap& test, const RealMap& real)
+{
+    BOOST_CHECK_EQUAL(test.size(), real.size());
+    BOOST_CHECK_EQUAL(test.empty(), real.empty());
+    size_t count = 0;
+    for (TestMap::const_iterator it = test.begin(); it != test.end(); it++) {
+        RealMap::const_iterator itReal = real.find(it->first);
+        BOOST_CHECK(itReal != real.end() && itReal->second == it->second);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, real.size());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(flatmap_random_test)
+{
+    for (int run = 0; run < 32; run++) {
+        TestMap test;
+        RealMap real;
+        const uint32_t range = 16 + InsecureRandRange(1024);
+        for (int op = 0; op < 4096; op++) {
+            const uint32_t key = InsecureRandRange(range);
+            switch (InsecureRandRange(6)) {
+            case 0: {
+                const std::string value = std::to_string(op);
+                std::pair<TestMap::iterator, bool> ret = test.emplace(key, value);
+                BOOST_CHECK_EQUAL(ret.second, real.emplace(key, value).second);
+                BOOST_CHECK(ret.first->first == key && ret.first->second == real[key]);
+                break;
+            }
+            case 1:
+                test[key] += "x";
+                real[key] += "x";
+                break;
+            case 2:
+                BOOST_CHECK_EQUAL(test.erase(key), real.erase(key));
+                break;
+            case 3: {
+                TestMap::iterator it = test.find(key);
+                BOOST_CHECK_EQUAL(it == test.end(), real.count(key) == 0);
+                BOOST_CHECK_EQUAL(test.count(key), real.count(key));
+                break;
+            }
+            case 4:
+                // Erase every other element while iterating, as BatchWrite does.
+                if (InsecureRandRange(64) == 0) {
+                    for (TestMap::iterator it = test.begin(); it != test.end();) {
+                        if (it->first % 2) {
+                            real.erase(it->first);
+                            TestMap::iterator itOld = it++;
+                            test.erase(itOld);
+                        } else {
+                            ++it;
+                        }
+                    }
+                }
+                break;
+            case 5:
+                if (InsecureRandRange(256) == 0) {
+                    test.clear();
+                    real.clear();
+                }
+                break;
+            }
+        }
+        CheckEqual(test, real);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_stable_address_test)
+{
+    flatmap<uint32_t, uint32_t, SmallHasher> map;
+    uint32_t& value = map[7];
+    value = 42;
+    for (uint32_t i = 100; i < 10000; i++) {
+        map.emplace(i, i);
+    }
+    // Growing the table moved the slots, but not the elements.
+    BOOST_CHECK(&map[7] == &value);
+    BOOST_CHECK_EQUAL(map[7], 42U);
+    BOOST_CHECK(map.bucket_memory() >= map.bucket_count() * sizeof(void*));
+    BOOST_CHECK(map.pool_memory() >= map.size() * sizeof(std::pair<const uint32_t, uint32_t>));
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK_EQUAL(map.bucket_count(), 0U);
+    BOOST_CHECK_EQUAL(map.pool_memory(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
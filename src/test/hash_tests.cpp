@@ -107,6 +107,30 @@ BOOST_FIXTURE_TEST_SUITE(hash_tests, BasicTestingSetup)
 
     };
 
+    BOOST_AUTO_TEST_CASE(hashx16r_chain_test)
+    {
+        // The last 16 nibbles of the previous block hash select every step function once.
+        const uint256 prevHash = uint256S("0123456789abcdef");
+        std::vector<unsigned char> header(80);
+        for (size_t i = 0; i < header.size(); i++) {
+            header[i] = i;
+        }
+
+        BOOST_CHECK_EQUAL(HashX16R(header.begin(), header.end(), prevHash).GetHex(), "ae8b57cee4e094302eb8e84ace08309f646c5bb002da5c29bae14d4145eaff48");
+        BOOST_CHECK_EQUAL(HashX16RV2(header.begin(), header.end(), prevHash).GetHex(), "08288f77ef8bfb7fe5c30590a54b046636eb4eaace201550d5ff0302927b841f");
+
+        // Every step function may hash its input in place.
+        for (int algo = 0; algo < 16; algo++) {
+            unsigned char in[64], out[64];
+            for (int i = 0; i < 64; i++) {
+                in[i] = algo + i;
+            }
+            HashX16RAlgo(algo, in, sizeof(in), out);
+            HashX16RAlgo(algo, in, sizeof(in), in);
+            BOOST_CHECK(memcmp(in, out, sizeof(out)) == 0);
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(siphash_test)
     {
         BOOST_TEST_MESSAGE("Running SipHash Test");
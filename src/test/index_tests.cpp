@@ -0,0 +1,273 @@
+// Copyright (c) 2017-2020 The Meowcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "coins.h"
+#include "consensus/validation.h"
+#include "index/base.h"
+#include "undo.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "test/test_meowcoin.h"
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+static const char DB_TEST_BLOCK = 'h';
+
+/** An index of the hash of each block by height, which counts its writes */
+class TestIndex : public CBaseIndex
+{
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override
+    {
+        if (block.GetHash() != info.hash || blockundo.vtxundo.size() + 1 != block.vtx.size())
+            return false;
+        batch.Write(std::make_pair(DB_TEST_BLOCK, info.nHeight), info.hash);
+        nWrites++;
+        return true;
+    }
+
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockUndo& blockundo, const BlockInfo& info) override
+    {
+        uint256 hash;
+        if (!db->Read(std::make_pair(DB_TEST_BLOCK, info.nHeight), hash) || hash != info.hash)
+            return false;
+        batch.Erase(std::make_pair(DB_TEST_BLOCK, info.nHeight));
+        return true;
+    }
+
+public:
+    std::atomic<int> nWrites;
+
+    TestIndex() : CBaseIndex("testindex", GetDataDir() / "indexes" / "test", 1 << 20, false, false), nWrites(0) {}
+
+    // The thread must be gone before WriteBlock and EraseBlock are
+    ~TestIndex() { Stop(); }
+
+    bool Lookup(int nHeight, uint256& hash) const
+    {
+        return db->Read(std::make_pair(DB_TEST_BLOCK, nHeight), hash);
+    }
+};
+
+void WaitForSync(CBaseIndex& index)
+{
+    const int64_t nTimeout = GetTime() + 60;
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(GetTime() < nTimeout);
+        MilliSleep(10);
+    }
+}
+
+/** Check that the index has exactly the blocks of the active chain */
+void CheckIndexMatchesChain(const TestIndex& index)
+{
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(index.GetBestHeight(), chainActive.Height());
+    uint256 hash;
+    for (int nHeight = 1; nHeight <= chainActive.Height(); nHeight++)
+        BOOST_CHECK(index.Lookup(nHeight, hash) && hash == chainActive[nHeight]->GetBlockHash());
+    BOOST_CHECK(!index.Lookup(chainActive.Height() + 1, hash));
+}
+
+CBlockIndex* ChainTip()
+{
+    LOCK(cs_main);
+    return chainActive.Tip();
+}
+
+CBlockIndex* ChainAt(int nHeight)
+{
+    LOCK(cs_main);
+    return chainActive[nHeight];
+}
+
+void Invalidate(CBlockIndex* pindex)
+{
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(InvalidateBlock(state, GetParams(), pindex));
+    }
+    BOOST_CHECK(ActivateBestChain(state, GetParams()));
+}
+
+void Reconsider(CBlockIndex* pindex)
+{
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(ResetBlockFailureFlags(pindex));
+    }
+    BOOST_CHECK(ActivateBestChain(state, GetParams()));
+}
+
+/**
+ * Take the tip out of the active chain and out of the block index, as if the
+ * block index had not been flushed with it before a crash. Returns the block,
+ * to be put back with RestoreBlockIndex.
+ */
+CBlockIndex* ForgetTip()
+{
+    CBlockIndex* pindex = ChainTip();
+    Invalidate(pindex);
+    LOCK(cs_main);
+    mapBlockIndex.erase(pindex->GetBlockHash());
+    return pindex;
+}
+
+void RestoreBlockIndex(CBlockIndex* pindex)
+{
+    LOCK(cs_main);
+    mapBlockIndex.emplace(pindex->GetBlockHash(), pindex);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(index_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(index_catch_up_and_follow)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    TestIndex index;
+    BOOST_CHECK_EQUAL(index.GetBestHeight(), -1);
+
+    // The index catches up with the 100 blocks from disk while more are
+    // connected, which it gets either from disk or from the notifications
+    BOOST_REQUIRE(index.Start());
+    for (int i = 0; i < 5; i++)
+        CreateAndProcessBlock({}, scriptPubKey);
+    WaitForSync(index);
+    BOOST_CHECK(index.IsSynced());
+    CheckIndexMatchesChain(index);
+    BOOST_CHECK_EQUAL(index.nWrites, 105);
+
+    // Once in sync it follows the chain block by block
+    CreateAndProcessBlock({}, scriptPubKey);
+    WaitForSync(index);
+    CheckIndexMatchesChain(index);
+    BOOST_CHECK_EQUAL(index.nWrites, 106);
+}
+
+BOOST_AUTO_TEST_CASE(index_disconnect_and_reorg)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    TestIndex index;
+    BOOST_REQUIRE(index.Start());
+    for (int i = 0; i < 3; i++)
+        CreateAndProcessBlock({}, scriptPubKey);
+    WaitForSync(index);
+    CheckIndexMatchesChain(index);
+
+    // Disconnecting blocks takes them out
+    CBlockIndex* pindexFork = ChainAt(101);
+    CBlockIndex* pindexTip = ChainTip();
+    Invalidate(pindexFork);
+    BOOST_CHECK(ChainTip() == pindexFork->pprev);
+    WaitForSync(index);
+    CheckIndexMatchesChain(index);
+
+    // A shorter fork, paying elsewhere so its blocks differ
+    for (int i = 0; i < 2; i++)
+        CreateAndProcessBlock({}, CScript() << OP_TRUE);
+    WaitForSync(index);
+    CheckIndexMatchesChain(index);
+
+    // Going back to the longer chain is a reorg of two blocks for three
+    Reconsider(pindexFork);
+    BOOST_CHECK(ChainTip() == pindexTip);
+    WaitForSync(index);
+    CheckIndexMatchesChain(index);
+}
+
+BOOST_AUTO_TEST_CASE(index_restart)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    {
+        TestIndex index;
+        BOOST_REQUIRE(index.Start());
+        WaitForSync(index);
+        CheckIndexMatchesChain(index);
+    }
+
+    // Blocks connected while the index is stopped are picked up where it left off
+    for (int i = 0; i < 3; i++)
+        CreateAndProcessBlock({}, scriptPubKey);
+    {
+        TestIndex index;
+        BOOST_REQUIRE(index.Start());
+        WaitForSync(index);
+        CheckIndexMatchesChain(index);
+        BOOST_CHECK_EQUAL(index.nWrites, 3);
+    }
+
+    // So are blocks disconnected while it is stopped
+    Invalidate(ChainTip()->pprev);
+    {
+        TestIndex index;
+        BOOST_REQUIRE(index.Start());
+        WaitForSync(index);
+        CheckIndexMatchesChain(index);
+        BOOST_CHECK_EQUAL(index.nWrites, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(index_rewind_unknown)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    {
+        TestIndex index;
+        BOOST_REQUIRE(index.Start());
+        CreateAndProcessBlock({}, scriptPubKey);
+        WaitForSync(index);
+        CheckIndexMatchesChain(index);
+    }
+
+    // The index is at a block the block index lost. The position stored when
+    // the block was written is enough to take it out again.
+    CBlockIndex* pindexLost = ForgetTip();
+    {
+        TestIndex index;
+        BOOST_REQUIRE(index.Start());
+        BOOST_CHECK_EQUAL(index.GetBestHeight(), 100);
+        WaitForSync(index);
+        CheckIndexMatchesChain(index);
+        BOOST_CHECK_EQUAL(index.nWrites, 0);
+    }
+    RestoreBlockIndex(pindexLost);
+}
+
+BOOST_AUTO_TEST_CASE(index_rewind_unknown_rebuild)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    {
+        TestIndex index;
+        BOOST_REQUIRE(index.Start());
+        CreateAndProcessBlock({}, scriptPubKey);
+        WaitForSync(index);
+
+        // Once the block index is flushed the index forgets the positions
+        FlushStateToDisk();
+        WaitForSync(index);
+        CheckIndexMatchesChain(index);
+    }
+
+    // Without them a block the block index lost cannot be taken out, so
+    // the index is rebuilt
+    CBlockIndex* pindexLost = ForgetTip();
+    {
+        TestIndex index;
+        BOOST_REQUIRE(index.Start());
+        WaitForSync(index);
+        CheckIndexMatchesChain(index);
+        BOOST_CHECK_EQUAL(index.nWrites, 100);
+    }
+    RestoreBlockIndex(pindexLost);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
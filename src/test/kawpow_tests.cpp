@@ -8,10 +8,15 @@
 #include <boost/test/unit_test.hpp>
 
 #include <crypto/ethash/lib/ethash/endianness.hpp>
+#include <crypto/ethash/lib/ethash/ethash-internal.hpp>
+#include <crypto/ethash/lib/ethash/progpow-kernel.hpp>
 #include <crypto/ethash/include/ethash/progpow.hpp>
+#include <crypto/ethash/include/ethash/meowpow.hpp>
 
 #include "crypto/ethash/helpers.hpp"
 #include "crypto/ethash/progpow_test_vectors.hpp"
+#include "hash.h"
+#include "primitives/block.h"
 
 #include <array>
 
@@ -139,4 +144,128 @@ BOOST_AUTO_TEST_CASE(kawpow_search)
     BOOST_CHECK(sr.mix_hash == r.mix_hash);
 }
 
+BOOST_AUTO_TEST_CASE(kawpow_light_cache_persisted)
+{
+    const int epoch_number = 2;
+    const int block_number = epoch_number * ethash::epoch_length + 1;
+    const auto header =
+            to_hash256("ffeeddccbbaa9988776655443322110000112233445566778899aabbccddeeff");
+    const uint64_t nonce = 0x123456789abcdef0;
+
+    const auto built = ethash::create_epoch_context(epoch_number);
+    const auto expected = progpow::hash(*built, block_number, header, nonce);
+
+    // A context wrapping an external light cache must hash identically.
+    const auto wrapped = ethash::epoch_context_ptr{
+        ethash::create_epoch_context_from_light_cache(epoch_number, built->light_cache, built->light_cache_num_items),
+        ethash_destroy_epoch_context};
+    BOOST_REQUIRE(wrapped);
+    BOOST_CHECK(to_hex(progpow::hash(*wrapped, block_number, header, nonce).final_hash) == to_hex(expected.final_hash));
+    BOOST_CHECK(!ethash::create_epoch_context_from_light_cache(epoch_number, built->light_cache, built->light_cache_num_items - 1));
+
+    fs::path dir = fs::temp_directory_path() / fs::unique_path("test_meowcoin_ethash_%%%%-%%%%");
+    fs::create_directories(dir);
+    ethash_set_light_cache_dir(dir.string().c_str());
+
+    // Building through the global context writes the cache file.
+    progpow::hash(ethash::get_global_epoch_context(epoch_number), block_number, header, nonce);
+    const fs::path cache_file = dir / "epoch-2.cache";
+    BOOST_CHECK(fs::exists(cache_file));
+    BOOST_CHECK_EQUAL(fs::file_size(cache_file), ethash::get_light_cache_size(built->light_cache_num_items) + sizeof(ethash::hash512));
+
+    // Loading maps the file instead of rebuilding.
+    auto mapped = ethash::load_light_cache(dir.string(), epoch_number);
+    BOOST_REQUIRE(mapped);
+    auto result = progpow::hash(*mapped, block_number, header, nonce);
+    BOOST_CHECK(to_hex(result.final_hash) == to_hex(expected.final_hash));
+    BOOST_CHECK(to_hex(result.mix_hash) == to_hex(expected.mix_hash));
+    mapped.reset();
+
+    // A corrupted file fails its checksum.
+    {
+        std::FILE* file = fsbridge::fopen(cache_file, "r+b");
+        BOOST_REQUIRE(file);
+        std::fseek(file, 4096, SEEK_SET);
+        const int byte = std::fgetc(file);
+        std::fseek(file, 4096, SEEK_SET);
+        std::fputc(byte ^ 0xff, file);
+        std::fclose(file);
+    }
+    BOOST_CHECK(!ethash::load_light_cache(dir.string(), epoch_number));
+    BOOST_CHECK(!ethash::load_light_cache(dir.string(), epoch_number + 1));
+
+    // Storing a later epoch prunes caches older than its previous epoch.
+    ethash::store_light_cache(dir.string(), *built);
+    BOOST_CHECK(ethash::load_light_cache(dir.string(), epoch_number));
+    const auto next = ethash::create_epoch_context(epoch_number + 2);
+    ethash::store_light_cache(dir.string(), *next);
+    BOOST_CHECK(!fs::exists(cache_file));
+    BOOST_CHECK(ethash::load_light_cache(dir.string(), epoch_number + 2));
+
+    ethash_set_light_cache_dir(nullptr);
+    fs::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(kawpow_prefetch_global_context)
+{
+    const int epoch_number = 3;
+
+    BOOST_CHECK(ethash_prefetch_global_epoch_context(epoch_number));
+    // Already cached, nothing to build.
+    BOOST_CHECK(!ethash_prefetch_global_epoch_context(epoch_number));
+
+    const auto& context = ethash::get_global_epoch_context(epoch_number);
+    BOOST_CHECK_EQUAL(context.epoch_number, epoch_number);
+    BOOST_CHECK_EQUAL(&ethash::get_global_epoch_context(epoch_number), &context);
+}
+
+BOOST_AUTO_TEST_CASE(kawpow_kernels)
+{
+    const int block_number = 30000;
+    const auto header =
+            to_hash256("ffeeddccbbaa9988776655443322110000112233445566778899aabbccddeeff");
+    const uint64_t nonce = 0x123456789abcdef0;
+
+    auto context = ethash::create_epoch_context(ethash::get_epoch_number(block_number));
+
+    // The kernel picked at startup must agree with the portable one.
+    const progpow_kernel::round_fn selected = progpow_kernel::selected_round;
+    BOOST_CHECK(progpow_kernel::self_test(selected));
+
+    for (const progpow_kernel::round_fn kernel : {progpow_kernel::round_generic, selected}) {
+        progpow_kernel::selected_round = kernel;
+        const auto result = progpow::hash(*context, block_number, header, nonce);
+        BOOST_CHECK_EQUAL(to_hex(result.mix_hash), "177b565752a375501e11b6d9d3679c2df6197b2cab3a1ba2d6b10b8c71a3d459");
+        BOOST_CHECK_EQUAL(to_hex(result.final_hash), "c824bee0418e3cfb7fae56e0d5b3b8b14ba895777feea81c70c0ba947146da69");
+    }
+    progpow_kernel::selected_round = selected;
+}
+
+BOOST_AUTO_TEST_CASE(kawpow_header_hash)
+{
+    CBlockHeader header;
+    header.nVersion.SetGenesisVersion(0x30000000);
+    header.hashPrevBlock = uint256S("000000000000a5c2bd6ab3d59b5db1a4e4c4f9d1a0ee0fd2a1bf2bf80a2d1e39");
+    header.hashMerkleRoot = uint256S("7d5c0d2a5cf1a4e0b5f9f5b7c2a1f0d3e4b6a8c9d0e1f2a3b4c5d6e7f8091a2b");
+    header.nTime = 1700000000;
+    header.nBits = 0x1b0404cb;
+    header.nHeight = 1000000;
+    header.nNonce64 = 0x123456789abcdef0;
+    header.mix_hash = uint256S("f1e2d3c4b5a697887766554433221100ffeeddccbbaa99887766554433221100");
+
+    BOOST_CHECK_EQUAL(KAWPOWHash_OnlyMix(header).GetHex(), "2f23317431fbc9e405312b1151e161c8e1761955d5129b75209f4f294ec06d8e");
+    BOOST_CHECK_EQUAL(MEOWPOWHash_OnlyMix(header).GetHex(), "e8c9a81efd34f5a433ac498cacc80974ac7a2504cf402ce551e72216a10294ff");
+
+    // The byte reversal agrees with the hex round-trip it replaced
+    BOOST_CHECK(ToHash256(header.mix_hash) == to_hash256(header.mix_hash.GetHex()));
+    BOOST_CHECK(FromHash256(ToHash256(header.mix_hash)) == header.mix_hash);
+    const auto kawpow = progpow::hash_no_verify(header.nHeight, to_hash256(header.GetKAWPOWHeaderHash().GetHex()),
+            to_hash256(header.mix_hash.GetHex()), header.nNonce64);
+    BOOST_CHECK(KAWPOWHash_OnlyMix(header) == uint256S(to_hex(kawpow)));
+    BOOST_CHECK(FromHash256(kawpow) == uint256S(to_hex(kawpow)));
+    const auto meowpow = meowpow::hash_no_verify(header.nHeight, to_hash256(header.GetMEOWPOWHeaderHash().GetHex()),
+            to_hash256(header.mix_hash.GetHex()), header.nNonce64);
+    BOOST_CHECK(MEOWPOWHash_OnlyMix(header) == uint256S(to_hex(meowpow)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
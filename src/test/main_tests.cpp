@@ -3,12 +3,17 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chain.h"
 #include "chainparams.h"
+#include "clientversion.h"
+#include "streams.h"
 #include "validation.h"
 #include "net.h"
 
 #include "test/test_meowcoin.h"
 
+#include <functional>
+
 #include <boost/signals2/signal.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -65,6 +70,74 @@ BOOST_FIXTURE_TEST_SUITE(main_tests, TestingSetup)
         BOOST_CHECK_EQUAL(nSum, (int64_t)2078125000000000000ULL);
     }
 
+    /** Writes block at the start of spare block file nFile and points index at it */
+    static void WriteTestBlock(const CBlock& block, int nFile, CBlockIndex& index)
+    {
+        CDiskBlockPos pos(nFile, 0);
+        CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!fileout.IsNull());
+        fileout << block;
+        index.nFile = pos.nFile;
+        index.nDataPos = pos.nPos;
+        index.nStatus |= BLOCK_HAVE_DATA;
+    }
+
+    BOOST_AUTO_TEST_CASE(read_block_checks_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Read Block Checks Index Test");
+
+        // Reading skips the rehash when the header fields match the index, so a block on
+        // disk that differs in any hashed field must still be caught
+        const uint32_t nKAWPOWTime = nKAWPOWActivationTime;
+        const uint32_t nMEOWPOWTime = nMEOWPOWActivationTime;
+        nKAWPOWActivationTime = 2000000000;
+        nMEOWPOWActivationTime = 2100000000;
+
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        int nFile = 100;
+        // Before KAWPOW, then KAWPOW, then MEOWPOW
+        for (uint32_t nTime : {1900000000u, 2000000000u, 2100000000u}) {
+            CBlock block;
+            block.nVersion.SetGenesisVersion(4);
+            block.hashMerkleRoot = uint256S("7d5c0d2a5cf1a4e0b5f9f5b7c2a1f0d3e4b6a8c9d0e1f2a3b4c5d6e7f8091a2b");
+            block.nTime = nTime;
+            block.nBits = 0x207fffff;
+            block.nNonce = 7;
+            block.nHeight = 1234;
+            block.nNonce64 = 0x123456789abcdef0;
+            block.mix_hash = uint256S("f1e2d3c4b5a697887766554433221100ffeeddccbbaa99887766554433221100");
+            const uint256 hash = block.GetHash();
+            CBlockIndex index(block);
+            index.phashBlock = &hash;
+
+            CBlock blockRead;
+            CBlockHeader headerRead;
+            WriteTestBlock(block, nFile++, index);
+            BOOST_CHECK(ReadBlockFromDisk(blockRead, &index, consensusParams));
+            BOOST_CHECK(blockRead.GetHash() == hash);
+            BOOST_CHECK(ReadBlockHeaderFromDisk(headerRead, &index, consensusParams));
+
+            std::vector<std::function<void(CBlock&)>> mutations;
+            if (nTime < nKAWPOWActivationTime) {
+                mutations.push_back([](CBlock& b) { b.nNonce++; });
+            } else {
+                mutations.push_back([](CBlock& b) { b.nHeight++; });
+                mutations.push_back([](CBlock& b) { b.nNonce64++; });
+                mutations.push_back([](CBlock& b) { *b.mix_hash.begin() ^= 1; });
+            }
+            for (const auto& mutate : mutations) {
+                CBlock blockBad = block;
+                mutate(blockBad);
+                WriteTestBlock(blockBad, nFile++, index);
+                BOOST_CHECK(!ReadBlockFromDisk(blockRead, &index, consensusParams));
+                BOOST_CHECK(!ReadBlockHeaderFromDisk(headerRead, &index, consensusParams));
+            }
+        }
+
+        nKAWPOWActivationTime = nKAWPOWTime;
+        nMEOWPOWActivationTime = nMEOWPOWTime;
+    }
+
     bool ReturnFalse()
     { return false; }
 
@@ -597,4 +597,103 @@ BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
         SetMockTime(0);
     }
 
+    BOOST_AUTO_TEST_CASE(mempool_cluster_test)
+    {
+        BOOST_TEST_MESSAGE("Running Mempool Cluster Test");
+
+        CTxMemPool pool;
+        TestMemPoolEntryHelper entry;
+        LOCK(pool.cs);
+
+        CMutableTransaction tx1 = CMutableTransaction();
+        tx1.vin.resize(1);
+        tx1.vin[0].scriptSig = CScript() << OP_11;
+        tx1.vout.resize(2);
+        tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx1.vout[0].nValue = 10 * COIN;
+        tx1.vout[1].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx1.vout[1].nValue = 10 * COIN;
+        pool.addUnchecked(tx1.GetHash(), entry.Fee(0LL).FromTx(tx1));
+
+        // tx2 pays for its parent
+        CMutableTransaction tx2 = CMutableTransaction();
+        tx2.vin.resize(1);
+        tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+        tx2.vin[0].scriptSig = CScript() << OP_11;
+        tx2.vout.resize(1);
+        tx2.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx2.vout[0].nValue = 10 * COIN;
+        pool.addUnchecked(tx2.GetHash(), entry.Fee(20000LL).FromTx(tx2));
+
+        CMutableTransaction tx3 = CMutableTransaction();
+        tx3.vin.resize(1);
+        tx3.vin[0].scriptSig = CScript() << OP_12;
+        tx3.vout.resize(1);
+        tx3.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+        tx3.vout[0].nValue = 10 * COIN;
+        pool.addUnchecked(tx3.GetHash(), entry.Fee(5000LL).FromTx(tx3));
+
+        // tx4 is a low fee sibling of tx2
+        CMutableTransaction tx4 = CMutableTransaction();
+        tx4.vin.resize(1);
+        tx4.vin[0].prevout = COutPoint(tx1.GetHash(), 1);
+        tx4.vin[0].scriptSig = CScript() << OP_11;
+        tx4.vout.resize(1);
+        tx4.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx4.vout[0].nValue = 10 * COIN;
+        pool.addUnchecked(tx4.GetHash(), entry.Fee(100LL).FromTx(tx4));
+
+        // tx1, tx2 and tx4 form one cluster, linearized as tx1, tx2, tx4 and
+        // chunked as {tx1, tx2}, {tx4}. tx3's chunk sits between the two.
+        BOOST_CHECK_EQUAL(pool.GetChunks().size(), 3U);
+        std::vector<CTxMemPool::ChunkRef> vChunks(pool.GetChunks().begin(), pool.GetChunks().end());
+        uint64_t nClusterId = pool.mapTx.find(tx1.GetHash())->nClusterId;
+        BOOST_CHECK_EQUAL(pool.mapTx.find(tx2.GetHash())->nClusterId, nClusterId);
+        BOOST_CHECK_EQUAL(pool.mapTx.find(tx4.GetHash())->nClusterId, nClusterId);
+        BOOST_CHECK(pool.mapTx.find(tx3.GetHash())->nClusterId != nClusterId);
+        BOOST_CHECK_EQUAL(vChunks[0].nClusterId, nClusterId);
+        BOOST_CHECK_EQUAL(vChunks[0].nChunk, 0U);
+        BOOST_CHECK_EQUAL(vChunks[0].nModFees, 20000);
+        BOOST_CHECK_EQUAL(vChunks[1].nClusterId, pool.mapTx.find(tx3.GetHash())->nClusterId);
+        BOOST_CHECK_EQUAL(vChunks[2].nClusterId, nClusterId);
+        BOOST_CHECK_EQUAL(vChunks[2].nChunk, 1U);
+
+        const CTxMemPool::Cluster* cluster = pool.GetCluster(nClusterId);
+        BOOST_REQUIRE(cluster);
+        BOOST_CHECK_EQUAL(cluster->vTxs.size(), 3U);
+        BOOST_CHECK(cluster->vTxs[0]->GetTx().GetHash() == tx1.GetHash());
+        BOOST_CHECK(cluster->vTxs[1]->GetTx().GetHash() == tx2.GetHash());
+        BOOST_CHECK(cluster->vTxs[2]->GetTx().GetHash() == tx4.GetHash());
+
+        // A transaction joining the cluster is counted with all of it
+        CMutableTransaction tx5 = CMutableTransaction();
+        tx5.vin.resize(2);
+        tx5.vin[0].prevout = COutPoint(tx2.GetHash(), 0);
+        tx5.vin[0].scriptSig = CScript() << OP_11;
+        tx5.vin[1].prevout = COutPoint(tx3.GetHash(), 0);
+        tx5.vin[1].scriptSig = CScript() << OP_12;
+        tx5.vout.resize(1);
+        tx5.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx5.vout[0].nValue = 10 * COIN;
+        uint64_t nClusterCount, nClusterSize;
+        pool.CalculateClusterSize(tx5, GetVirtualTransactionSize(tx5), nClusterCount, nClusterSize);
+        BOOST_CHECK_EQUAL(nClusterCount, 5U);
+        BOOST_CHECK_EQUAL(nClusterSize, (uint64_t)(GetVirtualTransactionSize(tx1) + GetVirtualTransactionSize(tx2) + GetVirtualTransactionSize(tx3) +
+                                                  GetVirtualTransactionSize(tx4) + GetVirtualTransactionSize(tx5)));
+
+        // Confirming tx1 splits its cluster
+        std::vector<CTransactionRef> vtx(1, MakeTransactionRef(tx1));
+        pool.removeForBlock(vtx, 1);
+        BOOST_CHECK_EQUAL(pool.size(), 3U);
+        BOOST_CHECK_EQUAL(pool.GetChunks().size(), 3U);
+        BOOST_CHECK(pool.mapTx.find(tx2.GetHash())->nClusterId != pool.mapTx.find(tx4.GetHash())->nClusterId);
+
+        // Trimming evicts from the lowest feerate chunk
+        pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+        BOOST_CHECK(pool.exists(tx2.GetHash()));
+        BOOST_CHECK(pool.exists(tx3.GetHash()));
+        BOOST_CHECK(!pool.exists(tx4.GetHash()));
+        BOOST_CHECK_EQUAL(pool.GetChunks().size(), 2U);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
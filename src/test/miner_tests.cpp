@@ -281,6 +281,78 @@ BOOST_FIXTURE_TEST_SUITE(miner_tests, TestingSetup)
         BOOST_CHECK(pblocktemplate->block.vtx[8]->GetHash() == hashLowFeeTx2);
     }
 
+    static std::vector<uint256> TemplateTxids(const CBlockTemplate &blocktemplate)
+    {
+        std::vector<uint256> vTxids;
+        for (size_t i = 1; i < blocktemplate.block.vtx.size(); ++i)
+            vTxids.push_back(blocktemplate.block.vtx[i]->GetHash());
+        return vTxids;
+    }
+
+    // Test that templates updated with the mempool changes since the last one
+    // hold the same transactions as templates assembled from scratch.
+    void TestIncrementalTemplate(const CChainParams &chainparams, CScript scriptPubKey, std::vector<CTransactionRef> &txFirst)
+    {
+        TestMemPoolEntryHelper entry;
+        mempool.clear();
+
+        IncrementalBlockAssembler assembler(chainparams, false);
+        std::unique_ptr<CBlockTemplate> pblocktemplate = assembler.CreateNewBlock(scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), (uint64_t)1);
+
+        // A free transaction is left out
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vin[0].prevout.hash = txFirst[0]->GetHash();
+        tx.vin[0].prevout.n = 0;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 5000000000LL;
+        uint256 hashFreeTx = tx.GetHash();
+        mempool.addUnchecked(hashFreeTx, entry.Fee(0).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+        pblocktemplate = assembler.CreateNewBlock(scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), (uint64_t)1);
+
+        // ... until a child pays for it
+        tx.vin[0].prevout.hash = hashFreeTx;
+        tx.vout[0].nValue = 5000000000LL - 50000;
+        uint256 hashHighFeeTx = tx.GetHash();
+        mempool.addUnchecked(hashHighFeeTx, entry.Fee(50000).SpendsCoinbase(false).FromTx(tx));
+        pblocktemplate = assembler.CreateNewBlock(scriptPubKey);
+        BOOST_CHECK(TemplateTxids(*pblocktemplate) == std::vector<uint256>({hashFreeTx, hashHighFeeTx}));
+        BOOST_CHECK(TemplateTxids(*pblocktemplate) == TemplateTxids(*BlockAssembler(chainparams).CreateNewBlock(scriptPubKey)));
+
+        tx.vin[0].prevout.hash = txFirst[1]->GetHash();
+        tx.vout[0].nValue = 5000000000LL - 10000;
+        uint256 hashMediumFeeTx = tx.GetHash();
+        mempool.addUnchecked(hashMediumFeeTx, entry.Fee(10000).SpendsCoinbase(true).FromTx(tx));
+        pblocktemplate = assembler.CreateNewBlock(scriptPubKey);
+        BOOST_CHECK(TemplateTxids(*pblocktemplate) == std::vector<uint256>({hashFreeTx, hashHighFeeTx, hashMediumFeeTx}));
+        BOOST_CHECK(TemplateTxids(*pblocktemplate) == TemplateTxids(*BlockAssembler(chainparams).CreateNewBlock(scriptPubKey)));
+        BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[0], -60000);
+
+        // A child joins the cluster of a transaction already in the template,
+        // and is added from the chunks of that cluster
+        tx.vin[0].prevout.hash = hashMediumFeeTx;
+        tx.vout[0].nValue = 5000000000LL - 40000;
+        uint256 hashChildTx = tx.GetHash();
+        mempool.addUnchecked(hashChildTx, entry.Fee(30000).SpendsCoinbase(false).FromTx(tx));
+        pblocktemplate = assembler.CreateNewBlock(scriptPubKey);
+        BOOST_CHECK(TemplateTxids(*pblocktemplate) == std::vector<uint256>({hashFreeTx, hashHighFeeTx, hashMediumFeeTx, hashChildTx}));
+        BOOST_CHECK(TemplateTxids(*pblocktemplate) == TemplateTxids(*BlockAssembler(chainparams).CreateNewBlock(scriptPubKey)));
+        BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[0], -90000);
+
+        // Removing a transaction drops its descendants from the template
+        mempool.removeRecursive(*mempool.get(hashFreeTx));
+        pblocktemplate = assembler.CreateNewBlock(scriptPubKey);
+        BOOST_CHECK(TemplateTxids(*pblocktemplate) == std::vector<uint256>({hashMediumFeeTx, hashChildTx}));
+        BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[0], -40000);
+
+        mempool.clear();
+        pblocktemplate = assembler.CreateNewBlock(scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), (uint64_t)1);
+    }
+
     // NOTE: These tests rely on CreateNewBlock doing its own self-validation!
     BOOST_AUTO_TEST_CASE(createnewblock_validity_test)
     {
@@ -653,6 +725,7 @@ BOOST_FIXTURE_TEST_SUITE(miner_tests, TestingSetup)
         mempool.clear();
 
         TestPackageSelection(chainparams, scriptPubKey, txFirst);
+        TestIncrementalTemplate(chainparams, scriptPubKey, txFirst);
 
         fCheckpointsEnabled = true;
     }
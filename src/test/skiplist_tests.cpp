@@ -4,9 +4,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
+#include "chainparams.h"
+#include "txdb.h"
 #include "util.h"
 #include "test/test_meowcoin.h"
 
+#include <map>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -203,4 +206,53 @@ BOOST_FIXTURE_TEST_SUITE(skiplist_tests, BasicTestingSetup)
         BOOST_CHECK(!chain.FindEarliestAtLeast(int64_t(std::numeric_limits<unsigned int>::max()) + 1));
     }
 
+    BOOST_AUTO_TEST_CASE(blockindex_load_test)
+    {
+        BOOST_TEST_MESSAGE("Running Block Index Load Test");
+
+        // More entries than fit in one arena chunk, so several threads take part
+        const int nBlocks = 3 * CBlockIndexArena::CHUNK_SIZE;
+        std::vector<uint256> vHashes(nBlocks);
+        std::vector<CBlockIndex> vBlocks(nBlocks);
+        std::vector<const CBlockIndex*> vWrite;
+        for (int i = 0; i < nBlocks; i++) {
+            vHashes[i] = GetRandHash();
+            vBlocks[i].phashBlock = &vHashes[i];
+            vBlocks[i].pprev = i > 0 ? &vBlocks[i - 1] : nullptr;
+            vBlocks[i].nHeight = i;
+            vBlocks[i].nTime = i;
+            vBlocks[i].nNonce = i * 7;
+            vBlocks[i].nTx = i % 5 + 1;
+            vBlocks[i].nStatus = i % 2 ? BLOCK_VALID_TREE | BLOCK_HAVE_DATA : BLOCK_VALID_TREE;
+            vBlocks[i].nDataPos = i % 2 ? i * 3 : 0;
+            vWrite.push_back(&vBlocks[i]);
+        }
+
+        CBlockTreeDB blocktree(1 << 20, true);
+        BOOST_CHECK(blocktree.WriteBatchSync({}, 0, vWrite));
+
+        CBlockIndexArena arena;
+        std::map<uint256, CBlockIndex*> mapLoaded;
+        auto insert = [&mapLoaded](const uint256& hash, CBlockIndex* pindex) -> CBlockIndex* {
+            if (hash.IsNull())
+                return nullptr;
+            if (pindex)
+                return mapLoaded[hash] = pindex;
+            BOOST_CHECK(mapLoaded.count(hash));
+            return mapLoaded[hash];
+        };
+        BOOST_CHECK(blocktree.LoadBlockIndexGuts(GetParams().GetConsensus(), arena, insert));
+
+        BOOST_CHECK_EQUAL(mapLoaded.size(), (size_t)nBlocks);
+        for (int i = 0; i < nBlocks; i++) {
+            const CBlockIndex* pindex = mapLoaded[vHashes[i]];
+            BOOST_CHECK_EQUAL(pindex->nHeight, i);
+            BOOST_CHECK_EQUAL(pindex->nNonce, vBlocks[i].nNonce);
+            BOOST_CHECK_EQUAL(pindex->nTx, vBlocks[i].nTx);
+            BOOST_CHECK_EQUAL(pindex->nStatus, vBlocks[i].nStatus);
+            BOOST_CHECK_EQUAL(pindex->nDataPos, vBlocks[i].nDataPos);
+            BOOST_CHECK(pindex->pprev == (i > 0 ? mapLoaded[vHashes[i - 1]] : nullptr));
+        }
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
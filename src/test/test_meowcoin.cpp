@@ -8,6 +8,8 @@
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
 #include "crypto/sha256.h"
+#include "crypto/ethash/include/ethash/ethash.h"
+#include "crypto/scrypt.h"
 #include "fs.h"
 #include "key.h"
 #include "validation.h"
@@ -34,6 +36,8 @@ extern void noui_connect();
 BasicTestingSetup::BasicTestingSetup(const std::string &chainName)
 {
     SHA256AutoDetect();
+    ethash_progpow_autodetect();
+    scrypt_detect_batch();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
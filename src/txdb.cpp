@@ -18,18 +18,17 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
-static const char DB_ADDRESSINDEX = 'a';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
-static const char DB_TIMESTAMPINDEX = 's';
-static const char DB_BLOCKHASHINDEX = 'z';
-static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_UTXO_STATS = 'U';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -61,19 +60,55 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, 2 << 20)
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", DBOptionsFromArgs("chainstate", nCacheSize), fMemory, fWipe, true), fWriteBehind(false), fPending(false), fPendingFailed(false)
+{
+}
+
+CCoinsViewDB::~CCoinsViewDB()
 {
+    WaitForWrite();
+    if (threadWrite.joinable())
+        threadWrite.join();
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending || fPendingFailed) {
+            CCoinsMap::const_iterator it = mapPending.find(outpoint);
+            if (it != mapPending.end()) {
+                if (it->second.coin.IsSpent())
+                    return false;
+                coin = it->second.coin;
+                return true;
+            }
+        }
+    }
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending || fPendingFailed) {
+            CCoinsMap::const_iterator it = mapPending.find(outpoint);
+            if (it != mapPending.end())
+                return !it->second.coin.IsSpent();
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        if (fPending || fPendingFailed)
+            return hashPending;
+    }
+    return ReadBestBlock();
+}
+
+uint256 CCoinsViewDB::ReadBestBlock() const {
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -89,6 +124,61 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // Writes must reach the database in order, so let a previous
+    // write-behind finish first.
+    if (!WaitForWrite())
+        return false;
+    if (threadWrite.joinable())
+        threadWrite.join();
+
+    if (!fWriteBehind) {
+        bool ret = WriteCoins(mapCoins, hashBlock);
+        mapCoins.clear();
+        return ret;
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(cs_pending);
+        mapPending.swap(mapCoins);
+        hashPending = hashBlock;
+        fPending = true;
+    }
+    LogPrint(BCLog::COINDB, "Writing %u cached transaction outputs to coin database in the background\n", (unsigned int)mapPending.size());
+    threadWrite = std::thread(&CCoinsViewDB::ThreadWrite, this);
+    return true;
+}
+
+void CCoinsViewDB::ThreadWrite()
+{
+    RenameThread("meowcoin-coinsflush");
+    // mapPending is only read here and by lookups until fPending is reset,
+    // so it can be written without holding cs_pending.
+    bool ret = false;
+    try {
+        ret = WriteCoins(mapPending, hashPending);
+    } catch (const std::exception& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+    if (!ret)
+        LogPrintf("ERROR: %s: Failed to write to coin database\n", __func__);
+
+    boost::unique_lock<boost::mutex> lock(cs_pending);
+    if (ret)
+        mapPending.clear();
+    else
+        fPendingFailed = true;
+    fPending = false;
+    condPending.notify_all();
+}
+
+bool CCoinsViewDB::WaitForWrite() const {
+    boost::unique_lock<boost::mutex> lock(cs_pending);
+    while (fPending)
+        condPending.wait(lock);
+    return !fPendingFailed;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -96,7 +186,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = ReadBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -113,7 +203,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -123,8 +213,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -149,12 +237,24 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::ReadUTXOStats(const uint256 &hashBlock, CUTXOStats &stats) const {
+    return db.Read(std::make_pair(DB_UTXO_STATS, hashBlock), stats);
+}
+
+bool CCoinsViewDB::WriteUTXOStats(const CUTXOStats &stats, const uint256 &hashReplaced) {
+    CDBBatch batch(db);
+    if (!hashReplaced.IsNull() && hashReplaced != stats.hashBlock)
+        batch.Erase(std::make_pair(DB_UTXO_STATS, hashReplaced));
+    batch.Write(std::make_pair(DB_UTXO_STATS, stats.hashBlock), stats);
+    return db.WriteBatch(batch);
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t maxFileSize) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, maxFileSize) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t maxFileSize) : CDBWrapper(GetDataDir() / "blocks" / "index", DBOptionsFromArgs("blockindex", nCacheSize, maxFileSize), fMemory, fWipe, false) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -179,6 +279,8 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    // The cursor only sees the database, so let a write-behind land first.
+    WaitForWrite();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
@@ -195,6 +297,83 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
     return i;
 }
 
+bool ParallelForEachCoin(const CCoinsViewDB& view, const CoinVisitor& visitor, int nThreads, uint256& hashBlock)
+{
+    if (nThreads <= 0)
+        nThreads = std::min(GetNumCores(), MAX_UTXO_SCAN_THREADS);
+    nThreads = std::max(1, std::min(nThreads, MAX_UTXO_SCAN_THREADS));
+
+    view.WaitForWrite();
+    const CDBWrapper& db = view.db;
+    const leveldb::Snapshot* snapshot = db.GetSnapshot();
+
+    bool fHaveBestBlock = false;
+    {
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator(snapshot));
+        pcursor->Seek(DB_BEST_BLOCK);
+        char key;
+        fHaveBestBlock = pcursor->Valid() && pcursor->GetKey(key) && key == DB_BEST_BLOCK && pcursor->GetValue(hashBlock);
+    }
+    if (!fHaveBestBlock) {
+        db.ReleaseSnapshot(snapshot);
+        return error("%s: no best block in the coin database snapshot", __func__);
+    }
+
+    // Coin keys are DB_COIN followed by the txid, so the first txid byte
+    // splits them into ranges of about equal size. Use several ranges per
+    // thread, so that threads which finish early can help out.
+    const int nRanges = std::min(256, nThreads * 8);
+    std::atomic<int> nNextRange(0);
+    std::atomic<bool> fFailed(false);
+    std::atomic<bool> fStopped(false);
+
+    auto scan = [&](int nThread) {
+        if (nThread > 0)
+            RenameThread("meowcoin-utxoscan");
+        try {
+            std::unique_ptr<CDBIterator> pcursor(db.NewIterator(snapshot));
+            COutPoint outpoint;
+            CoinEntry entry(&outpoint);
+            Coin coin;
+            for (int nRange = nNextRange++; nRange < nRanges && !fFailed && !fStopped; nRange = nNextRange++) {
+                const int nBegin = 256 * nRange / nRanges;
+                const int nEnd = 256 * (nRange + 1) / nRanges;
+                pcursor->Seek(std::make_pair(DB_COIN, (unsigned char)nBegin));
+                for (; pcursor->Valid(); pcursor->Next()) {
+                    if (!pcursor->GetKey(entry) || entry.key != DB_COIN || *outpoint.hash.begin() >= nEnd)
+                        break;
+                    if (!pcursor->GetValue(coin)) {
+                        fFailed = true;
+                        break;
+                    }
+                    if (!visitor(nThread, outpoint, coin)) {
+                        fStopped = true;
+                    }
+                    if (fFailed || fStopped)
+                        break;
+                }
+            }
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            fFailed = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; i++) {
+        threads.emplace_back(scan, i);
+    }
+    scan(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    db.ReleaseSnapshot(snapshot);
+
+    if (fFailed)
+        return error("%s: unable to read the coin database", __func__);
+    return !fStopped;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -254,195 +433,8 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
-}
-
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                if (key.second.asset != "MEWC") {
-                    unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                }
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    if (!assetName.empty() && start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX,
-                                     CAddressIndexIteratorHeightKey(type, addressHash, assetName, start)));
-    } else if (!assetName.empty()) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
-    } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
-    }
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
-            if (end > 0 && key.second.blockHeight > end) {
-                break;
-            }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address index value");
-            }
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
-
-    return CBlockTreeDB::ReadAddressIndex(addressHash, type, "", addressIndex, start, end);
-}
-
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
-
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
-            if (fActiveOnly) {
-                if (HashOnchainActive(key.second.blockHash)) {
-                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-                }
-            } else {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-            }
-
-            pcursor->Next();
-        } else {
-            break;
-        }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
-
-    CTimestampBlockIndexValue lts;
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
-	return false;
-
-    ltimestamp = lts.ltimestamp;
-    return true;
+bool CBlockTreeDB::HaveBlockIndex(const uint256 &hash) const {
+    return Exists(std::make_pair(DB_BLOCK_INDEX, hash));
 }
 
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
@@ -457,49 +449,90 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, CBlockIndexArena& arena,
+                                      std::function<CBlockIndex*(const uint256&, CBlockIndex*)> insertBlockIndex)
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
-
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->nNonce64       = diskindex.nNonce64;
-                pindexNew->mix_hash       = diskindex.mix_hash;
-                pindexNew->nHeight        = diskindex.nHeight;
-
-                /* Bitcoin checks the PoW here.  We don't do this because
-                   the CDiskBlockIndex does not contain the auxpow.
-                   This check isn't important, since the data on disk should
-                   already be valid and can be trusted.  */
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
+    // An entry read by one of the threads, waiting to be linked
+    struct LoadedEntry {
+        CBlockIndex* pindex;
+        uint256 hash;
+        uint256 hashPrev;
+    };
+
+    // The keys are DB_BLOCK_INDEX followed by the block hash, so like in
+    // ParallelForEachCoin the first hash byte splits them into ranges the
+    // threads take in turn. Each thread fills chunks of the arena of its own.
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_BLOCK_INDEX_LOAD_THREADS));
+    const int nRanges = std::min(256, nThreads * 8);
+    std::atomic<int> nNextRange(0);
+    std::atomic<bool> fFailed(false);
+    std::vector<std::vector<LoadedEntry> > vLoaded(nThreads);
+
+    auto load = [&](int nThread) {
+        if (nThread > 0)
+            RenameThread("meowcoin-loadblk");
+        try {
+            std::unique_ptr<CDBIterator> pcursor(NewIterator());
+            std::vector<LoadedEntry>& vEntries = vLoaded[nThread];
+            CBlockIndex* pchunk = nullptr;
+            size_t nUsed = CBlockIndexArena::CHUNK_SIZE;
+            std::pair<char, uint256> key;
+            for (int nRange = nNextRange++; nRange < nRanges && !fFailed; nRange = nNextRange++) {
+                const int nBegin = 256 * nRange / nRanges;
+                const int nEnd = 256 * (nRange + 1) / nRanges;
+                pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, (unsigned char)nBegin));
+                for (; pcursor->Valid(); pcursor->Next()) {
+                    if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= nEnd)
+                        break;
+                    CDiskBlockIndex diskindex;
+                    if (!pcursor->GetValue(diskindex)) {
+                        fFailed = true;
+                        break;
+                    }
+                    if (nUsed == CBlockIndexArena::CHUNK_SIZE) {
+                        pchunk = arena.AllocChunk();
+                        nUsed = 0;
+                    }
+                    // The key is the block hash, so it need not be hashed again
+                    CBlockIndex* pindexNew = &pchunk[nUsed++];
+                    *pindexNew = diskindex;
+                    pindexNew->pprev = nullptr;
+                    vEntries.push_back(LoadedEntry{pindexNew, key.second, diskindex.hashPrev});
+                }
             }
-        } else {
-            break;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            fFailed = true;
         }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; i++) {
+        threads.emplace_back(load, i);
+    }
+    load(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (fFailed)
+        return error("%s: failed to read value", __func__);
+
+    boost::this_thread::interruption_point();
+
+    /* Bitcoin checks the PoW here.  We don't do this because
+       the CDiskBlockIndex does not contain the auxpow.
+       This check isn't important, since the data on disk should
+       already be valid and can be trusted.  */
+
+    // Load mapBlockIndex, then link the entries, which needs all of them.
+    for (const std::vector<LoadedEntry>& vEntries : vLoaded) {
+        for (const LoadedEntry& entry : vEntries)
+            insertBlockIndex(entry.hash, entry.pindex);
+    }
+    for (std::vector<LoadedEntry>& vEntries : vLoaded) {
+        for (const LoadedEntry& entry : vEntries)
+            entry.pindex->pprev = insertBlockIndex(entry.hashPrev, nullptr);
+        std::vector<LoadedEntry>().swap(vEntries);
     }
 
     return true;
@@ -12,10 +12,13 @@
 #include "chain.h"
 #include "addressindex.h"
 #include "spentindex.h"
+#include "sync.h"
 #include "timestampindex.h"
 
+#include <functional>
 #include <map>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -25,6 +28,8 @@ class uint256;
 
 //! No need to periodic flush if at least this much space still available.
 static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
+//! Databases with their own -<db>db* LevelDB arguments
+static const char* const DB_ARG_NAMES[] = {"chainstate", "blockindex", "addressindex", "addresssummaryindex", "spentindex", "timestampindex"};
 //! -dbcache default (MiB)
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
@@ -39,8 +44,14 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
+//! Max memory allocated to the cache of each index database under indexes/ (MiB)
+static const int64_t nMaxIndexDBCache = 256;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Max number of threads of a parallel UTXO set scan
+static const int MAX_UTXO_SCAN_THREADS = 16;
+//! Max number of threads loading the block index
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -67,13 +78,52 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * Called by ParallelForEachCoin for every coin, concurrently from several
+ * threads. nThread (0..nThreads-1) identifies the calling thread, so that the
+ * visitor can keep per-thread state without locking. Return false to stop.
+ */
+typedef std::function<bool(int nThread, const COutPoint& outpoint, const Coin& coin)> CoinVisitor;
+
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * In write-behind mode (see SetWriteBehind()), BatchWrite takes over the
+ * passed coins and returns at once, and a writer thread commits them to the
+ * database. Until it is done, the coins being written are an overlay on the
+ * database, so reads through this view see the state of the last BatchWrite.
+ * The head-blocks marker is written in the same way as for a synchronous
+ * write, so that ReplayBlocks can recover from a crash in between.
+ */
 class CCoinsViewDB final : public CCoinsView
 {
+    friend bool ParallelForEachCoin(const CCoinsViewDB& view, const CoinVisitor& visitor, int nThreads, uint256& hashBlock);
+
 protected:
     CDBWrapper db;
+
+    //! Whether the next BatchWrite is handed to the writer thread.
+    bool fWriteBehind;
+
+    //! Protects the write-behind state below.
+    mutable CWaitableCriticalSection cs_pending;
+    mutable CConditionVariable condPending;
+    //! Coins being written by threadWrite, and the block they belong to.
+    CCoinsMap mapPending;
+    uint256 hashPending;
+    //! Whether threadWrite is busy with mapPending.
+    bool fPending;
+    //! Whether a write-behind failed. mapPending is kept, so reads stay correct.
+    bool fPendingFailed;
+    std::thread threadWrite;
+
+    uint256 ReadBestBlock() const;
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+    void ThreadWrite();
+
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -82,11 +132,32 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Read the UTXO set stats stored for the given block.
+    bool ReadUTXOStats(const uint256 &hashBlock, CUTXOStats &stats) const;
+    //! Store the stats for stats.hashBlock, dropping those of a previously stored block.
+    bool WriteUTXOStats(const CUTXOStats &stats, const uint256 &hashReplaced);
+
+    //! Hand the next BatchWrite calls to the writer thread instead of writing them in place.
+    void SetWriteBehind(bool fWriteBehindIn) { fWriteBehind = fWriteBehindIn; }
+    //! Wait until a write-behind is committed. Returns false if it failed.
+    bool WaitForWrite() const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
 };
 
+/**
+ * Visit every coin of the coin database, as of a single snapshot, with
+ * nThreads threads (all cores up to MAX_UTXO_SCAN_THREADS if <= 0). The txid
+ * space is split into ranges that the threads take in turn, each with its own
+ * iterator, so the order in which coins are visited is unspecified.
+ * hashBlock is set to the best block of the snapshot. Returns false if the
+ * snapshot has no best block (a flush was in progress), a coin could not be
+ * read, or the visitor stopped the scan.
+ */
+bool ParallelForEachCoin(const CCoinsViewDB& view, const CoinVisitor& visitor, int nThreads, uint256& hashBlock);
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -125,28 +196,18 @@ public:
     bool ReadReindexing(bool &fReindexing);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
-                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
-                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
-    bool ReadAddressIndex(uint160 addressHash, int type,
-                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
-    bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
-    bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    bool HaveBlockIndex(const uint256 &hash) const;
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /**
+     * Read every block index entry into objects from arena, with a thread per
+     * core (up to MAX_BLOCK_INDEX_LOAD_THREADS) each reading ranges of the
+     * keys. Then, in the calling thread, each object is handed to
+     * insertBlockIndex(hash, pindex), and linked to its parent returned by
+     * insertBlockIndex(hashPrev, nullptr).
+     */
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, CBlockIndexArena& arena,
+                            std::function<CBlockIndex*(const uint256&, CBlockIndex*)> insertBlockIndex);
 };
 
 #endif // MEOWCOIN_TXDB_H
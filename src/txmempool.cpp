@@ -20,6 +20,9 @@
 #include "utiltime.h"
 #include "hash.h"
 
+//! Clusters larger than this are linearized in plain topological order
+static const size_t MAX_GREEDY_LINEARIZATION = 500;
+
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp):
@@ -39,6 +42,8 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nSizeWithAncestors = GetTxSize();
     nModFeesWithAncestors = nFee;
     nSigOpCostWithAncestors = sigOpCost;
+
+    nClusterId = 0;
 }
 
 void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
@@ -149,6 +154,16 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
         }
         UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded);
     }
+
+    // The new links may have joined clusters together
+    setEntries setUpdated;
+    for (const uint256 &hash : vHashesToUpdate) {
+        txiter it = mapTx.find(hash);
+        if (it != mapTx.end()) {
+            setUpdated.insert(it);
+        }
+    }
+    UpdateClusters(setUpdated);
 }
 
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
@@ -415,6 +430,8 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 
+    UpdateClusters(setEntries{newit});
+
     return true;
 }
 
@@ -620,6 +637,20 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     NotifyEntryRemoved(it->GetSharedTx(), reason);
     const uint256 hash = it->GetTx().GetHash();
+
+    // Dissolve the cluster; RemoveStaged regroups what is left of it
+    setClusterSeeds.erase(it);
+    clusterMap::iterator cit = mapClusters.find(it->nClusterId);
+    if (cit != mapClusters.end()) {
+        for (txiter member : cit->second.vTxs) {
+            member->nClusterId = 0;
+            if (member != it) {
+                setClusterSeeds.insert(member);
+            }
+        }
+        RemoveCluster(cit->first);
+    }
+
     for (const CTxIn& txin : it->GetTx().vin)
         mapNextTx.erase(txin.prevout);
 
@@ -1018,6 +1049,10 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 void CTxMemPool::_clear()
 {
     mapLinks.clear();
+    mapClusters.clear();
+    setChunks.clear();
+    setClusterSeeds.clear();
+    nLastClusterId = 0;
     mapTx.clear();
     mapNextTx.clear();
     totalTxSize = 0;
@@ -1191,6 +1226,40 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
+
+    // Check that the clusters partition the mempool into connected sets, each
+    // linearized in a valid order and chunked by non-increasing feerate
+    assert(setClusterSeeds.empty());
+    uint64_t nClusteredTx = 0;
+    size_t nChunks = 0;
+    for (const auto& entry : mapClusters) {
+        const Cluster& cluster = entry.second;
+        assert(!cluster.vTxs.empty() && !cluster.vChunks.empty());
+        assert(cluster.vChunks.back().nEnd == cluster.vTxs.size());
+        setEntries setSeen;
+        int64_t nSize = 0;
+        for (txiter it : cluster.vTxs) {
+            assert(it->nClusterId == entry.first);
+            for (txiter parent : GetMemPoolParents(it)) {
+                assert(setSeen.count(parent));
+            }
+            setSeen.insert(it);
+            nSize += it->GetTxSize();
+        }
+        assert(nSize == cluster.nSize);
+        for (size_t i = 0; i < cluster.vChunks.size(); i++) {
+            const ClusterChunk& chunk = cluster.vChunks[i];
+            assert(setChunks.count(ChunkRef{entry.first, i, chunk.nModFees, chunk.nSize}));
+            if (i > 0) {
+                const ClusterChunk& prev = cluster.vChunks[i - 1];
+                assert((double)chunk.nModFees * prev.nSize <= (double)prev.nModFees * chunk.nSize);
+            }
+        }
+        nClusteredTx += cluster.vTxs.size();
+        nChunks += cluster.vChunks.size();
+    }
+    assert(nClusteredTx == mapTx.size());
+    assert(nChunks == setChunks.size());
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb)
@@ -1252,7 +1321,7 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
 }
 
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
-    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee()};
+    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee(), it->GetCountWithAncestors()};
 }
 
 std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
@@ -1311,6 +1380,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             for (txiter descendantIt : setDescendants) {
                 mapTx.modify(descendantIt, update_ancestor_state(0, nFeeDelta, 0, 0));
             }
+            UpdateClusters(setEntries{it});
             ++nTransactionsUpdated;
         }
     }
@@ -1362,7 +1432,9 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // Clusters are charged per transaction as if each was a cluster and chunk of its own, which is exact in the common case and an upper bound otherwise.
+    size_t nClusterUsage = sizeof(txiter) + sizeof(ClusterChunk) + memusage::MallocUsage(sizeof(std::pair<const uint64_t, Cluster>) + 3 * sizeof(void*)) + memusage::MallocUsage(sizeof(ChunkRef) + 3 * sizeof(void*));
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + nClusterUsage * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -1371,6 +1443,8 @@ void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPool
     for (const txiter& it : stage) {
         removeUnchecked(it, reason);
     }
+    UpdateClusters(setClusterSeeds);
+    setClusterSeeds.clear();
 }
 
 int CTxMemPool::Expire(int64_t time) {
@@ -1435,6 +1509,193 @@ const CTxMemPool::setEntries & CTxMemPool::GetMemPoolChildren(txiter entry) cons
     return it->second.children;
 }
 
+const CTxMemPool::Cluster* CTxMemPool::GetCluster(uint64_t nClusterId) const
+{
+    AssertLockHeld(cs);
+    clusterMap::const_iterator it = mapClusters.find(nClusterId);
+    return it == mapClusters.end() ? nullptr : &it->second;
+}
+
+void CTxMemPool::CalculateClusterSize(const CTransaction& tx, int64_t nTxSize, uint64_t& nClusterCount, uint64_t& nClusterSize) const
+{
+    LOCK(cs);
+    nClusterCount = 1;
+    nClusterSize = nTxSize;
+    std::set<uint64_t> setClusterIds;
+    for (const CTxIn& txin : tx.vin) {
+        txiter piter = mapTx.find(txin.prevout.hash);
+        if (piter == mapTx.end() || !setClusterIds.insert(piter->nClusterId).second)
+            continue;
+        const Cluster* cluster = GetCluster(piter->nClusterId);
+        if (cluster) {
+            nClusterCount += cluster->vTxs.size();
+            nClusterSize += cluster->nSize;
+        }
+    }
+}
+
+void CTxMemPool::UpdateClusters(const setEntries& seeds)
+{
+    std::vector<txiter> vPending(seeds.begin(), seeds.end());
+    setEntries setVisited;
+    while (!vPending.empty()) {
+        txiter seed = vPending.back();
+        vPending.pop_back();
+        if (!setVisited.insert(seed).second)
+            continue;
+
+        // Walk the connected component of seed. Any cluster it touches is
+        // dissolved, and its other members are regrouped in turn.
+        setEntries setComponent;
+        std::vector<txiter> vWork(1, seed);
+        setComponent.insert(seed);
+        while (!vWork.empty()) {
+            txiter it = vWork.back();
+            vWork.pop_back();
+            clusterMap::iterator cit = mapClusters.find(it->nClusterId);
+            if (cit != mapClusters.end()) {
+                for (txiter member : cit->second.vTxs) {
+                    member->nClusterId = 0;
+                    vPending.push_back(member);
+                }
+                RemoveCluster(cit->first);
+            }
+            const TxLinks& links = mapLinks.at(it);
+            for (txiter parent : links.parents) {
+                if (setComponent.insert(parent).second)
+                    vWork.push_back(parent);
+            }
+            for (txiter child : links.children) {
+                if (setComponent.insert(child).second)
+                    vWork.push_back(child);
+            }
+        }
+        setVisited.insert(setComponent.begin(), setComponent.end());
+        AddCluster(setComponent);
+    }
+}
+
+void CTxMemPool::AddCluster(const setEntries& members)
+{
+    const uint64_t nClusterId = ++nLastClusterId;
+    Cluster& cluster = mapClusters[nClusterId];
+    cluster.nSize = 0;
+
+    // Put the members in topological order (parents before children)
+    std::map<txiter, size_t, CompareIteratorByHash> mapPos;
+    std::vector<txiter> vTopo;
+    vTopo.reserve(members.size());
+    {
+        std::map<txiter, size_t, CompareIteratorByHash> mapParentsLeft;
+        for (txiter it : members) {
+            size_t nParents = GetMemPoolParents(it).size();
+            if (nParents == 0)
+                vTopo.push_back(it);
+            else
+                mapParentsLeft[it] = nParents;
+        }
+        for (size_t i = 0; i < vTopo.size(); i++) {
+            for (txiter child : GetMemPoolChildren(vTopo[i])) {
+                if (--mapParentsLeft[child] == 0)
+                    vTopo.push_back(child);
+            }
+        }
+        assert(vTopo.size() == members.size());
+    }
+    for (size_t i = 0; i < vTopo.size(); i++)
+        mapPos[vTopo[i]] = i;
+
+    const size_t n = vTopo.size();
+    if (n > MAX_GREEDY_LINEARIZATION) {
+        // Too large to linearize by feerate; plain topological order still
+        // yields valid (if worse) chunks.
+        cluster.vTxs = std::move(vTopo);
+    } else {
+        // Greedy linearization: repeatedly take the not yet included ancestors
+        // of the transaction for which they have the highest feerate.
+        std::vector<std::vector<bool> > vAncestors(n, std::vector<bool>(n, false));
+        for (size_t i = 0; i < n; i++) {
+            vAncestors[i][i] = true;
+            for (txiter parent : GetMemPoolParents(vTopo[i])) {
+                const std::vector<bool>& vParentAncestors = vAncestors[mapPos[parent]];
+                for (size_t j = 0; j < i; j++) {
+                    if (vParentAncestors[j])
+                        vAncestors[i][j] = true;
+                }
+            }
+        }
+        std::vector<CAmount> vFees(n, 0);
+        std::vector<int64_t> vSizes(n, 0);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j <= i; j++) {
+                if (vAncestors[i][j]) {
+                    vFees[i] += vTopo[j]->GetModifiedFee();
+                    vSizes[i] += vTopo[j]->GetTxSize();
+                }
+            }
+        }
+        std::vector<bool> vIncluded(n, false);
+        cluster.vTxs.reserve(n);
+        while (cluster.vTxs.size() < n) {
+            size_t nBest = n;
+            for (size_t i = 0; i < n; i++) {
+                if (vIncluded[i])
+                    continue;
+                if (nBest == n || (double)vFees[i] * vSizes[nBest] > (double)vFees[nBest] * vSizes[i])
+                    nBest = i;
+            }
+            for (size_t j = 0; j <= nBest; j++) {
+                if (vIncluded[j] || !vAncestors[nBest][j])
+                    continue;
+                vIncluded[j] = true;
+                cluster.vTxs.push_back(vTopo[j]);
+                for (size_t k = j + 1; k < n; k++) {
+                    if (!vIncluded[k] && vAncestors[k][j]) {
+                        vFees[k] -= vTopo[j]->GetModifiedFee();
+                        vSizes[k] -= vTopo[j]->GetTxSize();
+                    }
+                }
+            }
+        }
+    }
+
+    // Chunk the linearization: merge a chunk into the previous one while it
+    // has a higher feerate.
+    for (size_t i = 0; i < n; i++) {
+        txiter it = cluster.vTxs[i];
+        it->nClusterId = nClusterId;
+        cluster.nSize += it->GetTxSize();
+        cluster.vChunks.push_back(ClusterChunk{i + 1, it->GetModifiedFee(), (int64_t)it->GetTxSize(), it->GetSigOpCost()});
+        while (cluster.vChunks.size() > 1) {
+            ClusterChunk& last = cluster.vChunks.back();
+            ClusterChunk& prev = cluster.vChunks[cluster.vChunks.size() - 2];
+            if ((double)last.nModFees * prev.nSize <= (double)prev.nModFees * last.nSize)
+                break;
+            prev.nEnd = last.nEnd;
+            prev.nModFees += last.nModFees;
+            prev.nSize += last.nSize;
+            prev.nSigOpCost += last.nSigOpCost;
+            cluster.vChunks.pop_back();
+        }
+    }
+    cluster.vChunks.shrink_to_fit();
+
+    for (size_t i = 0; i < cluster.vChunks.size(); i++) {
+        setChunks.insert(ChunkRef{nClusterId, i, cluster.vChunks[i].nModFees, cluster.vChunks[i].nSize});
+    }
+}
+
+void CTxMemPool::RemoveCluster(uint64_t nClusterId)
+{
+    clusterMap::iterator it = mapClusters.find(nClusterId);
+    assert(it != mapClusters.end());
+    const Cluster& cluster = it->second;
+    for (size_t i = 0; i < cluster.vChunks.size(); i++) {
+        setChunks.erase(ChunkRef{nClusterId, i, cluster.vChunks[i].nModFees, cluster.vChunks[i].nSize});
+    }
+    mapClusters.erase(it);
+}
+
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
     LOCK(cs);
     if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
@@ -1473,19 +1734,23 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+        // The chunk with the lowest feerate is the last chunk of its cluster.
+        // Its last transaction is evicted; nothing else in the mempool depends
+        // on it, and the rest of the chunk is then chunked anew.
+        const ChunkRef chunk = *setChunks.rbegin();
+        const Cluster& cluster = mapClusters.at(chunk.nClusterId);
 
         // We set the new mempool min fee to the feerate of the removed set, plus the
         // "minimum reasonable fee rate" (ie some value under which we consider txn
         // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
         // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+        CFeeRate removed(chunk.nModFees, chunk.nSize);
         removed += incrementalRelayFee;
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
         setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
+        CalculateDescendants(cluster.vTxs[cluster.vChunks[chunk.nChunk].nEnd - 1], stage);
         nTxnRemoved += stage.size();
 
         std::vector<CTransaction> txn;
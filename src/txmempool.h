@@ -132,6 +132,7 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t nClusterId; //!< Cluster this entry belongs to in the mempool (0 if none)
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -312,6 +313,9 @@ struct TxMempoolInfo
 
     /** The fee delta. */
     int64_t nFeeDelta;
+
+    /** Number of in-mempool ancestors, including the transaction itself. */
+    uint64_t nCountWithAncestors;
 };
 
 /** Reason why a transaction was removed from the mempool,
@@ -412,6 +416,17 @@ public:
  * CalculateMemPoolAncestors() takes configurable limits that are designed to
  * prevent these calculations from being too CPU intensive.
  *
+ * Clusters:
+ *
+ * The mempool is also partitioned into clusters, the connected components of
+ * the graph formed by mapLinks. Each cluster keeps a linearization (an order
+ * of its transactions that respects their dependencies and front-loads high
+ * feerate transactions) split into chunks of non-increasing feerate. The
+ * chunks of all clusters are kept sorted by feerate in setChunks; mining
+ * selects from the front of it, and TrimToSize evicts from the back. The
+ * size of a cluster is bounded in AcceptToMemoryPool (-limitclustercount),
+ * which in turn bounds the work to keep its linearization up to date.
+ *
  */
 class CTxMemPool
 {
@@ -513,8 +528,57 @@ public:
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
+    /** A chunk is a prefix-closed range of a cluster's linearization,
+     *  vTxs[previous chunk's nEnd, nEnd), with its aggregate fee and size. */
+    struct ClusterChunk {
+        size_t nEnd;
+        CAmount nModFees;
+        int64_t nSize;
+        int64_t nSigOpCost;
+    };
+
+    struct Cluster {
+        std::vector<txiter> vTxs;           //!< Linearization, parents before children
+        std::vector<ClusterChunk> vChunks;  //!< Chunks of vTxs, by non-increasing feerate
+        int64_t nSize;                      //!< Total virtual size of vTxs
+    };
+
+    /** Reference to a chunk, as kept in the feerate-sorted setChunks */
+    struct ChunkRef {
+        uint64_t nClusterId;
+        size_t nChunk;
+        CAmount nModFees;
+        int64_t nSize;
+    };
+
+    /** Sort chunks by decreasing feerate; earlier chunks of a cluster first on ties */
+    struct CompareChunkByFeeRate {
+        bool operator()(const ChunkRef& a, const ChunkRef& b) const {
+            double f1 = (double)a.nModFees * b.nSize;
+            double f2 = (double)b.nModFees * a.nSize;
+            if (f1 != f2) {
+                return f1 > f2;
+            }
+            if (a.nClusterId != b.nClusterId) {
+                return a.nClusterId < b.nClusterId;
+            }
+            return a.nChunk < b.nChunk;
+        }
+    };
+    typedef std::set<ChunkRef, CompareChunkByFeeRate> setChunkRefs;
+
     const setEntries & GetMemPoolParents(txiter entry) const;
     const setEntries & GetMemPoolChildren(txiter entry) const;
+
+    /** All chunks of all clusters, by decreasing feerate. Requires cs. */
+    const setChunkRefs& GetChunks() const { return setChunks; }
+    /** The cluster with the given id, or nullptr. Requires cs. */
+    const Cluster* GetCluster(uint64_t nClusterId) const;
+
+    /** Number of transactions and total size of the cluster a transaction
+     *  spending tx's inputs would join, including tx itself. Only direct
+     *  in-mempool parents are looked up, so this is O(inputs). */
+    void CalculateClusterSize(const CTransaction& tx, int64_t nTxSize, uint64_t& nClusterCount, uint64_t& nClusterSize) const;
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
@@ -526,6 +590,13 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
+    typedef std::map<uint64_t, Cluster> clusterMap;
+    clusterMap mapClusters;
+    setChunkRefs setChunks;
+    uint64_t nLastClusterId;
+    //! Entries whose cluster was dissolved by removeUnchecked, to be regrouped by RemoveStaged
+    setEntries setClusterSeeds;
+
     typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
     addressDeltaMap mapAddress;
 
@@ -724,6 +795,13 @@ private:
      *  removal.
      */
     void removeUnchecked(txiter entry, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
+
+    /** Regroup the clusters that contain any of seeds, after links between
+     *  them were added or removed, and relinearize them. */
+    void UpdateClusters(const setEntries& seeds);
+    /** Linearize and chunk the given connected transactions as a new cluster. */
+    void AddCluster(const setEntries& members);
+    void RemoveCluster(uint64_t nClusterId);
 };
 
 /** 
@@ -12,13 +12,18 @@
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "coinprefetch.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
+#include "crypto/scrypt.h"
 #include "cuckoocache.h"
 #include "fs.h"
 #include "hash.h"
+#include "index/address.h"
+#include "index/spent.h"
+#include "index/timestamp.h"
 #include "init.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
@@ -83,6 +88,8 @@ using namespace boost::placeholders;
 CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
+/** Owns the entries of mapBlockIndex */
+static CBlockIndexArena blockIndexArena;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = nullptr;
 CWaitableCriticalSection csBestBlock;
@@ -94,7 +101,10 @@ bool fMessaging = true;
 bool fTxIndex = false;
 bool fAssetIndex = false;
 bool fAddressIndex = false;
+bool fAddressSummaryIndex = false;
 bool fTimestampIndex = false;
+bool fUTXOStats = DEFAULT_UTXOSTATS;
+bool fAsyncFlush = DEFAULT_ASYNC_FLUSH;
 bool fSpentIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
@@ -232,6 +242,13 @@ CCoinsViewDB *pcoinsdbview = nullptr;
 CCoinsViewCache *pcoinsTip = nullptr;
 CBlockTreeDB *pblocktree = nullptr;
 
+/** Running UTXO set stats at the best block of pcoinsTip, see CUTXOStats.
+  * Only valid while fUTXOStatsKnown; protected by cs_main. */
+static CUTXOStats utxoStatsTip;
+static bool fUTXOStatsKnown = false;
+/** The block of the stats last written to the coin database. */
+static uint256 hashUTXOStatsOnDisk;
+
 CAssetsDB *passetsdb = nullptr;
 CAssetsCache *passets = nullptr;
 CLRUCache<std::string, CDatabasedAssetData> *passetsCache = nullptr;
@@ -722,6 +739,18 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
                 REJECT_HIGHFEE, "absurdly-high-fee",
                 strprintf("%d > %d", nFees, nAbsurdFee));
 
+        // Bound the cluster the transaction joins first. This only looks at
+        // its direct parents, and bounds the work of the walks below and of
+        // relinearizing the cluster.
+        uint64_t nClusterCount, nClusterSize;
+        pool.CalculateClusterSize(tx, nSize, nClusterCount, nClusterSize);
+        size_t nLimitCluster = gArgs.GetArg("-limitclustercount", DEFAULT_CLUSTER_LIMIT);
+        if (nClusterCount > nLimitCluster) {
+            std::string errString = strprintf("too many transactions in cluster [%u > %u]", nClusterCount, nLimitCluster);
+            LogPrintf("%s - %s\n", __func__, errString);
+            return state.DoS(0, false, REJECT_NONSTANDARD, "too-large-cluster", false, errString);
+        }
+
         // Calculate in-mempool ancestors, up to a limit.
         CTxMemPool::setEntries setAncestors;
         size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
@@ -1113,7 +1142,7 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
     if (!fTimestampIndex)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes))
+    if (!g_timestampindex->ReadTimestampIndex(high, low, fActiveOnly, hashes))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -1127,7 +1156,7 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!g_spentindex->ReadSpentIndex(key, value))
         return false;
 
     return true;
@@ -1135,9 +1164,9 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 
 bool HashOnchainActive(const uint256 &hash)
 {
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
 
-    if (!chainActive.Contains(pblockindex)) {
+    if (it == mapBlockIndex.end() || !chainActive.Contains(it->second)) {
         return false;
     }
 
@@ -1150,7 +1179,7 @@ bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end))
+    if (!g_addressindex->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end))
         return error("unable to get txids for address");
 
     return true;
@@ -1162,7 +1191,7 @@ bool GetAddressIndex(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!g_addressindex->ReadAddressIndex(addressHash, type, addressIndex, start, end))
         return error("unable to get txids for address");
 
     return true;
@@ -1174,7 +1203,7 @@ bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs))
+    if (!g_addressindex->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
@@ -1186,7 +1215,7 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!g_addressindex->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
@@ -1271,7 +1300,57 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
 // CBlock and CBlockIndex
 //
 
-bool CheckProofOfWork(const CBlockHeader& block, const Consensus::Params& params)
+/**
+ * Cache of auxpow headers whose proof of work has been verified. A merge-mined
+ * block is checked when its header arrives, again by CheckBlock and again in
+ * AcceptBlock, and pools tend to send them in bursts. The scrypt hashes of the
+ * header and of its parent block dominate every one of these checks.
+ */
+class CAuxPowCheckCache
+{
+private:
+    //! Entries are Hash(nonce || serialized header), which covers the whole auxpow
+    uint256 nonce;
+    CuckooCache::cache<uint256, SignatureCacheHasher> setValid;
+    boost::shared_mutex cs_auxpowcache;
+
+    uint256 ComputeEntry(const CBlockHeader& block) const
+    {
+        CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+        ss << nonce << block;
+        return ss.GetHash();
+    }
+
+public:
+    CAuxPowCheckCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(AUXPOW_CHECK_CACHE_SIZE);
+    }
+
+    bool Contains(const CBlockHeader& block)
+    {
+        const uint256 entry = ComputeEntry(block);
+        boost::shared_lock<boost::shared_mutex> lock(cs_auxpowcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Insert(const CBlockHeader& block)
+    {
+        uint256 entry = ComputeEntry(block);
+        boost::unique_lock<boost::shared_mutex> lock(cs_auxpowcache);
+        setValid.insert(entry);
+    }
+};
+
+static CAuxPowCheckCache auxpowCheckCache;
+
+/**
+ * Check the proof of work of a header. phashParentPoW, if given, is the
+ * already computed scrypt hash of the auxpow parent block; callers that pass
+ * it have already looked the header up in auxpowCheckCache.
+ */
+static bool CheckProofOfWork(const CBlockHeader& block, const Consensus::Params& params, const uint256* phashParentPoW)
 {
     /* Except for legacy blocks with full version 1, ensure that
        the chain ID is correct.  Legacy blocks are not allowed since
@@ -1310,14 +1389,25 @@ bool CheckProofOfWork(const CBlockHeader& block, const Consensus::Params& params
     if (!block.nVersion.IsAuxpow())
         return error("%s : auxpow on block with non-auxpow version", __func__);
 
+    if (!phashParentPoW && auxpowCheckCache.Contains(block))
+        return true;
+
     if (!block.auxpow->check(block.GetHash(), block.nVersion.GetChainId(), params))
         return error("%s : AUX POW is not valid", __func__);
 
-    if (!CheckProofOfWork(block.auxpow->getParentBlockHash(), block.nBits, block.nVersion.GetAlgo(), params))
+    const uint256 hashParentPoW = phashParentPoW ? *phashParentPoW : block.auxpow->getParentBlockHash();
+    if (!CheckProofOfWork(hashParentPoW, block.nBits, block.nVersion.GetAlgo(), params))
         return error("%s : AUX proof of work failed", __func__);
+
+    auxpowCheckCache.Insert(block);
     return true;
 }
 
+bool CheckProofOfWork(const CBlockHeader& block, const Consensus::Params& params)
+{
+    return CheckProofOfWork(block, params, nullptr);
+}
+
 static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
@@ -1366,12 +1456,34 @@ static bool ReadBlockOrHeader(T& block, const CDiskBlockPos& pos, const Consensu
     return true;
 }
 
+/** The block index hash is computed from the same header fields it stores, so
+ *  a header whose serialized fields all match the index has the index hash.
+ *  Comparing the fields avoids rehashing (X16R/KAWPOW) every block read from disk.
+ *  Auxpow headers are always rehashed since the index does not keep their auxpow. */
+static bool HeaderMatchesIndex(const CBlockHeader& block, const CBlockIndex* pindex)
+{
+    if (block.nVersion.IsAuxpow() || pindex->nVersion.IsAuxpow())
+        return false;
+    const uint256 hashPrev = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256();
+    if (block.nVersion.GetFullVersion() != pindex->nVersion.GetFullVersion() ||
+            block.hashPrevBlock != hashPrev ||
+            block.hashMerkleRoot != pindex->hashMerkleRoot ||
+            block.nTime != pindex->nTime ||
+            block.nBits != pindex->nBits)
+        return false;
+    if (block.nTime < nKAWPOWActivationTime)
+        return block.nNonce == pindex->nNonce;
+    return block.nHeight == (uint32_t)pindex->nHeight &&
+           block.nNonce64 == pindex->nNonce64 &&
+           block.mix_hash == pindex->mix_hash;
+}
+
 template<typename T>
 static bool ReadBlockOrHeader(T& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     if (!ReadBlockOrHeader(block, pindex->GetBlockPos(), consensusParams))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash())
+    if (!HeaderMatchesIndex(block, pindex) && block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                 pindex->ToString(), pindex->GetBlockPos().ToString());
     return true;
@@ -1886,7 +1998,7 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out, CAss
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAssetsCache* assetsCache = nullptr, bool ignoreAddressIndex = false, bool databaseMessaging = true)
+static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAssetsCache* assetsCache = nullptr, bool databaseMessaging = true, CUTXOStats* pstatsDelta = nullptr)
 {
     bool fClean = true;
 
@@ -1912,10 +2024,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
         return DISCONNECT_FAILED;
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     // undo transactions in reverse order
     CAssetsCache tempCache(*assetsCache);
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
@@ -1925,61 +2033,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
 
         std::vector<int> vAssetTxIndex;
         std::vector<int> vNullAssetTxIndex;
-        if (fAddressIndex) {
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, k), CAddressUnspentValue()));
-                } else {
-                    /** MEWC START */
-                    if (AreAssetsDeployed()) {
-                        std::string assetName;
-                        CAmount assetAmount;
-                        uint160 hashBytes;
-
-                        if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << hash.GetHex() << ", " << k << ", " << "true" << ", " << assetAmount << std::endl;
-
-                            // undo receiving activity
-                            addressIndex.push_back(std::make_pair(
-                                    CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, k,
-                                                     false), assetAmount));
-
-                            // undo unspent index
-                            addressUnspentIndex.push_back(
-                                    std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetName, hash, k),
-                                                   CAddressUnspentValue()));
-                        } else {
-                            continue;
-                        }
-                    }
-                    /** MEWC END */
-                }
-            }
-        }
-
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
         int indexOfRestrictedAssetVerifierString = -1;
@@ -1991,6 +2044,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 if (!is_spent || tx.vout[o] != coin.out || pindex->nHeight != coin.nHeight || is_coinbase != coin.fCoinBase) {
                     fClean = false; // transaction output mismatch
                 }
+                if (is_spent && pstatsDelta) {
+                    pstatsDelta->RemoveCoin(out, coin);
+                }
 
                 /** MEWC START */
                 if (AreAssetsDeployed()) {
@@ -2247,66 +2303,8 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 int res = ApplyTxInUndo(std::move(undo), view, out, assetsCache); /** MEWC START */ /* Pass assetsCache into ApplyTxInUndo function */ /** MEWC END */
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                const CTxIn input = tx.vin[j];
-
-                if (fSpentIndex) {
-                    // undo and delete the spent index
-                    spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
-                }
-
-                if (fAddressIndex) {
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
-
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, false), prevout.nValue));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
-                    } else {
-                        /** MEWC START */
-                        if (AreAssetsDeployed()) {
-                            std::string assetName;
-                            CAmount assetAmount;
-                            uint160 hashBytes;
-
-                            if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                                std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                          << ", " << i << ", " << hash.GetHex() << ", " << j << ", " << "true" << ", " << assetAmount * -1 << std::endl;
-
-                                // undo spending activity
-                                addressIndex.push_back(std::make_pair(
-                                        CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, j,
-                                                         true), assetAmount * -1));
-
-                                // restore unspent index
-                                addressUnspentIndex.push_back(std::make_pair(
-                                        CAddressUnspentKey(1, uint160(hashBytes), assetName, input.prevout.hash,
-                                                           input.prevout.n),
-                                        CAddressUnspentValue(assetAmount, prevout.scriptPubKey, undo.nHeight)));
-                            } else {
-                                continue;
-                            }
-                        }
-                        /** MEWC END */
-                    }
+                if (pstatsDelta) {
+                    pstatsDelta->AddCoin(out, view.AccessCoin(out));
                 }
             }
             // At this point, all of txundo.vprevout should have been moved out.
@@ -2317,17 +2315,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            error("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            error("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -2363,6 +2350,77 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Closure representing the context-free proof of work check of a few headers.
+ * The scrypt parent blocks of the auxpow headers among them are hashed
+ * together, so that the multi-lane scrypt kernel can be used. The results are
+ * stored instead of returned, so that a bad header does not stop the queue
+ * from checking the rest of the batch.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const Consensus::Params *pparams;
+    std::vector<std::pair<const CBlockHeader*, char*>> vHeaders;
+
+public:
+    CHeaderPoWCheck(): pparams(nullptr) {}
+    explicit CHeaderPoWCheck(const Consensus::Params& paramsIn) : pparams(&paramsIn) { }
+
+    void Add(const CBlockHeader& header, char* pfValid) {
+        vHeaders.emplace_back(&header, pfValid);
+    }
+
+    size_t size() const { return vHeaders.size(); }
+
+    bool operator()() {
+        // The parent block hash is the scrypt hash of its 80 header bytes,
+        // see CPureBlockHeader::GetHash(). Headers that were already checked
+        // need neither.
+        std::vector<char> vParents;
+        std::vector<bool> vCached(vHeaders.size(), false);
+        for (size_t i = 0; i < vHeaders.size(); i++) {
+            const CBlockHeader& header = *vHeaders[i].first;
+            if (!header.auxpow)
+                continue;
+            if (auxpowCheckCache.Contains(header)) {
+                vCached[i] = true;
+                continue;
+            }
+            const char* pbegin = BEGIN(header.auxpow->parentBlock.nVersion);
+            vParents.insert(vParents.end(), pbegin, pbegin + 80);
+        }
+        std::vector<uint256> vParentHashes(vParents.size() / 80);
+        if (!vParentHashes.empty())
+            scrypt_1024_1_1_256_batch(vParents.data(), BEGIN(vParentHashes[0]), vParentHashes.size());
+
+        size_t nParent = 0;
+        for (size_t i = 0; i < vHeaders.size(); i++) {
+            const CBlockHeader& header = *vHeaders[i].first;
+            if (vCached[i]) {
+                *vHeaders[i].second = true;
+                continue;
+            }
+            const uint256* phashParentPoW = header.auxpow ? &vParentHashes[nParent++] : nullptr;
+            *vHeaders[i].second = CheckProofOfWork(header, *pparams, phashParentPoW);
+        }
+        return true;
+    }
+
+    void swap(CHeaderPoWCheck &check) {
+        std::swap(pparams, check.pparams);
+        vHeaders.swap(check.vHeaders);
+    }
+};
+
+// Each KAWPOW/MEOWPOW check is a full progpow evaluation, keep batches small.
+static CCheckQueue<CHeaderPoWCheck> headerpowcheckqueue(8);
+
+void ThreadHeaderPoWCheck() {
+    RenameThread("meowcoin-headerpow");
+    headerpowcheckqueue.Thread();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2461,7 +2519,7 @@ static int64_t nBlocksTotal = 0;
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, CAssetsCache* assetsCache = nullptr, bool fJustCheck = false, bool ignoreAddressIndex = false)
+                  CCoinsViewCache& view, const CChainParams& chainparams, CAssetsCache* assetsCache = nullptr, bool fJustCheck = false, CUTXOStats* pstatsDelta = nullptr)
 {
 
     AssertLockHeld(cs_main);
@@ -2584,10 +2642,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     std::set<CMessage> setMessages;
     std::vector<std::pair<std::string, CNullAssetTxData>> myNullAssetData;
     for (unsigned int i = 0; i < block.vtx.size(); i++)
@@ -2642,72 +2696,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    uint160 hashBytes;
-                    int addressType = 0;
-                    bool isAsset = false;
-                    std::string assetName;
-                    CAmount assetAmount;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin() + 1, prevout.scriptPubKey.end() - 1);
-                        addressType = 1;
-                    } else {
-                        /** MEWC START */
-                        if (AreAssetsDeployed()) {
-                            hashBytes.SetNull();
-                            addressType = 0;
-
-                            if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                                addressType = 1;
-                                isAsset = true;
-                            }
-                        }
-                        /** MEWC END */
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        /** MEWC START */
-                        if (isAsset) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << j << ", " << "true" << ", " << assetAmount * -1 << std::endl;
-
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, pindex->nHeight, i, txhash, j, true), assetAmount * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        /** MEWC END */
-                        } else {
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        }
-                    }
-                    /** MEWC END */
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2730,66 +2718,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             control.Add(vChecks);
         }
 
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1));
-                    addressIndex.push_back(
-                            std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false),
-                                           out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k),
-                                                                 CAddressUnspentValue(out.nValue, out.scriptPubKey,
-                                                                                      pindex->nHeight)));
-                } else {
-                    /** MEWC START */
-                    if (AreAssetsDeployed()) {
-                        std::string assetName;
-                        CAmount assetAmount;
-                        uint160 hashBytes;
-
-                        if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << k << ", " << "true" << ", " << assetAmount << std::endl;
-
-                            // record receiving activity
-                            addressIndex.push_back(std::make_pair(
-                                    CAddressIndexKey(1, hashBytes, assetName, pindex->nHeight, i, txhash, k, false),
-                                    assetAmount));
-
-                            // record unspent output
-                            addressUnspentIndex.push_back(
-                                    std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, txhash, k),
-                                                   CAddressUnspentValue(assetAmount, out.scriptPubKey,
-                                                                        pindex->nHeight)));
-                        }
-                    } else {
-                        continue;
-                    }
-                    /** MEWC END */
-                }
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -2802,6 +2730,22 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight, block.GetHash(), assetsCache, undoAssetData);
 
+        if (pstatsDelta) {
+            if (i > 0) {
+                const CTxUndo& txundo = blockundo.vtxundo.back();
+                for (size_t j = 0; j < tx.vin.size(); j++) {
+                    pstatsDelta->RemoveCoin(tx.vin[j].prevout, txundo.vprevout[j]);
+                }
+            }
+            for (size_t o = 0; o < tx.vout.size(); o++) {
+                const COutPoint out(tx.GetHash(), o);
+                const Coin& coin = view.AccessCoin(out);
+                if (!coin.IsSpent()) {
+                    pstatsDelta->AddCoin(out, coin);
+                }
+            }
+        }
+
         /** MEWC START */
         if (!undoAssetData->first.empty()) {
             vUndoAssetData.emplace_back(*undoAssetData);
@@ -2893,41 +2837,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
-    if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-
-    if (!ignoreAddressIndex && fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (!ignoreAddressIndex && fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-        }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
-    }
-
     if (AreMessagesDeployed() && fMessaging && setMessages.size()) {
         LOCK(cs_messaging);
         for (auto message : setMessages) {
@@ -3086,9 +2995,13 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
-            // Finally remove any pruned files
-            if (fFlushForPrune)
+            // Finally remove any pruned files, once no coins written in the
+            // background can still need them to be replayed after a crash.
+            if (fFlushForPrune) {
+                if (!pcoinsdbview->WaitForWrite())
+                    return AbortNode(state, "Failed to write to coin database");
                 UnlinkPrunedFiles(setFilesToPrune);
+            }
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -3104,8 +3017,24 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 return state.Error("out of disk space");
 
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // Unless we are shutting down, pruning or asked to flush, let a
+            // writer thread commit the coins while we carry on.
+            const bool fWriteBehind = fAsyncFlush && mode != FLUSH_STATE_ALWAYS && !fFlushForPrune;
+            pcoinsdbview->SetWriteBehind(fWriteBehind);
+            const bool fFlushed = pcoinsTip->Flush();
+            pcoinsdbview->SetWriteBehind(false);
+            InvalidatePrefetchedCoins();
+            if (!fFlushed)
                 return AbortNode(state, "Failed to write to coin database");
+            if (!fWriteBehind && !pcoinsdbview->WaitForWrite())
+                return AbortNode(state, "Failed to write to coin database");
+
+            // Store the UTXO set stats of the block just flushed, so they survive a restart.
+            if (fUTXOStatsKnown && utxoStatsTip.hashBlock == pcoinsdbview->GetBestBlock() && utxoStatsTip.hashBlock != hashUTXOStatsOnDisk) {
+                if (!pcoinsdbview->WriteUTXOStats(utxoStatsTip, hashUTXOStatsOnDisk))
+                    return AbortNode(state, "Failed to write UTXO set stats");
+                hashUTXOStatsOnDisk = utxoStatsTip.hashBlock;
+            }
 
             /** MEWC START */
             // Flush the assetstate
@@ -3230,6 +3159,21 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
 
 }
 
+/** Move the running UTXO set stats from hashFrom to hashTo by applying delta. */
+static void UpdateTipUTXOStats(const uint256& hashFrom, const uint256& hashTo, const CUTXOStats& delta)
+{
+    AssertLockHeld(cs_main);
+    if (!fUTXOStatsKnown)
+        return;
+    if (utxoStatsTip.hashBlock != hashFrom) {
+        LogPrintf("%s: UTXO set stats are at %s, not %s; they will be recomputed on demand\n", __func__, utxoStatsTip.hashBlock.ToString(), hashFrom.ToString());
+        fUTXOStatsKnown = false;
+        return;
+    }
+    utxoStatsTip += delta;
+    utxoStatsTip.hashBlock = hashTo;
+}
+
 /** Disconnect chainActive's tip.
   * After calling, the mempool will be in an inconsistent state, with
   * transactions from disconnected blocks being added to disconnectpool.  You
@@ -3255,11 +3199,14 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
         CCoinsViewCache view(pcoinsTip);
         CAssetsCache assetCache;
 
+        CUTXOStats statsDelta;
+
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view, &assetCache) != DISCONNECT_OK)
+        if (DisconnectBlock(block, pindexDelete, view, &assetCache, true, fUTXOStatsKnown ? &statsDelta : nullptr) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
+        UpdateTipUTXOStats(pindexDelete->GetBlockHash(), pindexDelete->pprev->GetBlockHash(), statsDelta);
 
         bool assetsFlushed = assetCache.Flush();
         assert(assetsFlushed);
@@ -3396,6 +3343,9 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     ConnectedBlockAssetData assetDataFromBlock;
     /** MEWC END */
 
+    // Pick up the coins the prefetch threads looked up for this block.
+    ApplyPrefetchedCoins(pindexNew->GetBlockHash());
+
     {
         CCoinsViewCache view(pcoinsTip);
         /** MEWC START */
@@ -3408,7 +3358,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
 
         int64_t nTimeConnectStart = GetTimeMicros();
 
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, &assetCache);
+        CUTXOStats statsDelta;
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, &assetCache, false, fUTXOStatsKnown ? &statsDelta : nullptr);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -3440,6 +3391,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
         assert(flushed);
+        UpdateTipUTXOStats(pindexNew->pprev ? pindexNew->pprev->GetBlockHash() : uint256(), pindexNew->GetBlockHash(), statsDelta);
         nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
         LogPrint(BCLog::BENCH, "  - Flush MEWC: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
 
@@ -3617,6 +3569,15 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
         }
         nHeight = nTargetHeight;
 
+        // Look up the coins spent by the next blocks in the background,
+        // while the first ones are connected.
+        int nPrefetch = 0;
+        for (CBlockIndex *pindexPrefetch : reverse_iterate(vpindexToConnect)) {
+            if (nPrefetch++ == COIN_PREFETCH_BLOCKS)
+                break;
+            PrefetchBlockCoins(pindexPrefetch, pindexPrefetch == pindexMostWork ? pblock : std::shared_ptr<const CBlock>());
+        }
+
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
@@ -3893,7 +3854,8 @@ static CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = blockIndexArena.Alloc();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -4077,18 +4039,9 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fDBCheck)
+/** The context-free checks of a block that do not involve its header. */
+static bool CheckBlockContents(const CBlock& block, CValidationState& state, bool fCheckMerkleRoot, bool fDBCheck)
 {
-    // These are checks that are independent of context.
-
-    if (block.fChecked)
-        return true;
-
-    // Check that the header is valid (particularly PoW).  This is mostly
-    // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
-        return error("%s: Consensus::CheckBlockHeader: %s", __func__, FormatStateMessage(state));
-
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -4150,6 +4103,45 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
 
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fDBCheck)
+{
+    // These are checks that are independent of context.
+
+    if (block.fChecked)
+        return true;
+
+    // Check that the header is valid (particularly PoW).  This is mostly
+    // redundant with the call in AcceptBlockHeader. The auxpow check of a
+    // merge-mined block runs on the header check threads while the rest of
+    // the block is checked.
+    const bool fAsyncPoW = fCheckPOW && block.auxpow && nScriptCheckThreads;
+    char fPoWValid = 0;
+    CCheckQueueControl<CHeaderPoWCheck> control(fAsyncPoW ? &headerpowcheckqueue : nullptr);
+    if (fAsyncPoW) {
+        std::vector<CHeaderPoWCheck> vChecks(1, CHeaderPoWCheck(consensusParams));
+        vChecks[0].Add(block, &fPoWValid);
+        control.Add(vChecks);
+    } else if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
+        return error("%s: Consensus::CheckBlockHeader: %s", __func__, FormatStateMessage(state));
+
+    const bool fContentsValid = CheckBlockContents(block, state, fCheckMerkleRoot, fDBCheck);
+
+    if (fAsyncPoW) {
+        control.Wait();
+        // A bad proof of work is reported ahead of any other error, as if it
+        // had been checked first. Check again to get its error message.
+        CValidationState statePoW;
+        if (!fPoWValid && !CheckBlockHeader(block, statePoW, consensusParams, fCheckPOW)) {
+            state = statePoW;
+            return error("%s: Consensus::CheckBlockHeader: %s", __func__, FormatStateMessage(state));
+        }
+    }
+    if (!fContentsValid)
+        return false;
+
     if (fCheckPOW && fCheckMerkleRoot)
         block.fChecked = true;
 
@@ -4380,11 +4372,11 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+/** hash must be block.GetHash(); callers that already have it pass it in to avoid rehashing. */
+static bool AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW = true)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -4399,7 +4391,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPOW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -4439,15 +4431,67 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     return true;
 }
 
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+{
+    return AcceptBlockHeader(block, block.GetHash(), state, chainparams, ppindex);
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+
+        // The proof of work of a header does not depend on its ancestors, so
+        // check the new headers on the worker threads first. Headers that fail
+        // are checked again below to report the error in order.
+        std::vector<uint256> vHashes;
+        vHashes.reserve(headers.size());
+        for (const CBlockHeader& header : headers)
+            vHashes.push_back(header.GetHash());
+
+        std::vector<char> vPoWValid(headers.size(), 0);
+        if (headers.size() > 1) {
+            // Auxpow headers are grouped so that their parent blocks are
+            // hashed by the multi-lane scrypt kernel.
+            const Consensus::Params& consensusParams = chainparams.GetConsensus();
+            std::vector<CHeaderPoWCheck> vChecks;
+            CHeaderPoWCheck auxpowCheck(consensusParams);
+            for (size_t i = 0; i < headers.size(); i++) {
+                if (mapBlockIndex.count(vHashes[i]))
+                    continue;
+                if (headers[i].auxpow) {
+                    auxpowCheck.Add(headers[i], &vPoWValid[i]);
+                    if (auxpowCheck.size() == SCRYPT_BATCH_MAX_WAYS) {
+                        vChecks.emplace_back();
+                        vChecks.back().swap(auxpowCheck);
+                        auxpowCheck = CHeaderPoWCheck(consensusParams);
+                    }
+                } else {
+                    vChecks.emplace_back(consensusParams);
+                    vChecks.back().Add(headers[i], &vPoWValid[i]);
+                }
+            }
+            if (auxpowCheck.size()) {
+                vChecks.emplace_back();
+                vChecks.back().swap(auxpowCheck);
+            }
+
+            if (nScriptCheckThreads) {
+                CCheckQueueControl<CHeaderPoWCheck> control(&headerpowcheckqueue);
+                control.Add(vChecks);
+                control.Wait();
+            } else {
+                for (CHeaderPoWCheck& check : vChecks)
+                    check();
+            }
+        }
+
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(header, vHashes[i], state, chainparams, &pindex, !vPoWValid[i])) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -4826,16 +4870,26 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = blockIndexArena.Alloc();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
     return pindexNew;
 }
 
+/** Add an entry loaded by LoadBlockIndexGuts, or with pindex null, look up a hash like InsertBlockIndex */
+static CBlockIndex* InsertLoadedBlockIndex(const uint256& hash, CBlockIndex* pindex)
+{
+    if (!pindex)
+        return InsertBlockIndex(hash);
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindex)).first;
+    pindex->phashBlock = &((*mi).first);
+    return pindex;
+}
+
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
-    if (!pblocktree->LoadBlockIndexGuts(chainparams.GetConsensus(), InsertBlockIndex))
+    if (!pblocktree->LoadBlockIndexGuts(chainparams.GetConsensus(), blockIndexArena, InsertLoadedBlockIndex))
         return false;
 
     boost::this_thread::interruption_point();
@@ -4934,17 +4988,6 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("assetindex", fAssetIndex);
     LogPrintf("%s: asset index %s\n", __func__, fAssetIndex ? "enabled" : "disabled");
 
-    // Check whether we have an address index
-    pblocktree->ReadFlag("addressindex", fAddressIndex);
-    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
-    // Check whether we have a timestamp index
-    pblocktree->ReadFlag("timestampindex", fTimestampIndex);
-    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-    // Check whether we have a spent index
-    pblocktree->ReadFlag("spentindex", fSpentIndex);
-    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
     return true;
 }
 
@@ -4977,6 +5020,46 @@ bool LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+void LoadUTXOStats()
+{
+    LOCK(cs_main);
+    utxoStatsTip = CUTXOStats();
+    fUTXOStatsKnown = false;
+    hashUTXOStatsOnDisk.SetNull();
+    if (!fUTXOStats)
+        return;
+
+    const uint256 hashBestBlock = pcoinsTip->GetBestBlock();
+    if (hashBestBlock.IsNull()) {
+        // An empty coin database has empty stats.
+        fUTXOStatsKnown = true;
+    } else if (pcoinsdbview->ReadUTXOStats(hashBestBlock, utxoStatsTip) && utxoStatsTip.hashBlock == hashBestBlock) {
+        fUTXOStatsKnown = true;
+        hashUTXOStatsOnDisk = hashBestBlock;
+    } else {
+        utxoStatsTip = CUTXOStats();
+        LogPrintf("%s: no UTXO set stats stored for %s; they will be recomputed on demand\n", __func__, hashBestBlock.ToString());
+    }
+}
+
+bool GetTipUTXOStats(CUTXOStats& stats)
+{
+    LOCK(cs_main);
+    if (!fUTXOStatsKnown)
+        return false;
+    stats = utxoStatsTip;
+    return true;
+}
+
+void SeedTipUTXOStats(const CUTXOStats& stats)
+{
+    LOCK(cs_main);
+    if (!fUTXOStats || fUTXOStatsKnown || stats.hashBlock != pcoinsTip->GetBestBlock())
+        return;
+    utxoStatsTip = stats;
+    fUTXOStatsKnown = true;
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0, false);
@@ -5048,7 +5131,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = DisconnectBlock(block, pindex, coins, &assetCache, true, false);
+            DisconnectResult res = DisconnectBlock(block, pindex, coins, &assetCache, false);
             if (res == DISCONNECT_FAILED) {
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             }
@@ -5076,7 +5159,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             CBlock block;
             if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
                 return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins, chainparams, &assetCache, false, true))
+            if (!ConnectBlock(block, state, pindex, coins, chainparams, &assetCache, false))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         }
     }
@@ -5292,10 +5375,8 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
     fHavePruned = false;
 }
 
@@ -5328,21 +5409,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         pblocktree->WriteFlag("assetindex", fAssetIndex);
         LogPrintf("%s: asset index %s\n", __func__, fAssetIndex ? "enabled" : "disabled");
 
-        // Use the provided setting for -addressindex in the new database
-        fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
-        pblocktree->WriteFlag("addressindex", fAddressIndex);
-        LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
-        // Use the provided setting for -timestampindex in the new database
-        fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-        pblocktree->WriteFlag("timestampindex", fTimestampIndex);
-        LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-        // Use the provided setting for -spentindex in the new database
-        fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
-        pblocktree->WriteFlag("spentindex", fSpentIndex);
-        LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
-
     }
     return true;
 }
@@ -5711,7 +5777,45 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(chainActive.Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_CHECKSUM = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+//! Maximum number of transactions loaded from mempool.dat per cs_main lock
+static const unsigned int MEMPOOL_LOAD_BATCH_SIZE = 500;
+
+/** A transaction read from mempool.dat */
+struct CMempoolDumpEntry {
+    CTransactionRef tx;
+    int64_t nTime;
+    uint64_t nCountWithAncestors;
+};
+
+/**
+ * Check the checksum at the end of a mempool.dat file, which covers everything
+ * before it, and return to the current position.
+ */
+static bool CheckMempoolChecksum(CAutoFile& file)
+{
+    FILE* f = file.Get();
+    long nPos = ftell(f);
+    if (nPos < 0 || fseek(f, 0, SEEK_END) != 0)
+        return false;
+    long nEnd = ftell(f) - (long)sizeof(uint256);
+    if (nEnd < nPos || fseek(f, 0, SEEK_SET) != 0)
+        return false;
+
+    CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+    std::vector<char> buf(1 << 16);
+    for (long nLeft = nEnd; nLeft > 0;) {
+        size_t nRead = std::min<long>(nLeft, buf.size());
+        if (fread(buf.data(), 1, nRead, f) != nRead)
+            return false;
+        hasher.write(buf.data(), nRead);
+        nLeft -= nRead;
+    }
+    uint256 hashChecksum;
+    file >> hashChecksum;
+    return fseek(f, nPos, SEEK_SET) == 0 && hashChecksum == hasher.GetHash();
+}
 
 bool LoadMempool(void)
 {
@@ -5730,51 +5834,107 @@ bool LoadMempool(void)
     int64_t already_there = 0;
     int64_t nNow = GetTime();
 
+    // Transactions are loaded in batches of ones with the same number of
+    // ancestors, which cannot depend on each other. The scripts of a batch
+    // are checked by the script check threads first, filling the signature
+    // cache, and then the batch is accepted under a single cs_main lock.
+    std::vector<CMempoolDumpEntry> vBatch;
+    auto loadBatch = [&]() {
+        if (nScriptCheckThreads) {
+            std::vector<PrecomputedTransactionData> vTxData;
+            std::vector<CScriptCheck> vChecks;
+            vTxData.reserve(vBatch.size());
+            {
+                LOCK(cs_main);
+                for (const CMempoolDumpEntry& entry : vBatch) {
+                    const CTransaction& tx = *entry.tx;
+                    vTxData.emplace_back(tx);
+                    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+                        const COutPoint& prevout = tx.vin[i].prevout;
+                        CTransactionRef parent = mempool.get(prevout.hash);
+                        CTxOut out;
+                        if (parent) {
+                            if (prevout.n < parent->vout.size())
+                                out = parent->vout[prevout.n];
+                        } else {
+                            out = pcoinsTip->AccessCoin(prevout).out;
+                        }
+                        if (!out.IsNull())
+                            vChecks.emplace_back(out, tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, true /* cacheStore */, &vTxData.back());
+                    }
+                }
+            }
+            // The outcome is left to AcceptToMemoryPool, which checks every
+            // script again, now mostly against the cache
+            CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+            control.Add(vChecks);
+            control.Wait();
+        }
+
+        LOCK(cs_main);
+        for (const CMempoolDumpEntry& entry : vBatch) {
+            CValidationState state;
+            AcceptToMemoryPoolWithTime(chainparams, mempool, state, entry.tx, nullptr /* pfMissingInputs */, entry.nTime,
+                                       nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
+                                       false /* test_accept */);
+            if (state.IsValid()) {
+                ++count;
+            } else {
+                // mempool may contain the transaction already, e.g. from
+                // wallet(s) having loaded it while we were processing
+                // mempool transactions; consider these as valid, instead of
+                // failed, but mark them as 'already there'
+                if (mempool.exists(entry.tx->GetHash())) {
+                    ++already_there;
+                } else {
+                    ++failed;
+                }
+            }
+        }
+        vBatch.clear();
+    };
+
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_NO_CHECKSUM) {
+            return false;
+        }
+        const bool fHasChecksum = version == MEMPOOL_DUMP_VERSION;
+        if (fHasChecksum && !CheckMempoolChecksum(file)) {
+            LogPrintf("Failed to verify mempool file checksum. Continuing anyway.\n");
             return false;
         }
         uint64_t num;
         file >> num;
         while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
+            CMempoolDumpEntry entry;
             int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
+            file >> entry.tx;
+            file >> entry.nTime;
             file >> nFeeDelta;
+            if (fHasChecksum) {
+                file >> entry.nCountWithAncestors;
+            } else {
+                entry.nCountWithAncestors = 0;
+            }
 
             CAmount amountdelta = nFeeDelta;
             if (amountdelta) {
-                mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                mempool.PrioritiseTransaction(entry.tx->GetHash(), amountdelta);
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
-                                           false /* test_accept */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (mempool.exists(tx->GetHash())) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
+            if (entry.nTime + nExpiryTimeout > nNow) {
+                if (!vBatch.empty() && (vBatch.size() >= MEMPOOL_LOAD_BATCH_SIZE || vBatch.back().nCountWithAncestors != entry.nCountWithAncestors)) {
+                    loadBatch();
+                    if (ShutdownRequested())
+                        return false;
                 }
+                vBatch.push_back(std::move(entry));
             } else {
                 ++expired;
             }
-            if (ShutdownRequested())
-                return false;
         }
+        loadBatch();
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
 
@@ -5790,6 +5950,14 @@ bool LoadMempool(void)
     return true;
 }
 
+/** Write obj to file and add it to hasher */
+template <typename T>
+static void WriteHashed(CAutoFile& file, CHashWriter& hasher, const T& obj)
+{
+    file << obj;
+    hasher << obj;
+}
+
 bool DumpMempool(void)
 {
     int64_t start = GetTimeMicros();
@@ -5814,19 +5982,22 @@ bool DumpMempool(void)
         }
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        CHashWriter hasher(SER_DISK, CLIENT_VERSION);
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
-        file << version;
+        WriteHashed(file, hasher, version);
 
-        file << (uint64_t)vinfo.size();
+        WriteHashed(file, hasher, (uint64_t)vinfo.size());
         for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
+            WriteHashed(file, hasher, *(i.tx));
+            WriteHashed(file, hasher, (int64_t)i.nTime);
+            WriteHashed(file, hasher, (int64_t)i.nFeeDelta);
+            WriteHashed(file, hasher, (uint64_t)i.nCountWithAncestors);
             mapDeltas.erase(i.tx->GetHash());
         }
 
-        file << mapDeltas;
+        WriteHashed(file, hasher, mapDeltas);
+        file << hasher.GetHash();
         FileCommit(file.Get());
         file.fclose();
         RenameOver(GetDataDir() / "mempool.dat.new", GetDataDir() / "mempool.dat");
@@ -5972,10 +6143,7 @@ class CMainCleanup
 public:
     CMainCleanup() {}
     ~CMainCleanup() {
-        // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
+        // block headers, freed with blockIndexArena
         mapBlockIndex.clear();
     }
 } instance_of_cmaincleanup;
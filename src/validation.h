@@ -72,6 +72,8 @@ static const unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = 250;
 static const unsigned int DEFAULT_DESCENDANT_LIMIT = 200;
 /** Default for -limitdescendantsize, maximum kilobytes of in-mempool descendants */
 static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 250;
+/** Default for -limitclustercount, max number of transactions in a mempool cluster */
+static const unsigned int DEFAULT_CLUSTER_LIMIT = 250;
 /** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
 static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
 /** Maximum kilobytes for transactions to store for processing during reorg */
@@ -83,6 +85,8 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
+/** Size in bytes of the cache of auxpow headers whose proof of work has been verified */
+static const unsigned int AUXPOW_CHECK_CACHE_SIZE = 0x40000; // 256 KiB
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
@@ -157,9 +161,14 @@ static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
 static const bool DEFAULT_ASSETINDEX = false;
 static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_ADDRESSSUMMARYINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
 static const bool DEFAULT_REWARDS_ENABLED = false;
+/** Default for -utxostats */
+static const bool DEFAULT_UTXOSTATS = false;
+/** Default for -asyncflush */
+static const bool DEFAULT_ASYNC_FLUSH = false;
 /** Default for -dbmaxfilesize , in MB */
 static const int64_t DEFAULT_DB_MAX_FILE_SIZE = 2;
 
@@ -205,8 +214,11 @@ extern int nScriptCheckThreads;
 extern bool fTxIndex;
 extern bool fAssetIndex;
 extern bool fAddressIndex;
+extern bool fAddressSummaryIndex;
 extern bool fSpentIndex;
 extern bool fTimestampIndex;
+extern bool fUTXOStats;
+extern bool fAsyncFlush;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
@@ -309,10 +321,18 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 bool LoadBlockIndex(const CChainParams& chainparams);
 /** Update the chain tip based on database information. */
 bool LoadChainTip(const CChainParams& chainparams);
+/** Load the running UTXO set stats for the best block of pcoinsTip. */
+void LoadUTXOStats();
+/** Get the running UTXO set stats at the chain tip. Returns false if they are not known. */
+bool GetTipUTXOStats(CUTXOStats& stats);
+/** Start keeping running stats again from a full scan of the UTXO set at stats.hashBlock. */
+void SeedTipUTXOStats(const CUTXOStats& stats);
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header proof of work checking thread */
+void ThreadHeaderPoWCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 bool IsInitialSyncSpeedUp();
@@ -557,12 +557,8 @@ BOOST_FIXTURE_TEST_SUITE(wallet_tests, WalletTestingSetup)
         CBlockIndex *block = nullptr;
         if (blockTime > 0)
         {
-            auto inserted = mapBlockIndex.emplace(GetRandHash(), new CBlockIndex);
-            assert(inserted.second);
-            const uint256 &hash = inserted.first->first;
-            block = inserted.first->second;
+            block = InsertBlockIndex(GetRandHash());
             block->nTime = blockTime;
-            block->phashBlock = &hash;
         }
 
         CWalletTx wtx(&wallet, MakeTransactionRef(tx));
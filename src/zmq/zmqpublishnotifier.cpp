@@ -5,6 +5,7 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "miner.h"
 #include "streams.h"
 #include "zmqpublishnotifier.h"
 #include "validation.h"
@@ -14,6 +15,7 @@
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK   = "hashblock";
+static const char *MSG_BLOCKTEMPLATE = "blocktemplate";
 static const char *MSG_HASHTX      = "hashtx";
 static const char *MSG_RAWBLOCK    = "rawblock";
 static const char *MSG_RAWTX       = "rawtx";
@@ -158,6 +160,28 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     return SendMessage(MSG_HASHBLOCK, data, 32);
 }
 
+bool CZMQPublishBlockTemplateNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish blocktemplate %s\n", pindex->GetBlockHash().GetHex());
+    CBlockHeader header;
+    CAmount nCoinbaseValue;
+    {
+        LOCK(cs_main);
+        nCoinbaseValue = CreateEmptyBlockHeader(header, pindex, GetParams());
+    }
+
+    // previous block hash | height | version | bits | time | coinbase value
+    unsigned char data[56];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = header.hashPrevBlock.begin()[i];
+    WriteLE32(&data[32], header.nHeight);
+    WriteLE32(&data[36], header.nVersion.GetFullVersion());
+    WriteLE32(&data[40], header.nBits);
+    WriteLE32(&data[44], header.nTime);
+    WriteLE64(&data[48], nCoinbaseValue);
+    return SendMessage(MSG_BLOCKTEMPLATE, data, sizeof(data));
+}
+
 bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
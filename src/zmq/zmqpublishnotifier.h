@@ -36,6 +36,13 @@ public:
     bool NotifyBlock(const CBlockIndex *pindex) override;
 };
 
+/** Publishes the header fields of a block on top of each new tip, so that miners can switch jobs at once */
+class CZMQPublishBlockTemplateNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlock(const CBlockIndex *pindex) override;
+};
+
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
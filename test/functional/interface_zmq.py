@@ -67,12 +67,13 @@ class ZMQTest(MeowcoinTestFramework):
         socket.connect(address)
 
         # Subscribe to all available topics.
+        self.blocktemplate = ZMQSubscriber(socket, b"blocktemplate")
         self.hashblock = ZMQSubscriber(socket, b"hashblock")
         self.hashtx = ZMQSubscriber(socket, b"hashtx")
         self.rawblock = ZMQSubscriber(socket, b"rawblock")
         self.rawtx = ZMQSubscriber(socket, b"rawtx")
 
-        self.extra_args = [["-zmqpub%s=%s" % (sub.topic.decode(), address) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]], []]
+        self.extra_args = [["-zmqpub%s=%s" % (sub.topic.decode(), address) for sub in [self.blocktemplate, self.hashblock, self.hashtx, self.rawblock, self.rawtx]], []]
         self.add_nodes(self.num_nodes, self.extra_args)
         self.start_nodes()
 
@@ -98,6 +99,14 @@ class ZMQTest(MeowcoinTestFramework):
             hex_data = self.rawtx.receive()
             assert_equal(hash256(hex_data).hex(), self.nodes[1].getrawtransaction(txid.hex(), True)["hash"])
 
+            # Should receive the header fields of a block on top of the generated one.
+            template = self.blocktemplate.receive()
+            assert_equal(len(template), 56)
+            assert_equal(template[:32].hex(), genhashes[x])
+            height, version, bits, curtime, coinbasevalue = struct.unpack('<IiIIq', template[32:])
+            assert_equal(height, self.nodes[1].getblock(genhashes[x])["height"] + 1)
+            assert(coinbasevalue > 0)
+
             # Should receive the generated block hash.
             hash_data = self.hashblock.receive().hex()
             assert_equal(genhashes[x], hash_data)
@@ -36,6 +36,10 @@ Test is as follows:
     mempool.
   - Verify that savemempool throws when the RPC is called if
     node1 can't write to disk.
+  - Corrupt node1's mempool.dat and verify that it is not loaded.
+  - Send a chain of dependent transactions on node0 and restart it on
+    the same tip with script check threads. Verify that the whole chain
+    is reloaded.
 """
 
 import os
@@ -108,5 +112,38 @@ class MempoolPersistTest(MeowcoinTestFramework):
         assert_raises_rpc_error(-1, "Unable to dump mempool to disk", self.nodes[1].savemempool)
         os.remove(mempooldotnew1)
 
+        self.log.debug("Corrupt a byte of mempool.dat. Verify that the checksum makes node1 reject it")
+        self.nodes[1].savemempool()
+        self.stop_nodes()
+        with open(mempooldat1, 'r+b') as f:
+            f.seek(100)
+            byte = f.read(1)
+            f.seek(100)
+            f.write(bytes([byte[0] ^ 0xff]))
+        self.start_node(1, extra_args=[])
+        debuglog1 = os.path.join(self.options.tmpdir, 'node1', 'regtest', 'debug.log')
+        wait_until(lambda: "Failed to verify mempool file checksum" in open(debuglog1, encoding='utf-8').read(), err_msg="Wait for mempool.dat to be rejected")
+        assert_equal(len(self.nodes[1].getrawmempool()), 0)
+
+        self.log.debug("Send a chain of 3 transactions on node0. Verify that restarting on the same tip reloads all of them")
+        self.stop_nodes()
+        self.start_node(0, extra_args=["-par=2"])
+        wait_until(lambda: len(self.nodes[0].getrawmempool()) == 5, err_msg="Wait for getRawMempool")
+        tip = self.nodes[0].getbestblockhash()
+        utxo = self.nodes[0].listunspent()[0]
+        txid, vout, amount = utxo['txid'], utxo['vout'], utxo['amount']
+        address = self.nodes[0].getnewaddress()
+        for _ in range(3):
+            amount -= Decimal("0.001")
+            rawtx = self.nodes[0].createrawtransaction([{"txid": txid, "vout": vout}], {address: amount})
+            txid = self.nodes[0].sendrawtransaction(self.nodes[0].signrawtransaction(rawtx)["hex"])
+            vout = 0
+        assert_equal(self.nodes[0].getmempoolentry(txid)['ancestorcount'], 3)
+        self.stop_nodes()
+        self.start_node(0, extra_args=["-par=2"])
+        wait_until(lambda: len(self.nodes[0].getrawmempool()) == 8, err_msg="Wait for getRawMempool")
+        assert_equal(self.nodes[0].getbestblockhash(), tip)
+        assert_equal(self.nodes[0].getmempoolentry(txid)['ancestorcount'], 3)
+
 if __name__ == '__main__':
     MempoolPersistTest().main()
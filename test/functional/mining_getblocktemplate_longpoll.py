@@ -8,7 +8,7 @@
 
 import threading
 from test_framework.test_framework import MeowcoinTestFramework
-from test_framework.util import get_rpc_proxy, random_transaction, Decimal
+from test_framework.util import assert_equal, get_rpc_proxy, random_transaction, Decimal
 
 class LongpollThread(threading.Thread):
     def __init__(self, node):
@@ -67,6 +67,30 @@ class GetBlockTemplateLPTest(MeowcoinTestFramework):
         thr.join(60 + 20)
         assert(not thr.is_alive())
 
+        # Test 5: test that a template can be updated with the changes to an earlier one
+        template = self.nodes[0].getblocktemplate()
+        templateid = template['templateid']
+        assert('basetemplateid' not in template)
+        template_2 = self.nodes[0].getblocktemplate({'templateid': templateid})
+        assert_equal(template_2['templateid'], templateid)
+        assert_equal(template_2['basetemplateid'], templateid)
+        assert_equal(template_2['transactions'], [])
+        assert_equal(template_2['removed'], [])
+
+        txid = self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1)
+        template_3 = self.nodes[0].getblocktemplate({'templateid': templateid})
+        assert_equal(template_3['basetemplateid'], templateid)
+        assert_equal([tx['txid'] for tx in template_3['transactions']], [txid])
+        assert_equal(template_3['removed'], [])
+        assert_equal(template_3['coinbasevalue'], template['coinbasevalue'] + template_3['transactions'][0]['fee'])
+        assert(template_3['templateid'] != templateid)
+
+        # A new block invalidates the earlier templates
+        self.nodes[0].generate(1)
+        template_4 = self.nodes[0].getblocktemplate({'templateid': template_3['templateid']})
+        assert('basetemplateid' not in template_4)
+        assert_equal(template_4['transactions'], [])
+
 if __name__ == '__main__':
     GetBlockTemplateLPTest().main()
 
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2020 The Meowcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Test the built-in miner threads.
+
+Start the built-in miner with several threads and test that:
+
+  - it mines a block.
+  - getmininginfo reports one minerthreads entry per thread, with the
+    documented fields, and a hashespersec that is the sum over the threads.
+  - stopping the miner clears the entries.
+"""
+
+from test_framework.test_framework import MeowcoinTestFramework
+from test_framework.util import assert_equal, assert_greater_than, wait_until
+
+MINER_THREADS = 3
+
+class MinerThreadsTest(MeowcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+        assert_equal(node.getmininginfo()['minerthreads'], [])
+
+        self.log.info("Starting the miner with %d threads" % MINER_THREADS)
+        height = node.getblockcount()
+        assert node.setgenerate(True, MINER_THREADS).startswith("%d of " % MINER_THREADS)
+        wait_until(lambda: node.getblockcount() > height, err_msg="Wait for the miner to find a block")
+
+        self.log.info("Checking the per-thread statistics")
+        info = node.getmininginfo()
+        threads = info['minerthreads']
+        assert_equal(len(threads), MINER_THREADS)
+        for n, thread in enumerate(threads):
+            assert_equal(sorted(thread.keys()), ['hashes', 'hashespersec', 'staleblocks', 'staletemplates', 'thread'])
+            assert_equal(thread['thread'], n)
+        assert_greater_than(sum(thread['hashes'] for thread in threads), 0)
+        assert_equal(info['hashespersec'], sum(thread['hashespersec'] for thread in threads))
+
+        # Each thread searches its own nonces, so all of them get to hash
+        wait_until(lambda: all(t['hashes'] > 0 for t in node.getmininginfo()['minerthreads']), err_msg="Wait for all threads to hash")
+
+        self.log.info("Stopping the miner")
+        node.setgenerate(False)
+        assert_equal(node.getmininginfo()['minerthreads'], [])
+
+if __name__ == '__main__':
+    MinerThreadsTest().main()
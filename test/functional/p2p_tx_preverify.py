@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2020 The Meowcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+"""Test the signature pre-verification queue of relayed transactions.
+
+Transactions received from a peer have their signatures checked on worker
+threads before they are processed. Test that:
+
+  - a child sent right after its parent is accepted with it, in order.
+  - a child sent before its parent is kept as an orphan and accepted once
+    the parent arrives.
+  - a ping sent after transactions is answered only once the transactions
+    are processed, as the node holds back the other messages of a peer while
+    it has transactions in the queue.
+"""
+
+from io import BytesIO
+from test_framework.mininode import CTransaction, hex_str_to_bytes, NodeConn, NodeConnCB, NetworkThread, MsgTx
+from test_framework.test_framework import MeowcoinTestFramework
+from test_framework.util import assert_equal, Decimal, p2p_port
+
+class TxPreVerifyTest(MeowcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.extra_args = [["-par=2"]]
+
+    def create_chain(self, length):
+        """Sign a chain of length transactions, each spending the one before, without sending them"""
+        node = self.nodes[0]
+        utxo = [u for u in node.listunspent() if (u['txid'], u['vout']) not in self.spent][0]
+        self.spent.add((utxo['txid'], utxo['vout']))
+        txid, amount = utxo['txid'], utxo['amount']
+        inputs = [{"txid": txid, "vout": utxo['vout']}]
+        chain = []
+        for _ in range(length):
+            amount -= Decimal("0.01")
+            rawtx = node.createrawtransaction(inputs, {node.getnewaddress(): amount})
+            tx = CTransaction()
+            tx.deserialize(BytesIO(hex_str_to_bytes(node.signrawtransaction(rawtx)["hex"])))
+            tx.rehash()
+            chain.append(tx)
+            inputs = [{"txid": tx.hash, "vout": 0}]
+        return chain
+
+    def send_txs(self, txs):
+        """Send txs and a ping, and check that all of them are in the mempool by the time the pong comes back"""
+        for tx in txs:
+            self.test_node.send_message(MsgTx(tx))
+        self.test_node.sync_with_ping()
+        mempool = self.nodes[0].getrawmempool()
+        for tx in txs:
+            assert tx.hash in mempool
+
+    def run_test(self):
+        self.spent = set()
+        self.test_node = NodeConnCB()
+        connections = [NodeConn('127.0.0.1', p2p_port(0), self.nodes[0], self.test_node)]
+        self.test_node.add_connection(connections[0])
+        NetworkThread().start()
+        self.test_node.wait_for_verack()
+
+        # Leave IBD, so that relayed transactions are accepted
+        self.nodes[0].generate(1)
+
+        self.log.info("Send a parent and its child. Verify that both are accepted")
+        parent, child = self.create_chain(2)
+        self.send_txs([parent, child])
+        assert_equal(self.nodes[0].getmempoolentry(child.hash)['ancestorcount'], 2)
+
+        self.log.info("Send a child before its parent. Verify that both are accepted once the parent is")
+        parent, child = self.create_chain(2)
+        self.test_node.send_and_ping(MsgTx(child))
+        assert child.hash not in self.nodes[0].getrawmempool()
+        self.send_txs([parent])
+        assert child.hash in self.nodes[0].getrawmempool()
+
+        self.log.info("Send a chain of 10 transactions. Verify that the ping is answered after all of them are accepted")
+        self.send_txs(self.create_chain(10))
+        assert_equal(len(self.nodes[0].getrawmempool()), 14)
+
+if __name__ == '__main__':
+    TxPreVerifyTest().main()
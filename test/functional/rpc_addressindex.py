@@ -9,7 +9,7 @@
 import binascii
 import time
 from test_framework.test_framework import MeowcoinTestFramework
-from test_framework.util import connect_nodes_bi, assert_equal
+from test_framework.util import connect_nodes_bi, assert_equal, assert_raises_rpc_error
 from test_framework.script import CScript, OP_HASH160, OP_EQUAL, OP_DUP, OP_EQUALVERIFY, OP_CHECKSIG
 from test_framework.mininode import CTransaction, CTxIn, CTxOut, COutPoint
 
@@ -26,7 +26,7 @@ class AddressIndexTest(MeowcoinTestFramework):
             ["-addressindex"],
         # Nodes 2/3 are used for testing
             ["-addressindex", "-relaypriority=0"],
-            ["-addressindex"]])
+            ["-addressindex", "-addresssummaryindex"]])
 
         self.start_nodes()
 
@@ -170,6 +170,20 @@ class AddressIndexTest(MeowcoinTestFramework):
         balance2 = self.nodes[1].getaddressbalance(address2)
         assert_equal(balance2["balance"], change_amount)
 
+        # The summary index agrees with the address index
+        summary2 = self.nodes[3].getaddressbalance(address2)
+        assert_equal(summary2["balance"], balance2["balance"])
+        assert_equal(summary2["received"], balance2["received"])
+        assert_equal(summary2["txcount"], 2)
+        assert_equal(summary2["firstheight"], self.nodes[3].getblockcount() - 1)
+        assert_equal(summary2["lastheight"], self.nodes[3].getblockcount())
+
+        # The last transaction pays both addresses, so their counts cannot be summed
+        summary_both = self.nodes[3].getaddressbalance({"addresses": ["2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br", address2]})
+        summary1 = self.nodes[3].getaddressbalance("2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br")
+        assert_equal(summary_both["balance"], summary1["balance"] + summary2["balance"])
+        assert "txcount" not in summary_both
+
         # Check that deltas are returned correctly
         deltas = self.nodes[1].getaddressdeltas({"addresses": [address2], "start": 1, "end": 200})
         balance3 = 0
@@ -342,6 +356,36 @@ class AddressIndexTest(MeowcoinTestFramework):
         assert_equal(utxos_with_info["height"], 267)
         assert_equal(utxos_with_info["hash"], expected_tip_block_hash)
 
+        # Page through the results with a cursor
+        self.log.info("Testing paginated results...")
+
+        paged_txids = []
+        cursor = None
+        while True:
+            query = {"addresses": ["2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br"], "limit": 1}
+            if cursor is not None:
+                query["cursor"] = cursor
+            page = self.nodes[1].getaddresstxids(query)
+            assert(len(page["txids"]) <= 1)
+            paged_txids += page["txids"]
+            cursor = page["cursor"]
+            if cursor is None:
+                break
+        assert_equal(sorted(paged_txids), sorted(self.nodes[1].getaddresstxids("2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br")))
+
+        all_deltas = self.nodes[1].getaddressdeltas({"addresses": [address2]})
+        first_page = self.nodes[1].getaddressdeltas({"addresses": [address2], "limit": 2})
+        assert_equal(first_page["deltas"], all_deltas[:2])
+        second_page = self.nodes[1].getaddressdeltas({"addresses": [address2], "limit": len(all_deltas), "cursor": first_page["cursor"]})
+        assert_equal(second_page["deltas"], all_deltas[2:])
+        assert_equal(second_page["cursor"], None)
+
+        utxo_page = self.nodes[1].getaddressutxos({"addresses": [address2], "limit": 100})
+        assert_equal(len(utxo_page["utxos"]), len(self.nodes[1].getaddressutxos({"addresses": [address2]})))
+        assert_equal(utxo_page["cursor"], None)
+
+        assert_raises_rpc_error(-8, "Invalid cursor", self.nodes[1].getaddressdeltas, {"addresses": [address2], "limit": 1, "cursor": "00"})
+
         self.log.info("All Tests Passed")
 
 
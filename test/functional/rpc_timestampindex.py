@@ -8,7 +8,7 @@
 
 import time
 from test_framework.test_framework import MeowcoinTestFramework
-from test_framework.util import connect_nodes_bi, assert_equal
+from test_framework.util import connect_nodes_bi, assert_equal, call_when_index_synced
 
 class TimestampIndexTest(MeowcoinTestFramework):
 
@@ -53,6 +53,12 @@ class TimestampIndexTest(MeowcoinTestFramework):
 
         assert_equal(hashes, blockhashes)
 
+        # Node2 builds the index from the blocks it has. Until it has caught
+        # up with the chain getblockhashes returns RPC_IN_WARMUP.
+        self.log.info("Checking timestamp index built on restart...")
+        self.restart_node(2, ["-timestampindex"])
+        assert_equal(call_when_index_synced(self.nodes[2].getblockhashes, high, low), blockhashes)
+
         self.log.info("All Tests Passed")
 
 
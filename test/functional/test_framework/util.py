@@ -308,6 +308,22 @@ def wait_until(predicate, *, err_msg, attempts=float('inf'), timeout=float('inf'
     raise RuntimeError('Unreachable')
 
 
+def call_when_index_synced(method, *args):
+    """Call an RPC that reads an optional index, retrying while the index is
+    still catching up with the chain (RPC_IN_WARMUP)."""
+    result = []
+
+    def try_call():
+        try:
+            result.append(method(*args))
+            return True
+        except JSONRPCException as e:
+            assert_equal(e.error['code'], -28)
+            return False
+    wait_until(try_call, err_msg="Wait for the index to catch up")
+    return result[0]
+
+
 ##########################################################################################
 #                       RPC/P2P connection constants and functions
 ##########################################################################################
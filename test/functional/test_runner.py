@@ -104,6 +104,7 @@ BASE_SCRIPTS= [
     'mempool_persist.py',
     'rpc_timestampindex.py',
     'wallet_listreceivedby.py',
+    'mining_minerthreads.py',
     'wallet_reorgsrestore.py',
     'interface_rest.py',
     'wallet_keypool_topup.py',
@@ -113,6 +114,7 @@ BASE_SCRIPTS= [
     'rpc_blockchain.py',
     'p2p_feefilter.py',
     'p2p_leak.py',
+    'p2p_tx_preverify.py',
     'feature_versionbits_warning.py',
     'rpc_spentindex.py',
     'feature_rawassettransactions.py',